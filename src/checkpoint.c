@@ -0,0 +1,263 @@
+/*
+ * checkpoint.c
+ *
+ *  Created on: 18.10.2026
+ *      Author: jh
+ */
+
+/*
+    Checkpoints of a running comparison
+
+    Copyright (C) 2017  Jörg Habenicht (jh@mwerk.net)
+
+    This file is part of lfdiff
+
+    lfdiff is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    lfdiff is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#define _GNU_SOURCE
+#include "checkpoint.h"
+#include "diffmanager.h"
+#include "difflist.h"
+#include "context.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <unistd.h>
+
+
+/* records of the journal */
+enum {
+    CHECKPOINT_LINE = 'L',	// list, line number, length, text
+    CHECKPOINT_STATE = 'C',	// state, length of context, context
+};
+
+struct checkpoint_header_s {
+    char magic[8];
+    uint64_t params;
+};
+
+
+static void checkpoint_write(struct checkpoint_s *checkpoint, const void *data, size_t count) {
+    if (count && 1 != fwrite(data, count, 1, checkpoint->file)) {
+	fprintf(stderr, "error: writing checkpoint file '%s': %s\n", checkpoint->path, strerror(errno));
+	abort();
+    }
+}
+
+/* @return: 1 if read, 0 if the file ends before */
+static int checkpoint_read(struct checkpoint_s *checkpoint, void *data, size_t count) {
+    if (count && 1 != fread(data, count, 1, checkpoint->file)) {
+	if (ferror(checkpoint->file)) {
+	    fprintf(stderr, "error: reading checkpoint file '%s': %s\n", checkpoint->path, strerror(errno));
+	    abort();
+	}
+	return 0;
+    }
+    return 1;
+}
+
+struct checkpoint_s *checkpoint_open(const char *path, uint64_t params, int resume) {
+    assert(path);
+
+    struct checkpoint_header_s header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+    header.params = params;
+
+    struct checkpoint_s *checkpoint = calloc(1, sizeof(*checkpoint));
+    assert(checkpoint);
+    checkpoint->path = strdup(path);
+    assert(checkpoint->path);
+
+    if (resume) {
+	struct checkpoint_header_s found;
+	checkpoint->file = fopen(path, "r+");
+	if (!checkpoint->file
+		|| !checkpoint_read(checkpoint, &found, sizeof(found))
+		|| memcmp(&found, &header, sizeof(header))) {
+	    if (checkpoint->file)
+		fclose(checkpoint->file);
+	    free(checkpoint->path);
+	    free(checkpoint);
+	    return NULL;
+	}
+    }
+    else {
+	checkpoint->file = fopen(path, "w+");
+	if (!checkpoint->file) {
+	    fprintf(stderr, "error: could not open checkpoint file '%s': %s\n", path, strerror(errno));
+	    exit(EXIT_FAILURE);
+	}
+	checkpoint_write(checkpoint, &header, sizeof(header));
+    }
+
+    return checkpoint;
+}
+
+void checkpoint_close(struct checkpoint_s *checkpoint, int done) {
+    assert(checkpoint);
+
+    fclose(checkpoint->file);
+    if (done)
+	unlink(checkpoint->path);
+    free(checkpoint->path);
+    free(checkpoint);
+}
+
+/* append the lines of list behind the last line saved */
+static void checkpoint_save_list(struct checkpoint_s *checkpoint, struct diff_list_s *list, uint8_t which) {
+
+    long n;
+    if (!list || !diff_get_next_line_nr(list, checkpoint->saved[which] + 1, &n))
+	return;
+
+    struct diff_iterator *it;
+    for (it = diff_iterator_get_line(list, n); it; diff_iterator_next(&it)) {
+	const uint8_t tag = CHECKPOINT_LINE;
+	const int64_t nr = diff_get_line_nr(it);
+	const uint64_t len = diff_get_line_len(it);
+	checkpoint_write(checkpoint, &tag, sizeof(tag));
+	checkpoint_write(checkpoint, &which, sizeof(which));
+	checkpoint_write(checkpoint, &nr, sizeof(nr));
+	checkpoint_write(checkpoint, &len, sizeof(len));
+	checkpoint_write(checkpoint, diff_get_line(it), len);
+	checkpoint->saved[which] = nr;
+    }
+}
+
+void checkpoint_save(struct checkpoint_s *checkpoint, struct diffmanager_s *manager, const struct context_s *context, const struct checkpoint_state_s *state) {
+    assert(checkpoint);
+    assert(manager);
+    assert(state);
+
+    checkpoint_save_list(checkpoint, manager->difflistA, 0);
+    checkpoint_save_list(checkpoint, manager->difflistB, 1);
+    checkpoint_save_list(checkpoint, manager->contextlist, 2);
+
+    // the context is skipped on resume unless it is the last one
+    char *buffer = NULL;
+    size_t size = 0;
+    if (context) {
+	FILE *f = open_memstream(&buffer, &size);
+	assert(f);
+	context_save(context, f);
+	fclose(f);
+    }
+    const uint8_t tag = CHECKPOINT_STATE;
+    const uint64_t len = size;
+    checkpoint_write(checkpoint, &tag, sizeof(tag));
+    checkpoint_write(checkpoint, state, sizeof(*state));
+    checkpoint_write(checkpoint, &len, sizeof(len));
+    checkpoint_write(checkpoint, buffer, len);
+    free(buffer);
+
+    // survive a crash of the machine as well
+    if (fflush(checkpoint->file) || fsync(fileno(checkpoint->file))) {
+	fprintf(stderr, "error: writing checkpoint file '%s': %s\n", checkpoint->path, strerror(errno));
+	abort();
+    }
+    checkpoint->checkpoints++;
+}
+
+/* read the next record, the text of a line into buffer.
+ * @return: tag of the record, 0 at the end of the file or a record cut short
+ */
+static uint8_t checkpoint_next(struct checkpoint_s *checkpoint, uint8_t *which, int64_t *nr, char **buffer, uint64_t *len, struct checkpoint_state_s *state) {
+
+    uint8_t tag;
+    if (!checkpoint_read(checkpoint, &tag, sizeof(tag)))
+	return 0;
+
+    switch (tag) {
+    case CHECKPOINT_LINE:
+	if (!checkpoint_read(checkpoint, which, sizeof(*which))
+		|| !checkpoint_read(checkpoint, nr, sizeof(*nr))
+		|| !checkpoint_read(checkpoint, len, sizeof(*len)))
+	    return 0;
+	break;
+    case CHECKPOINT_STATE:
+	if (!checkpoint_read(checkpoint, state, sizeof(*state))
+		|| !checkpoint_read(checkpoint, len, sizeof(*len)))
+	    return 0;
+	break;
+    default:
+	fprintf(stderr, "error: checkpoint file '%s' is damaged\n", checkpoint->path);
+	abort();
+    }
+
+    *buffer = realloc(*buffer, *len + sizeof("< \n"));
+    assert(*buffer);
+    if (!checkpoint_read(checkpoint, *buffer, *len))
+	return 0;
+
+    return tag;
+}
+
+int checkpoint_load(struct checkpoint_s *checkpoint, struct diffmanager_s *manager, struct context_s *context, struct checkpoint_state_s *state) {
+    assert(checkpoint);
+    assert(manager);
+    assert(state);
+
+    const off_t start = ftello(checkpoint->file);
+    off_t end = start;
+    uint8_t tag, which;
+    int64_t nr;
+    uint64_t len;
+    char *buffer = NULL;
+
+    // find the end of the last complete checkpoint
+    while ((tag = checkpoint_next(checkpoint, &which, &nr, &buffer, &len, state)))
+	if (CHECKPOINT_STATE == tag)
+	    end = ftello(checkpoint->file);
+
+    // put in the lines up to there
+    fseeko(checkpoint->file, start, SEEK_SET);
+    while (ftello(checkpoint->file) < end) {
+	tag = checkpoint_next(checkpoint, &which, &nr, &buffer, &len, state);
+	if (CHECKPOINT_LINE == tag) {
+	    if (2 == which)
+		diffmanager_input_context(manager, buffer, len, nr);
+	    else {
+		// the same format "diff" prints
+		memmove(buffer + 2, buffer, len);
+		buffer[0] = which? '>': '<';
+		buffer[1] = ' ';
+		buffer[2 + len] = '\0';
+		diffmanager_input_diff(manager, buffer, nr);
+	    }
+	    checkpoint->saved[which] = nr;
+	}
+	else if (CHECKPOINT_STATE == tag && ftello(checkpoint->file) == end && context) {
+	    FILE *f = fmemopen(buffer, len, "r");
+	    assert(f);
+	    context_load(context, f);
+	    fclose(f);
+	}
+	if (CHECKPOINT_STATE == tag)
+	    checkpoint->checkpoints++;
+    }
+    free(buffer);
+
+    // append the next checkpoints behind the last one
+    if (ftruncate(fileno(checkpoint->file), end) || fseeko(checkpoint->file, end, SEEK_SET)) {
+	fprintf(stderr, "error: writing checkpoint file '%s': %s\n", checkpoint->path, strerror(errno));
+	abort();
+    }
+
+    return end > start;
+}
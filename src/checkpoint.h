@@ -0,0 +1,93 @@
+/*
+ * checkpoint.h
+ *
+ *  Created on: 18.10.2026
+ *      Author: jh
+ */
+
+/*
+    Checkpoints of a running comparison
+
+    Copyright (C) 2017  Jörg Habenicht (jh@mwerk.net)
+
+    This file is part of lfdiff
+
+    lfdiff is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    lfdiff is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#ifndef SRC_ANSIC_CHECKPOINT_H_
+#define SRC_ANSIC_CHECKPOINT_H_
+
+#include <stdio.h>
+#include <stdint.h>
+
+
+#define CHECKPOINT_MAGIC	"LFDCKP1"
+
+struct diffmanager_s;
+struct context_s;
+
+/* position of the comparison at a slice boundary */
+struct checkpoint_state_s {
+    int64_t offset[2];	// bytes of A and B compared
+    int64_t lines[2];	// lines of A and B compared
+    uint64_t skippedlines;	// lines in equal chunks
+};
+
+/* The checkpoint file is a journal: every checkpoint appends the lines
+ * stored since the previous one, followed by the state. The stored lines
+ * only grow until the diff is printed at the end, so nothing is written
+ * twice. A checkpoint cut short by a crash is dropped on resume.
+ */
+struct checkpoint_s {
+    FILE *file;
+    char *path;
+    long saved[3];	// last line saved of list A, B and context
+    long checkpoints;	// checkpoints written or read
+};
+
+
+/** open a checkpoint file.
+ * @param path: file name
+ * @param params: hash of the options and inputs, a checkpoint is resumed
+ *   with the same ones only
+ * @param resume: 1 to continue the last checkpoint in path, 0 to start a
+ *   new file
+ * @return: handler, NULL if there is no checkpoint of params to resume
+ */
+struct checkpoint_s *checkpoint_open(const char *path, uint64_t params, int resume);
+
+/** close the checkpoint file.
+ * @param done: the comparison has finished, the file is removed
+ */
+void checkpoint_close(struct checkpoint_s *checkpoint, int done);
+
+/** append a checkpoint.
+ * @param manager: the lines stored since the last checkpoint are saved
+ * @param context: context of unified output, NULL if none
+ * @param state: position of the comparison
+ */
+void checkpoint_save(struct checkpoint_s *checkpoint, struct diffmanager_s *manager, const struct context_s *context, const struct checkpoint_state_s *state);
+
+/** read the last checkpoint of a resumed file.
+ * The stored lines are put into manager and context, the file is cut
+ * behind the checkpoint to append the next ones.
+ *
+ * @return: 1 if a checkpoint has been read, 0 if the file has none
+ */
+int checkpoint_load(struct checkpoint_s *checkpoint, struct diffmanager_s *manager, struct context_s *context, struct checkpoint_state_s *state);
+
+#endif /* SRC_ANSIC_CHECKPOINT_H_ */
@@ -0,0 +1,213 @@
+/*
+ * chunkindex.c
+ *
+ *  Created on: 18.10.2026
+ *      Author: jh
+ */
+
+/*
+    Index of the chunks of an input file, kept between runs
+
+    Copyright (C) 2017  Jörg Habenicht (jh@mwerk.net)
+
+    This file is part of lfdiff
+
+    lfdiff is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    lfdiff is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#define _GNU_SOURCE
+#include "chunkindex.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+
+/* fill in the fields identifying the input file */
+static void chunkindex_stat(struct chunkindex_header_s *header, const struct stat *st, uint64_t params) {
+
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, CHUNKINDEX_MAGIC, sizeof(header->magic));
+    header->size = st->st_size;
+    header->mtime = st->st_mtim.tv_sec;
+    header->mtimensec = st->st_mtim.tv_nsec;
+    header->inode = st->st_ino;
+    header->device = st->st_dev;
+    header->params = params;
+}
+
+/* the index belongs to the input file as it is now */
+static int chunkindex_matches(const struct chunkindex_header_s *a, const struct chunkindex_header_s *b) {
+
+    return !memcmp(a->magic, b->magic, sizeof(a->magic))
+	    && a->size == b->size
+	    && a->mtime == b->mtime
+	    && a->mtimensec == b->mtimensec
+	    && a->inode == b->inode
+	    && a->device == b->device
+	    && a->params == b->params;
+}
+
+struct chunkindex_s *chunkindex_open(const char *dir, int fd, uint64_t params) {
+    assert(dir);
+
+    struct stat st;
+    if (fstat(fd, &st) || !S_ISREG(st.st_mode))
+	return NULL;
+
+    char *path;
+    if (-1 == asprintf(&path, "%s/%llx-%llx.lfdidx", dir,
+	    (unsigned long long) st.st_dev, (unsigned long long) st.st_ino)) {
+	fprintf(stderr, "error: can not print to string: %s\n", strerror(errno));
+	abort();
+    }
+    struct chunkindex_s *index = chunkindex_open_file(path, fd, params, CHUNKINDEX_REUSE);
+    free(path);
+
+    return index;
+}
+
+struct chunkindex_s *chunkindex_open_file(const char *path, int fd, uint64_t params, int mode) {
+    assert(path);
+
+    struct stat st;
+    if (fstat(fd, &st) || !S_ISREG(st.st_mode))
+	return NULL;
+
+    struct chunkindex_s *index = calloc(1, sizeof(*index));
+    assert(index);
+    index->fd = fd;
+    index->path = strdup(path);
+    assert(index->path);
+    chunkindex_stat(&index->header, &st, params);
+
+    // reuse the index if it is still valid
+    index->file = CHUNKINDEX_WRITE != mode? fopen(index->path, "r"): NULL;
+    if (index->file) {
+	struct chunkindex_header_s header;
+	struct stat indexst;
+	if (1 == fread(&header, sizeof(header), 1, index->file)
+		&& chunkindex_matches(&header, &index->header)
+		&& !fstat(fileno(index->file), &indexst)
+		&& (uint64_t) indexst.st_size == sizeof(header) + header.chunks * sizeof(struct chunkindex_entry_s)) {
+	    index->header = header;
+	    return index;
+	}
+	fclose(index->file);
+    }
+    if (CHUNKINDEX_READ == mode) {
+	free(index->path);
+	free(index);
+	return NULL;
+    }
+
+    // write a new one next to it
+    if (-1 == asprintf(&index->tmppath, "%s.XXXXXX", index->path)) {
+	fprintf(stderr, "error: can not print to string: %s\n", strerror(errno));
+	abort();
+    }
+    const int indexfd = mkstemp(index->tmppath);
+    if (-1 == indexfd) {
+	fprintf(stderr, "error: can not create index file '%s': %s\n", index->tmppath, strerror(errno));
+	abort();
+    }
+    index->file = fdopen(indexfd, "w");
+    assert(index->file);
+    // the header is written when the index is complete
+    struct chunkindex_header_s empty;
+    memset(&empty, 0, sizeof(empty));
+    if (1 != fwrite(&empty, sizeof(empty), 1, index->file)) {
+	fprintf(stderr, "error: writing index file '%s': %s\n", index->tmppath, strerror(errno));
+	abort();
+    }
+
+    return index;
+}
+
+void chunkindex_close(struct chunkindex_s *index, int complete) {
+    assert(index);
+
+    if (index->tmppath) {
+	// the input must not have changed while it was read
+	struct stat st;
+	struct chunkindex_header_s now;
+	if (complete && !fstat(index->fd, &st)) {
+	    chunkindex_stat(&now, &st, index->header.params);
+	    complete = chunkindex_matches(&now, &index->header);
+	}
+	else
+	    complete = 0;
+
+	if (complete) {
+	    index->header.chunks = index->count;
+	    if (fseeko(index->file, 0, SEEK_SET)
+		    || 1 != fwrite(&index->header, sizeof(index->header), 1, index->file)) {
+		fprintf(stderr, "error: writing index file '%s': %s\n", index->tmppath, strerror(errno));
+		abort();
+	    }
+	}
+	if (fclose(index->file)) {
+	    fprintf(stderr, "error: writing index file '%s': %s\n", index->tmppath, strerror(errno));
+	    abort();
+	}
+	if (!complete || rename(index->tmppath, index->path))
+	    unlink(index->tmppath);
+	free(index->tmppath);
+    }
+    else
+	fclose(index->file);
+
+    free(index->path);
+    free(index);
+}
+
+int chunkindex_reading(const struct chunkindex_s *index) {
+    assert(index);
+
+    return !index->tmppath;
+}
+
+int chunkindex_read(struct chunkindex_s *index, struct chunkindex_entry_s *entry) {
+    assert(index);
+    assert(!index->tmppath);
+    assert(entry);
+
+    if (index->count == index->header.chunks)
+	return 0;
+    if (1 != fread(entry, sizeof(*entry), 1, index->file)) {
+	fprintf(stderr, "error: reading index file '%s': %s\n", index->path, ferror(index->file)? strerror(errno): "file truncated");
+	abort();
+    }
+    index->count++;
+
+    return 1;
+}
+
+void chunkindex_write(struct chunkindex_s *index, const struct chunkindex_entry_s *entry) {
+    assert(index);
+    assert(index->tmppath);
+    assert(entry);
+
+    if (1 != fwrite(entry, sizeof(*entry), 1, index->file)) {
+	fprintf(stderr, "error: writing index file '%s': %s\n", index->tmppath, strerror(errno));
+	abort();
+    }
+    index->count++;
+    index->header.lines += entry->lines;
+}
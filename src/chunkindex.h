@@ -0,0 +1,123 @@
+/*
+ * chunkindex.h
+ *
+ *  Created on: 18.10.2026
+ *      Author: jh
+ */
+
+/*
+    Index of the chunks of an input file, kept between runs
+
+    Copyright (C) 2017  Jörg Habenicht (jh@mwerk.net)
+
+    This file is part of lfdiff
+
+    lfdiff is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    lfdiff is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#ifndef SRC_ANSIC_CHUNKINDEX_H_
+#define SRC_ANSIC_CHUNKINDEX_H_
+
+#include <stdio.h>
+#include <stdint.h>
+
+
+#define CHUNKINDEX_MAGIC	"LFDIDX1"
+
+/* how chunkindex_open_file() opens an index */
+enum {
+    CHUNKINDEX_REUSE = 0,	// read a valid index, else write a new one
+    CHUNKINDEX_READ,		// read a valid index only
+    CHUNKINDEX_WRITE,		// always write a new one
+};
+
+/* one chunk of the input file */
+struct chunkindex_entry_s {
+    uint64_t offset;	// position in file
+    uint64_t len;	// length in bytes
+    uint64_t lines;	// number of lines
+    uint64_t hash;	// hash of the chunk, see chunk_equal()
+};
+
+/* start of the index file, followed by the entries in file order.
+ * The index is valid as long as the file has the same size, mtime, inode
+ * and device and is read with the same parameters.
+ */
+struct chunkindex_header_s {
+    char magic[8];
+    uint64_t size;
+    int64_t mtime;	// seconds
+    int64_t mtimensec;
+    uint64_t inode;
+    uint64_t device;
+    uint64_t params;	// hash of chunk size, compare flags and mask
+    uint64_t chunks;	// number of entries
+    uint64_t lines;	// lines in file
+};
+
+struct chunkindex_s {
+    int fd;		// input file
+    FILE *file;
+    char *path;		// index file name
+    char *tmppath;	// index file being written, NULL if reading
+    struct chunkindex_header_s header;
+    uint64_t count;	// entries read or written
+};
+
+
+/** open the index of an input file in directory dir.
+ * A valid index is opened for reading. Else a new index is written, it
+ * replaces the old one when it is closed complete.
+ *
+ * @param dir: directory of the index files
+ * @param fd: input file, must be a regular file read from its start
+ * @param params: hash of the parameters the chunks are read with
+ * @return: handler, NULL if fd is not a regular file or no index can be
+ *   written
+ */
+struct chunkindex_s *chunkindex_open(const char *dir, int fd, uint64_t params);
+
+/** open the index of an input file stored in path.
+ * A new index is written next to path and replaces it when it is closed
+ * complete.
+ *
+ * @param path: index file name
+ * @param fd: input file, must be a regular file read from its start
+ * @param params: hash of the parameters the chunks are read with
+ * @param mode: CHUNKINDEX_REUSE, CHUNKINDEX_READ or CHUNKINDEX_WRITE
+ * @return: handler, NULL if fd is not a regular file or, with
+ *   CHUNKINDEX_READ, if path is no valid index of fd
+ */
+struct chunkindex_s *chunkindex_open_file(const char *path, int fd, uint64_t params, int mode);
+
+/** close the index.
+ * @param complete: a written index covers the whole input and is valid. 0
+ *   discards it.
+ */
+void chunkindex_close(struct chunkindex_s *index, int complete);
+
+/** test whether the index has been opened for reading. */
+int chunkindex_reading(const struct chunkindex_s *index);
+
+/** read the next entry.
+ * @return: 1 if read, 0 at the end of the index
+ */
+int chunkindex_read(struct chunkindex_s *index, struct chunkindex_entry_s *entry);
+
+/** append the next entry to an index opened for writing. */
+void chunkindex_write(struct chunkindex_s *index, const struct chunkindex_entry_s *entry);
+
+#endif /* SRC_ANSIC_CHUNKINDEX_H_ */
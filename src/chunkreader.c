@@ -0,0 +1,590 @@
+/*
+ * chunkreader.c
+ *
+ *  Created on: 18.10.2026
+ *      Author: jh
+ */
+
+/*
+    Reader thread splitting an input stream into blocks of whole lines
+
+    Copyright (C) 2017  Jörg Habenicht (jh@mwerk.net)
+
+    This file is part of lfdiff
+
+    lfdiff is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    lfdiff is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#define _GNU_SOURCE
+#include "chunkreader.h"
+#include "hash.h"
+#include "mask.h"
+#include "uringread.h"
+#include "spscring.h"
+#include "longline.h"
+#include "chunkindex.h"
+#include "iolimit.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <unistd.h>
+
+// reads in flight per input, if io_uring is available
+#define CHUNKREADER_URING_DEPTH		4
+#define CHUNKREADER_URING_BLOCKSIZE	(1024*1024)
+// lines longer than this are moved into the spill file, if longer than
+// four times the chunk size
+#define CHUNKREADER_LONGLINE_MIN	(1024*1024)
+// changes with the way chunks are cut and hashed, invalidates the index files
+#define CHUNKREADER_INDEX_VERSION	1
+
+// pages read are dropped from the page cache in steps of this size, --nice-io
+#define CHUNKREADER_DROP_SIZE	(8*1024*1024)
+
+#define MIN(a,b)	((a)<(b)?(a):(b))
+#define MAX(a,b)	((a)>(b)?(a):(b))
+
+static struct chunk_s *chunk_alloc(size_t capacity) {
+    struct chunk_s *chunk = calloc(1, sizeof(*chunk));
+    assert(chunk);
+    chunk->data = malloc(capacity);
+    assert(chunk->data);
+
+    return chunk;
+}
+
+void chunkreader_load(struct chunkreader_s *reader, struct chunk_s *chunk) {
+    assert(reader);
+    assert(chunk);
+
+    if (chunk->data)
+	return;
+
+    chunk->data = malloc(chunk->len);
+    assert(chunk->data);
+    size_t done = 0;
+    while (done < chunk->len) {
+	const ssize_t got = pread(fileno(reader->infile), chunk->data + done, chunk->len - done, chunk->offset + done);
+	if (0 >= got) {
+	    fprintf(stderr, "error: reading from input file: %s\n", got? strerror(errno): "file truncated");
+	    abort();
+	}
+	done += got;
+    }
+    reader->loaded += chunk->len;
+    if (reader->iolimit) {
+	iolimit_take(reader->iolimit, chunk->len);
+	iolimit_drop(reader->iolimit, fileno(reader->infile), chunk->offset, chunk->len);
+    }
+}
+
+void chunk_free(struct chunk_s *chunk) {
+    assert(chunk);
+
+    free(chunk->data);
+    free(chunk);
+}
+
+int chunk_equal(const struct chunk_s *a, const struct chunk_s *b, int flags, const struct mask_s *mask) {
+    assert(a);
+    assert(b);
+
+    if (!a->data || !b->data)
+	return a->hash == b->hash;
+
+    return a->hash == b->hash && mask_lines_equal(mask, a->data, a->len, b->data, b->len, flags);
+}
+
+/* mask and normalise one line for comparison.
+ * @param buffer: two buffers, reallocated if too small
+ * @param bufferlen: size of both buffers
+ * @return: pointer to the result, its length is returned in len
+ */
+static const char *chunk_transform_line(const char *line, size_t *len, int flags, const struct mask_s *mask, char *buffer[2], size_t *bufferlen) {
+
+    // long lines are compared by their hash
+    if (longline_is_placeholder(line, *len))
+	return line;
+
+    if (*len > *bufferlen) {
+	*bufferlen = *len;
+	buffer[0] = realloc(buffer[0], *bufferlen);
+	buffer[1] = realloc(buffer[1], *bufferlen);
+	assert(buffer[0]);
+	assert(buffer[1]);
+    }
+
+    *len = mask_apply(mask, line, *len, buffer[0]);
+    *len = hash_normalise(buffer[0], *len, buffer[1], flags);
+
+    return buffer[1];
+}
+
+/* hash the content of a chunk.
+ * Without flags and mask the content is hashed at once. Else the hashes of
+ * the masked and normalised lines are chained, the same way
+ * chunkreader_thread() does.
+ */
+static uint64_t chunk_hash(const char *data, size_t len, int flags, const struct mask_s *mask) {
+
+    if (!flags && !mask)
+	return hash_bytes(data, len, 0);
+
+    char *buffer[2] = { NULL, NULL };
+    size_t bufferlen = 0;
+    uint64_t hash = 0;
+    const char *line = data;
+    const char * const end = data + len;
+
+    while (line < end) {
+	const char *newline = memchr(line, '\n', end - line);
+	const char *next = newline? newline + 1: end;
+	size_t linelen = next - line;
+	const char *t = chunk_transform_line(line, &linelen, flags, mask, buffer, &bufferlen);
+	if (linelen)
+	    hash = hash_bytes(t, linelen, hash);
+	line = next;
+    }
+    free(buffer[0]);
+    free(buffer[1]);
+
+    return hash;
+}
+
+struct chunk_s *chunk_split(struct chunk_s *chunk, size_t offset, int flags, const struct mask_s *mask) {
+    assert(chunk);
+    assert(chunk->data);
+
+    if (offset >= chunk->len)
+	return NULL;
+
+    const char *newline = memchr(chunk->data + offset, '\n', chunk->len - offset);
+    if (!newline || newline + 1 == chunk->data + chunk->len)
+	return NULL;
+
+    const size_t headlen = newline + 1 - chunk->data;
+    struct chunk_s *tail = chunk_alloc(chunk->len - headlen);
+    tail->len = chunk->len - headlen;
+    tail->inlen = tail->len;
+    memcpy(tail->data, chunk->data + headlen, tail->len);
+
+    const char *line = tail->data;
+    const char *p;
+    for (p=tail->data; (p=memchr(p, '\n', tail->data + tail->len - p)); line = ++p) {
+	tail->lines++;
+	// placeholders of spilled lines stand for more bytes of the input
+	const size_t longlen = chunk->inlen != chunk->len? longline_length(line, p + 1 - line): 0;
+	if (longlen)
+	    tail->inlen += longlen - (p + 1 - line);
+    }
+    if ('\n' != tail->data[tail->len - 1])
+	tail->lines++;
+    tail->offset = chunk->offset + chunk->inlen - tail->inlen;
+    tail->hash = chunk_hash(tail->data, tail->len, flags, mask);
+
+    chunk->len = headlen;
+    chunk->inlen -= tail->inlen;
+    chunk->lines -= tail->lines;
+    chunk->data = realloc(chunk->data, chunk->len);
+    assert(chunk->data);
+    chunk->hash = chunk_hash(chunk->data, chunk->len, flags, mask);
+
+    return tail;
+}
+
+/* finish the chunk and hand it over to the consumer.
+ * @return: 0 if the reader has been stopped meanwhile, else 1
+ */
+static int chunkreader_push(struct chunkreader_s *reader, struct chunk_s *chunk) {
+
+    // give back the unused memory
+    chunk->data = realloc(chunk->data, chunk->len);
+    assert(chunk->data);
+    // with flags or mask the hash is chained while reading
+    if (!reader->flags && !reader->mask)
+	chunk->hash = chunk_hash(chunk->data, chunk->len, 0, NULL);
+
+    chunk->inlen += chunk->len;
+    chunk->offset = reader->offset;
+    reader->offset += chunk->inlen;
+    if (reader->index) {
+	const struct chunkindex_entry_s entry = { chunk->offset, chunk->len, chunk->lines, chunk->hash };
+	chunkindex_write(reader->index, &entry);
+    }
+
+    if (!spscring_push(reader->queue, chunk)) {
+	chunk_free(chunk);
+	return 0;
+    }
+
+    return 1;
+}
+
+/* finish the long line and insert its placeholder into the chunk at offset */
+static void chunk_insert_placeholder(struct longline_s *longlines, struct chunk_s *chunk, size_t offset, size_t *capacity) {
+
+    char placeholder[LONGLINE_PLACEHOLDER_LEN];
+    const size_t longlen = longlines->current.len;
+    const size_t len = longline_end(longlines, placeholder);
+    // counted with len when the chunk is pushed
+    chunk->inlen += longlen - len;
+
+    if (chunk->len + len > *capacity) {
+	*capacity = chunk->len + len;
+	chunk->data = realloc(chunk->data, *capacity);
+	assert(chunk->data);
+    }
+    memmove(chunk->data + offset + len, chunk->data + offset, chunk->len - offset);
+    memcpy(chunk->data + offset, placeholder, len);
+    chunk->len += len;
+}
+
+/* hand over the chunks of a valid index, their data is read on demand */
+static void chunkreader_index_thread(struct chunkreader_s *reader) {
+
+    struct chunkindex_entry_s entry;
+    while (chunkindex_read(reader->index, &entry)) {
+	struct chunk_s *chunk = calloc(1, sizeof(*chunk));
+	assert(chunk);
+	chunk->len = entry.len;
+	chunk->inlen = entry.len;
+	chunk->lines = entry.lines;
+	chunk->hash = entry.hash;
+	chunk->offset = entry.offset;
+	if (!spscring_push(reader->queue, chunk)) {
+	    chunk_free(chunk);
+	    break;
+	}
+    }
+    chunkindex_close(reader->index, 0);
+    reader->index = NULL;
+
+    spscring_close(reader->queue);
+}
+
+static void *chunkreader_thread(void *args) {
+    assert(args);
+
+    struct chunkreader_s *reader = (struct chunkreader_s *) args;
+
+    if (reader->indexed) {
+	chunkreader_index_thread(reader);
+	return args;
+    }
+
+    /* Algorithm:
+     * Run a gear hash over every byte. If the hash shows a boundary, the
+     * chunk ends at the next newline character. The gear hash only depends
+     * on the last 64 bytes, so both files find the same boundaries in equal
+     * regions, regardless of the data in front of it.
+     * With compare flags or mask the gear hash runs over the masked and
+     * normalised lines, so lines compared equal lead to the same boundaries.
+     * Only whole lines are scanned. A line not ending within longsize bytes
+     * is moved into the spill file and replaced by a placeholder line, so
+     * the memory per line stays bounded.
+     */
+    const int transform = reader->flags || reader->mask;
+    const size_t minsize = reader->chunksize / 4;
+    const size_t maxsize = reader->chunksize * 4;
+    const size_t readsize = reader->chunksize / 4 + 1;
+    const size_t longsize = MAX(maxsize, CHUNKREADER_LONGLINE_MIN);
+    uint64_t mask = 1;
+    while (mask <= reader->chunksize / 2)
+	mask <<= 1;
+    mask--;
+
+    size_t capacity = 2 * reader->chunksize + readsize;
+    struct chunk_s *chunk = chunk_alloc(capacity);
+    size_t scanned = 0;		// bytes of chunk already scanned for a boundary
+    char *buffer[2] = { NULL, NULL };
+    size_t bufferlen = 0;
+    uint64_t rolling = 0;
+    int boundary = 0;
+    int spilling = 0;	// the line at offset scanned goes to the spill file
+    int running = 1;
+    off_t position = reader->dropped;	// file offset of the next byte read
+
+    while (running) {
+	if (chunk->len + readsize > capacity) {
+	    while (chunk->len + readsize > capacity)
+		capacity *= 2;
+	    chunk->data = realloc(chunk->data, capacity);
+	    assert(chunk->data);
+	}
+
+	const size_t got = reader->uring?
+		uringread_read(reader->uring, chunk->data + chunk->len, readsize):
+		fread(chunk->data + chunk->len, 1, readsize, reader->infile);
+	if (!got) {
+	    if (!reader->uring && ferror(reader->infile)) {
+		fprintf(stderr, "error: reading from input file: %s\n", strerror(errno));
+		abort();
+	    }
+	    break;
+	}
+	chunk->len += got;
+	if (reader->iolimit) {
+	    iolimit_take(reader->iolimit, got);
+	    position += got;
+	    if (position - reader->dropped >= CHUNKREADER_DROP_SIZE) {
+		iolimit_drop(reader->iolimit, fileno(reader->infile), reader->dropped, position - reader->dropped);
+		reader->dropped = position;
+	    }
+	}
+
+	if (spilling) {
+	    // the long line continues up to the next newline character
+	    char *rest = chunk->data + scanned;
+	    const char *newline = memchr(rest, '\n', chunk->len - scanned);
+	    const size_t n = newline? (size_t) (newline + 1 - rest): chunk->len - scanned;
+	    longline_append(reader->longlines, rest, n);
+	    memmove(rest, rest + n, chunk->len - scanned - n);
+	    chunk->len -= n;
+	    if (!newline)
+		continue;
+	    chunk_insert_placeholder(reader->longlines, chunk, scanned, &capacity);
+	    spilling = 0;
+	}
+
+	while (running && scanned < chunk->len) {
+	    size_t cut = 0;
+
+	    if (transform) {
+		const char *line = chunk->data + scanned;
+		const char *newline = memchr(line, '\n', chunk->len - scanned);
+		if (!newline)
+		    break;	// wait for the rest of the line
+		const size_t linelen = newline + 1 - line;
+		size_t len = linelen;
+		const unsigned char *t = (const unsigned char *) chunk_transform_line(line, &len, reader->flags, reader->mask, buffer, &bufferlen);
+		size_t i;
+		for (i=0; i<len; i++) {
+		    rolling = (rolling << 1) + hash_gear[t[i]];
+		    if (!(rolling & mask) && scanned + linelen >= minsize)
+			boundary = 1;
+		}
+		if (len)
+		    chunk->hash = hash_bytes(t, len, chunk->hash);
+		chunk->lines++;
+		scanned += linelen;
+		if (boundary || scanned >= maxsize)
+		    cut = scanned;
+	    }
+	    else {
+		const unsigned char *p = (const unsigned char *) chunk->data;
+		const unsigned char *last = memrchr(p + scanned, '\n', chunk->len - scanned);
+		if (!last)
+		    break;	// wait for the rest of the line
+		const size_t end = last + 1 - p;
+		size_t i;
+		for (i=scanned; i<end; i++) {
+		    rolling = (rolling << 1) + hash_gear[p[i]];
+		    if (!(rolling & mask) && i + 1 >= minsize)
+			boundary = 1;
+		    if ('\n' == p[i]) {
+			chunk->lines++;
+			if (boundary || i + 1 >= maxsize) {
+			    cut = i + 1;
+			    break;
+			}
+		    }
+		}
+		scanned = cut? cut: end;
+	    }
+
+	    if (cut) {
+		// move the data behind the boundary into the next chunk
+		const size_t rest = chunk->len - cut;
+		capacity = 2 * reader->chunksize + rest + readsize;
+		struct chunk_s *next = chunk_alloc(capacity);
+		memcpy(next->data, chunk->data + cut, rest);
+		next->len = rest;
+		chunk->len = cut;
+		running = chunkreader_push(reader, chunk);
+		chunk = next;
+		scanned = 0;
+		boundary = 0;
+	    }
+	}
+
+	if (running && chunk->len - scanned > longsize) {
+	    // the line does not end within longsize bytes, spill it
+	    longline_begin(reader->longlines);
+	    longline_append(reader->longlines, chunk->data + scanned, chunk->len - scanned);
+	    chunk->len = scanned;
+	    spilling = 1;
+	}
+    }
+
+    if (running && spilling)
+	chunk_insert_placeholder(reader->longlines, chunk, scanned, &capacity);
+    if (running && chunk->len) {
+	// last line without newline character at the end of file
+	if (scanned < chunk->len) {
+	    size_t len = chunk->len - scanned;
+	    const char *t = chunk_transform_line(chunk->data + scanned, &len, reader->flags, reader->mask, buffer, &bufferlen);
+	    if (transform && len)
+		chunk->hash = hash_bytes(t, len, chunk->hash);
+	    chunk->lines++;
+	}
+	else if ('\n' != chunk->data[chunk->len - 1])
+	    chunk->lines++;
+	chunkreader_push(reader, chunk);
+    }
+    else
+	chunk_free(chunk);
+    free(buffer[0]);
+    free(buffer[1]);
+    if (reader->iolimit)
+	iolimit_drop(reader->iolimit, fileno(reader->infile), reader->dropped, position - reader->dropped);
+
+    if (reader->index) {
+	// the offsets in the index do not count the long lines
+	chunkindex_close(reader->index, running && !reader->longlines->count);
+	reader->index = NULL;
+    }
+
+    spscring_close(reader->queue);
+
+    return args;
+}
+
+uint64_t chunkreader_index_params(size_t chunksize, int flags, const struct mask_s *mask) {
+
+    const uint64_t params[] = { CHUNKREADER_INDEX_VERSION, chunksize, flags };
+    uint64_t hash = hash_bytes(params, sizeof(params), 0);
+    if (mask)
+	hash = hash_bytes(mask->pattern, strlen(mask->pattern), hash);
+
+    return hash;
+}
+
+struct chunkreader_s *chunkreader_new(FILE *infile, size_t chunksize, int depth, int flags, const struct mask_s *mask, struct chunkindex_s *index, struct iolimit_s *iolimit) {
+    assert(infile);
+    assert(chunksize > 0);
+    assert(depth > 0);
+
+    struct chunkreader_s *reader = calloc(1, sizeof(*reader));
+    assert(reader);
+    reader->infile = infile;
+    reader->chunksize = chunksize;
+    reader->depth = depth;
+    reader->flags = flags;
+    reader->mask = mask;
+    reader->index = index;
+    reader->indexed = index && chunkindex_reading(index);
+    reader->iolimit = iolimit;
+    // nothing has been read from infile yet, so nothing is buffered by stdio
+    const off_t start = ftello(infile);
+    reader->dropped = MAX(0, start);
+    if (!reader->indexed)
+	reader->uring = uringread_new(fileno(infile), start, CHUNKREADER_URING_BLOCKSIZE, CHUNKREADER_URING_DEPTH);
+    reader->queue = spscring_new(depth);
+    reader->longlines = longline_new();
+
+    int retval = pthread_create(&reader->thread, NULL, chunkreader_thread, reader);
+    if (retval) {
+	fprintf(stderr, "error: can not create thread: %s\n", strerror(retval));
+	abort();
+    }
+
+    return reader;
+}
+
+void chunkreader_delete(struct chunkreader_s *reader) {
+    assert(reader);
+
+    spscring_cancel(reader->queue);
+
+    int retval = pthread_join(reader->thread, NULL);
+    if (retval) {
+	fprintf(stderr, "error: can not join thread: %s\n", strerror(retval));
+	abort();
+    }
+
+    struct chunk_s *chunk;
+    // the thread has closed the ring on exit
+    while (NULL != (chunk = spscring_pop(reader->queue)))
+	chunk_free(chunk);
+    if (reader->uring)
+	uringread_delete(reader->uring);
+    spscring_delete(reader->queue);
+    longline_delete(reader->longlines);
+
+    free(reader);
+}
+
+struct chunk_s *chunkreader_get(struct chunkreader_s *reader) {
+    assert(reader);
+
+    return spscring_pop(reader->queue);
+}
+
+/* compare two lists of chunks byte by byte.
+ * @return: 1 if the lists are the same, else 0
+ */
+static int chunk_lists_identical(const struct chunk_list_s *listA, const struct chunk_list_s *listB) {
+
+    const struct chunk_s *chunkA = STAILQ_FIRST(listA);
+    const struct chunk_s *chunkB = STAILQ_FIRST(listB);
+    size_t offsetA = 0, offsetB = 0;
+
+    // the chunk boundaries of A and B need not be the same
+    while (chunkA && chunkB) {
+	const size_t len = MIN(chunkA->len - offsetA, chunkB->len - offsetB);
+	if (memcmp(chunkA->data + offsetA, chunkB->data + offsetB, len))
+	    return 0;
+	offsetA += len;
+	offsetB += len;
+	if (offsetA == chunkA->len) {
+	    chunkA = STAILQ_NEXT(chunkA, entries);
+	    offsetA = 0;
+	}
+	if (offsetB == chunkB->len) {
+	    chunkB = STAILQ_NEXT(chunkB, entries);
+	    offsetB = 0;
+	}
+    }
+
+    return !chunkA && !chunkB;
+}
+
+int chunk_lists_compare_trivial(const struct chunk_list_s *listA, const struct chunk_list_s *listB, long lines[2]) {
+    assert(listA);
+    assert(listB);
+    assert(lines);
+
+    const struct chunk_list_s *list[2] = { listA, listB };
+    size_t bytes[2];
+    int i;
+
+    for (i=0; i<2; i++) {
+	const struct chunk_s *chunk;
+	bytes[i] = lines[i] = 0;
+	STAILQ_FOREACH(chunk, list[i], entries) {
+	    assert(chunk->data);
+	    bytes[i] += chunk->len;
+	    lines[i] += chunk->lines;
+	}
+    }
+
+    if (bytes[0] == bytes[1] && chunk_lists_identical(listA, listB))
+	return CHUNK_LISTS_SAME;
+    if (!bytes[0] || !bytes[1])
+	return CHUNK_LISTS_ONE_EMPTY;
+    return CHUNK_LISTS_DIFFER;
+}
@@ -0,0 +1,155 @@
+/*
+ * chunkreader.h
+ *
+ *  Created on: 18.10.2026
+ *      Author: jh
+ */
+
+/*
+    Reader thread splitting an input stream into blocks of whole lines
+
+    Copyright (C) 2017  Jörg Habenicht (jh@mwerk.net)
+
+    This file is part of lfdiff
+
+    lfdiff is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    lfdiff is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef SRC_ANSIC_CHUNKREADER_H_
+#define SRC_ANSIC_CHUNKREADER_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/queue.h>
+#include <sys/types.h>
+
+struct mask_s;
+struct uringread_s;
+struct spscring_s;
+struct longline_s;
+struct chunkindex_s;
+struct iolimit_s;
+
+
+/* a block of whole lines read from one input file.
+ * The block boundaries depend on the content only (not on the position in
+ * the file), so equal regions of two files produce equal blocks even if the
+ * regions are shifted against each other.
+ */
+struct chunk_s
+{
+    STAILQ_ENTRY(chunk_s) entries;	/* list of chunks */
+    char *data;		// content, not NUL terminated. NULL until chunkreader_load() if taken from the index
+    size_t len;		// length of content in bytes
+    size_t inlen;	// bytes read from the input file, more than len if long lines are spilled
+    long lines;		// number of lines in this chunk
+    uint64_t hash;	// hash over content, compare with chunk_equal()
+    off_t offset;	// position in input file
+};
+
+STAILQ_HEAD(chunk_list_s, chunk_s);
+
+struct chunkreader_s
+{
+    FILE *infile;
+    struct uringread_s *uring;	// asynchronous reads of infile, NULL to use stdio
+    size_t chunksize;	// average size of one chunk
+    int depth;		// max number of chunks read ahead
+    int flags;		// HASH_IGNORE_* flags to hash the chunks
+    const struct mask_s *mask;	// regions of lines to mask before hashing
+    pthread_t thread;
+    struct spscring_s *queue;	// chunks read ahead, closed at end of input
+    struct longline_s *longlines;	// spill file of the long lines of infile
+    struct chunkindex_s *index;	// index of infile read or written by the thread, NULL if none
+    int indexed;	// chunks are taken from a valid index, their data is read on demand
+    off_t offset;	// bytes of infile put into chunks
+    unsigned long long loaded;	// bytes read by chunkreader_load()
+    struct iolimit_s *iolimit;	// rate limit of the reads, NULL for none
+    off_t dropped;	// file offset up to which the pages were dropped
+};
+
+
+/** get the parameters of a chunk index, see chunkindex_open().
+ * The chunks are cut and hashed the same way if these are equal.
+ */
+uint64_t chunkreader_index_params(size_t chunksize, int flags, const struct mask_s *mask);
+
+/** start a reader thread on the given input.
+ * With an index opened for reading the chunks are taken from the index,
+ * without reading the file. An index opened for writing is written while
+ * the file is read.
+ *
+ * @param infile: input stream, must stay open until chunkreader_delete()
+ * @param chunksize: average chunk size in bytes
+ * @param depth: number of chunks the reader may read ahead
+ * @param flags: HASH_IGNORE_* flags to compare the chunks with
+ * @param mask: mask to apply before comparing the chunks, may be NULL
+ * @param index: index of infile read from its start, NULL for none. It is
+ *   closed by the reader.
+ * @param iolimit: rate limit shared with the other readers, NULL for none
+ * @return: reader handler
+ */
+struct chunkreader_s *chunkreader_new(FILE *infile, size_t chunksize, int depth, int flags, const struct mask_s *mask, struct chunkindex_s *index, struct iolimit_s *iolimit);
+
+/** stop the reader thread and free the read ahead chunks. */
+void chunkreader_delete(struct chunkreader_s *reader);
+
+/** get the next chunk of the input.
+ * Blocks until the reader thread has a chunk available.
+ *
+ * @return: chunk, must be released with chunk_free(). NULL on end of input.
+ */
+struct chunk_s *chunkreader_get(struct chunkreader_s *reader);
+
+/** read the data of a chunk taken from the index.
+ * Does nothing if the data is there already.
+ */
+void chunkreader_load(struct chunkreader_s *reader, struct chunk_s *chunk);
+
+void chunk_free(struct chunk_s *chunk);
+
+/** split a chunk behind the line at the given position.
+ * @param chunk: chunk to split, keeps the lines up to position offset
+ * @param offset: position in chunk, counting from 0
+ * @param flags: HASH_IGNORE_* flags, the same the chunk was read with
+ * @param mask: mask, the same the chunk was read with
+ * @return: new chunk with the following lines, NULL if there are none
+ */
+struct chunk_s *chunk_split(struct chunk_s *chunk, size_t offset, int flags, const struct mask_s *mask);
+
+/** compare content of two chunks.
+ * A chunk taken from the index is compared by its hash only.
+ * @param flags: HASH_IGNORE_* flags, the same the chunks were read with
+ * @param mask: mask, the same the chunks were read with
+ * @return: 1 if equal, 0 if different
+ */
+int chunk_equal(const struct chunk_s *a, const struct chunk_s *b, int flags, const struct mask_s *mask);
+
+/* how chunk_lists_compare_trivial() finds two lists of chunks */
+enum {
+    CHUNK_LISTS_DIFFER = 0,	// the lines have to be compared
+    CHUNK_LISTS_SAME,		// the lists hold the same bytes
+    CHUNK_LISTS_ONE_EMPTY,	// one list is empty, all lines of the other differ
+};
+
+/** compare two lists of chunks if the result is known without comparing
+ * their lines. The data of the chunks must be loaded.
+ * @param lines: set to the number of lines of list A and B
+ * @return: CHUNK_LISTS_*
+ */
+int chunk_lists_compare_trivial(const struct chunk_list_s *listA, const struct chunk_list_s *listB, long lines[2]);
+
+#endif /* SRC_ANSIC_CHUNKREADER_H_ */
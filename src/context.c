@@ -0,0 +1,232 @@
+/*
+ * context.c
+ *
+ *  Created on: 18.10.2026
+ *      Author: jh
+ */
+
+/*
+    Context lines of the unified output
+
+    Copyright (C) 2017  Jörg Habenicht (jh@mwerk.net)
+
+    This file is part of lfdiff
+
+    lfdiff is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    lfdiff is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#define _GNU_SOURCE
+#include "context.h"
+#include "diffmanager.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <stdint.h>
+
+
+#define MIN(a,b)	((a)<(b)?(a):(b))
+#define MAX(a,b)	((a)>(b)?(a):(b))
+
+
+struct context_s *context_new(struct diffmanager_s *manager, long lines) {
+    assert(manager);
+    assert(lines >= 0);
+
+    struct context_s *context = calloc(1, sizeof(*context));
+    assert(context);
+    context->manager = manager;
+    context->lines = lines;
+    if (lines) {
+	context->ring = calloc(lines, sizeof(*context->ring));
+	context->ringlen = calloc(lines, sizeof(*context->ringlen));
+	context->ringsize = calloc(lines, sizeof(*context->ringsize));
+	assert(context->ring);
+	assert(context->ringlen);
+	assert(context->ringsize);
+    }
+
+    return context;
+}
+
+void context_delete(struct context_s *context) {
+    assert(context);
+
+    long i;
+    for (i=0; i<context->lines; i++)
+	free(context->ring[i]);
+    free(context->ring);
+    free(context->ringlen);
+    free(context->ringsize);
+    free(context->hunk);
+    free(context);
+}
+
+void context_add_hunk(struct context_s *context, long first, long last) {
+    assert(context);
+    assert(first > context->line);
+    assert(last >= first - 1);
+
+    if (!context->lines)
+	return;
+
+    if (context->hunks == context->size) {
+	context->size = context->size? 2 * context->size: 64;
+	context->hunk = realloc(context->hunk, context->size * sizeof(*context->hunk));
+	assert(context->hunk);
+    }
+    context->hunk[context->hunks].first = first;
+    context->hunk[context->hunks].last = last;
+    context->hunks++;
+}
+
+/* hand line n over to the diffmanager, once */
+static void context_keep(struct context_s *context, long n, const char *line, size_t len) {
+
+    if (n > context->kept) {
+	diffmanager_input_context(context->manager, line, len, n);
+	context->kept = n;
+    }
+}
+
+/* copy line n into the ring */
+static void context_ring_put(struct context_s *context, long n, const char *line, size_t len) {
+
+    const long slot = n % context->lines;
+    if (len > context->ringsize[slot]) {
+	context->ringsize[slot] = len;
+	context->ring[slot] = realloc(context->ring[slot], len);
+	assert(context->ring[slot]);
+    }
+    memcpy(context->ring[slot], line, len);
+    context->ringlen[slot] = len;
+}
+
+void context_pass(struct context_s *context, const char *data, size_t len, long lines) {
+    assert(context);
+    assert(data || !len);
+
+    const long n = context->lines;
+    const long first = context->line + 1;
+    const long last = context->line + lines;
+
+    if (!n || !lines) {
+	context->line = last;
+	return;
+    }
+
+    // the lines in front of the next hunk have passed already, if any
+    if (context->next < context->hunks && context->hunk[context->next].first - n < first) {
+	long nr;
+	for (nr=MAX(MAX(context->hunk[context->next].first - n, first - n), 1); nr<first; nr++) {
+	    const long slot = nr % n;
+	    context_keep(context, nr, context->ring[slot], context->ringlen[slot]);
+	}
+    }
+
+    // keep the lines up to n lines behind the hunks reached
+    const char *line = data;
+    const char * const end = data + len;
+    long nr;
+    for (nr=first; nr<=last; nr++) {
+	while (context->next < context->hunks && context->hunk[context->next].first - n <= nr) {
+	    context->until = MAX(context->until, context->hunk[context->next].last + n);
+	    context->next++;
+	}
+	if (nr > context->until
+		&& (context->next == context->hunks || context->hunk[context->next].first - n > last))
+	    break;	// no more lines to keep in data
+
+	const char *newline = memchr(line, '\n', end - line);
+	const char *next = newline? newline + 1: end;
+	if (nr <= context->until)
+	    context_keep(context, nr, line, next - line);
+	line = next;
+    }
+    if (context->next == context->hunks)
+	context->next = context->hunks = 0;
+
+    // the last lines go into the ring, searching backwards from the end
+    const char *next = end;
+    for (nr=last; nr>MAX(last - n, first - 1); nr--) {
+	// skip the newline character ending the line
+	const size_t scan = next - data - (next > data && '\n' == next[-1]? 1: 0);
+	const char *newline = memrchr(data, '\n', scan);
+	line = newline? newline + 1: data;
+	context_ring_put(context, nr, line, next - line);
+	next = line;
+    }
+
+    context->line = last;
+}
+
+/* write or read count bytes of a checkpoint, abort on error */
+static void context_write(const void *data, size_t count, FILE *file) {
+    if (count && 1 != fwrite(data, count, 1, file)) {
+	fprintf(stderr, "error: writing checkpoint: %s\n", strerror(errno));
+	abort();
+    }
+}
+
+static void context_read(void *data, size_t count, FILE *file) {
+    if (count && 1 != fread(data, count, 1, file)) {
+	fprintf(stderr, "error: reading checkpoint: %s\n", ferror(file)? strerror(errno): "file truncated");
+	abort();
+    }
+}
+
+void context_save(const struct context_s *context, FILE *file) {
+    assert(context);
+    assert(context->next == context->hunks);
+
+    const int64_t state[] = { context->line, context->until, context->kept };
+    context_write(state, sizeof(state), file);
+
+    // the ring holds the last lines passed
+    long nr;
+    for (nr=MAX(context->line - context->lines + 1, 1); nr<=context->line; nr++) {
+	const long slot = nr % context->lines;
+	const uint64_t len = context->ringlen[slot];
+	context_write(&len, sizeof(len), file);
+	context_write(context->ring[slot], len, file);
+    }
+}
+
+void context_load(struct context_s *context, FILE *file) {
+    assert(context);
+    assert(!context->line);
+
+    int64_t state[3];
+    context_read(state, sizeof(state), file);
+    context->line = state[0];
+    context->until = state[1];
+    context->kept = state[2];
+
+    long nr;
+    for (nr=MAX(context->line - context->lines + 1, 1); nr<=context->line; nr++) {
+	const long slot = nr % context->lines;
+	uint64_t len;
+	context_read(&len, sizeof(len), file);
+	if (len > context->ringsize[slot]) {
+	    context->ringsize[slot] = len;
+	    context->ring[slot] = realloc(context->ring[slot], len);
+	    assert(context->ring[slot]);
+	}
+	context_read(context->ring[slot], len, file);
+	context->ringlen[slot] = len;
+    }
+}
@@ -0,0 +1,98 @@
+/*
+ * context.h
+ *
+ *  Created on: 18.10.2026
+ *      Author: jh
+ */
+
+/*
+    Context lines of the unified output
+
+    Copyright (C) 2017  Jörg Habenicht (jh@mwerk.net)
+
+    This file is part of lfdiff
+
+    lfdiff is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    lfdiff is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#ifndef SRC_ANSIC_CONTEXT_H_
+#define SRC_ANSIC_CONTEXT_H_
+
+#include <stddef.h>
+#include <stdio.h>
+
+
+struct diffmanager_s;
+
+/* lines of file A touched by one hunk of the "diff" output */
+struct context_hunk_s {
+    long first;
+    long last;		// first-1 if lines are only added behind line first-1
+};
+
+/* The lines of file A pass by in order, either as equal chunks or as the
+ * chunks fed to "diff". Only the lines around the hunks are kept as context,
+ * the last lines passed are held in a small ring for the hunks found in the
+ * following chunks. Works on pipes, nothing is read twice.
+ */
+struct context_s {
+    struct diffmanager_s *manager;	// receives the context lines
+    long lines;		// context lines before and after each hunk
+    long line;		// lines of A passed so far
+    long until;		// keep the lines up to this one
+    long kept;		// last line kept
+    struct context_hunk_s *hunk;	// hunks not reached yet
+    size_t hunks;	// number of hunks
+    size_t next;	// next hunk not reached
+    size_t size;	// allocated hunks
+    /* the last lines passed, line n in slot n % lines */
+    char **ring;
+    size_t *ringlen;
+    size_t *ringsize;
+};
+
+
+/** start collecting the context lines of file A.
+ * @param manager: gets the lines by diffmanager_input_context()
+ * @param lines: context lines before and after each hunk
+ */
+struct context_s *context_new(struct diffmanager_s *manager, long lines);
+void context_delete(struct context_s *context);
+
+/** add the next hunk of the "diff" output.
+ * Hunks are added in order, before their lines are passed.
+ *
+ * @param first: first line of A in hunk
+ * @param last: last line of A in hunk, first-1 if lines are added only
+ */
+void context_add_hunk(struct context_s *context, long first, long last);
+
+/** pass the next lines of A.
+ * @param data: whole lines, the last one may miss the newline character
+ * @param len: bytes in data
+ * @param lines: lines in data
+ */
+void context_pass(struct context_s *context, const char *data, size_t len, long lines);
+
+/** write the state to a checkpoint file.
+ * All hunks added must have been reached by the lines passed.
+ */
+void context_save(const struct context_s *context, FILE *file);
+
+/** read the state written by context_save() into a new context. */
+void context_load(struct context_s *context, FILE *file);
+
+#endif /* SRC_ANSIC_CONTEXT_H_ */
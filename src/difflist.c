@@ -28,16 +28,290 @@
 */
 
 #include "difflist.h"
+#include "intern.h"
+#include "lineruns.h"
+#include "config.h"
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <stdint.h>
 #include <assert.h>
+#include <sys/mman.h>
+
+#if defined(HAVE_LIBZ) && defined(HAVE_ZLIB_H)
+#include <zlib.h>
+#define DIFFLIST_COMPRESSION
+#endif
+
+// bytes of line texts packed into one segment
+#define DIFF_SEGMENT_SIZE	(256*1024)
+
+// nodes are allocated in pages of this size and alignment
+#define DIFF_PAGE_SIZE	(1024*1024)
+
+/* page of nodes, freed when the last of its nodes is freed */
+struct diff_page_s
+{
+    LIST_ENTRY(diff_page_s) entries;	// in the pages of the list with released nodes
+    long live;		// nodes in use
+    size_t used;	// nodes handed out
+    struct diff_iterator *free;	// released nodes, linked by their next pointer
+    struct diff_iterator knot[];
+};
+
+#define DIFF_PAGE_NODES	((DIFF_PAGE_SIZE - sizeof(struct diff_page_s)) / sizeof(struct diff_iterator))
+
+static void diff_insert(struct diff_list_s *list, struct diff_iterator *knot);
+
+/* line text can be moved into a segment */
+static int diff_is_packable(const struct diff_iterator *knot) {
+    return (DIFF_LINE_OWNED == knot->store && knot->line) || DIFF_LINE_BLOCK == knot->store;
+}
+
+static void diff_segment_unref(struct diff_segment_s *segment) {
+    assert(segment->refcount > 0);
+
+    if (!--segment->refcount) {
+	if (segment->list->cached == segment)
+	    segment->list->cached = NULL;
+	free(segment->data);
+	free(segment);
+    }
+}
+
+/* free the line text of a node */
+static void diff_free_line(struct diff_list_s *list, struct diff_iterator *knot) {
+    if (diff_is_packable(knot))
+	list->hotbytes -= knot->len;
+
+    switch (knot->store) {
+    case DIFF_LINE_PACKED:
+	diff_segment_unref(knot->segment);
+	break;
+    case DIFF_LINE_BLOCK:
+	diff_block_unref(knot->block);
+	break;
+    case DIFF_LINE_INTERNED:
+	intern_put(list->intern, knot->line);
+	break;
+    default:
+	free(knot->line);
+    }
+}
+
+/* map a page aligned to its size, the node finds its page by the address */
+static struct diff_page_s *diff_page_new(void) {
+    char *map = mmap(NULL, 2*DIFF_PAGE_SIZE, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    if (MAP_FAILED == map) {
+	perror("error: can not allocate diff list page");
+	abort();
+    }
+
+    // unmap the unaligned parts
+    char *page = (char *) (((uintptr_t) map + DIFF_PAGE_SIZE - 1) & ~(uintptr_t) (DIFF_PAGE_SIZE - 1));
+    if (page != map)
+	munmap(map, page - map);
+    munmap(page + DIFF_PAGE_SIZE, map + DIFF_PAGE_SIZE - page);
+
+    return (struct diff_page_s *) page;
+}
+
+static void diff_page_free(struct diff_page_s *page) {
+    if (page)
+	munmap(page, DIFF_PAGE_SIZE);
+}
+
+/* get a cleared node, a released one before a new one from the page of the list */
+static struct diff_iterator *diff_alloc_knot(struct diff_list_s *list) {
+    struct diff_page_s *page = LIST_FIRST(&list->freepages);
+    struct diff_iterator *knot;
+
+    if (page) {
+	knot = page->free;
+	if (!(page->free = TAILQ_NEXT(knot, entries)))
+	    LIST_REMOVE(page, entries);
+    }
+    else {
+	page = list->page;
+	if (!page || DIFF_PAGE_NODES == page->used) {
+	    // the full page is freed with its last node
+	    page = diff_page_new();
+	    page->live = 0;
+	    page->used = 0;
+	    page->free = NULL;
+	    list->page = page;
+	    list->pages++;
+	}
+	knot = &page->knot[page->used++];
+    }
+
+    memset(knot, 0, sizeof(*knot));
+    page->live++;
+
+    return knot;
+}
+
+/* free the line text and the node, the node must be unlinked */
+static void diff_release_knot(struct diff_list_s *list, struct diff_iterator *knot) {
+    struct diff_page_s *page = (struct diff_page_s *) ((uintptr_t) knot & ~(uintptr_t) (DIFF_PAGE_SIZE - 1));
+
+    diff_free_line(list, knot);
+
+    assert(page->live > 0);
+    if (!--page->live) {
+	if (page->free)
+	    LIST_REMOVE(page, entries);
+	page->free = NULL;
+	if (page == list->page)
+	    // start over
+	    page->used = 0;
+	else {
+	    diff_page_free(page);
+	    list->pages--;
+	}
+    }
+    else {
+	// reused before a new page is taken
+	if (!page->free)
+	    LIST_INSERT_HEAD(&list->freepages, page, entries);
+	TAILQ_NEXT(knot, entries) = page->free;
+	page->free = knot;
+    }
+}
+
+/* unlink a node and free it */
+static void diff_free_knot(struct diff_list_s *list, struct diff_iterator *knot) {
+    if (list->packed == knot)
+	list->packed = TAILQ_PREV(knot, listhead, entries);
+    lineruns_remove(list->runs, knot->n, TAILQ_NEXT(knot, entries));
+    TAILQ_REMOVE(&list->head, knot, entries);
+    diff_release_knot(list, knot);
+}
+
+#ifdef DIFFLIST_COMPRESSION
+
+/* pack the oldest lines not packed yet into one segment */
+static void diff_pack_segment(struct diff_list_s *list) {
+    struct diff_iterator *first, *last, *it;
+
+    first = list->packed? TAILQ_NEXT(list->packed, entries): TAILQ_FIRST(&list->head);
+    if (!first)
+	return;
+
+    size_t rawlen = 0;
+    long lines = 0;
+    last = first;
+    for (it = first; it && rawlen < DIFF_SEGMENT_SIZE; it = TAILQ_NEXT(it, entries)) {
+	if (diff_is_packable(it)) {
+	    rawlen += it->len;
+	    lines++;
+	}
+	last = it;
+    }
+    list->packed = last;
+    if (!lines)
+	return;
+
+    char *raw = malloc(rawlen);
+    assert(raw);
+    size_t offset = 0;
+    for (it = first; it != TAILQ_NEXT(last, entries); it = TAILQ_NEXT(it, entries)) {
+	if (diff_is_packable(it)) {
+	    memcpy(&raw[offset], it->line, it->len);
+	    offset += it->len;
+	}
+    }
+
+    struct diff_segment_s *segment = calloc(1, sizeof(*segment));
+    assert(segment);
+    uLongf len = compressBound(rawlen);
+    segment->data = malloc(len);
+    assert(segment->data);
+    int retval = compress2(segment->data, &len, (const Bytef *) raw, rawlen, list->level);
+    if (Z_OK != retval) {
+	fprintf(stderr, "error: can not pack diff lines: %s\n", zError(retval));
+	abort();
+    }
+    free(raw);
+    segment->data = realloc(segment->data, len);
+    assert(segment->data);
+    segment->len = len;
+    segment->rawlen = rawlen;
+    segment->list = list;
+
+    // the lines refer to the segment from now on
+    offset = 0;
+    for (it = first; it != TAILQ_NEXT(last, entries); it = TAILQ_NEXT(it, entries)) {
+	if (diff_is_packable(it)) {
+	    diff_free_line(list, it);
+	    it->store = DIFF_LINE_PACKED;
+	    it->segment = segment;
+	    it->offset = offset;
+	    offset += it->len;
+	    segment->refcount++;
+	}
+    }
+
+    list->packedlines += lines;
+    list->rawbytes += rawlen;
+    list->packedbytes += len;
+}
+
+/* unpack the segment into the cache of its list */
+static const char *diff_segment_unpack(struct diff_segment_s *segment) {
+    struct diff_list_s *list = segment->list;
+
+    if (list->cached != segment) {
+	if (list->cachesize < segment->rawlen) {
+	    list->cachesize = DIFF_SEGMENT_SIZE > segment->rawlen? DIFF_SEGMENT_SIZE: segment->rawlen;
+	    free(list->cache);
+	    list->cache = malloc(list->cachesize);
+	    assert(list->cache);
+	}
+	uLongf rawlen = segment->rawlen;
+	int retval = uncompress((Bytef *) list->cache, &rawlen, segment->data, segment->len);
+	if (Z_OK != retval || rawlen != segment->rawlen) {
+	    fprintf(stderr, "error: can not unpack diff lines: %s\n", zError(retval));
+	    abort();
+	}
+	list->cached = segment;
+    }
+
+    return list->cache;
+}
+
+#else
+
+static void diff_pack_segment(struct diff_list_s *list) {
+    (void) list;
+}
+
+static const char *diff_segment_unpack(struct diff_segment_s *segment) {
+    (void) segment;
+    abort();
+}
+
+#endif
+
+/* pack lines while too many of them are unpacked */
+static void diff_pack(struct diff_list_s *list) {
+    while (list->level && list->hotbytes > list->hotlimit) {
+	struct diff_iterator *packed = list->packed;
+	diff_pack_segment(list);
+	if (packed == list->packed)
+	    // at the end of the list
+	    break;
+    }
+}
 
 struct diff_list_s *diff_new(void) {
     struct diff_list_s *list = calloc(1, sizeof(*list));
     assert(list);
     TAILQ_INIT(&list->head);
+    LIST_INIT(&list->freepages);
     list->tqh_current = NULL;
+    list->runs = lineruns_new();
 
     return list;
 }
@@ -48,21 +322,85 @@ void diff_delete(struct diff_list_s *list) {
     struct diff_iterator *entry;
     while ( NULL != (entry = TAILQ_FIRST(&list->head)) ) {
 	TAILQ_REMOVE(&list->head, entry, entries);
-	free(entry->line);
-	free(entry);
+	diff_release_knot(list, entry);
     }
 
+    lineruns_delete(list->runs);
+    diff_page_free(list->page);
+    free(list->cache);
     free(list);
 }
 
 
 void diff_add_line(struct diff_list_s *list, long n, char *line) {
+    diff_add_hashed_line(list, n, line, 0);
+}
+
+void diff_add_hashed_line(struct diff_list_s *list, long n, char *line, uint64_t hash) {
     assert(list);
 
-    struct diff_iterator *knot = calloc(1, sizeof(*knot));
-    assert(knot);
+    struct diff_iterator *knot = diff_alloc_knot(list);
     knot->line = line;
+    knot->len = line? strlen(line): 0;
     knot->n = n;
+    knot->hash = hash;
+    diff_insert(list, knot);
+}
+
+void diff_add_block_line(struct diff_list_s *list, long n, struct diff_block_s *block, const char *line, size_t len, uint64_t hash) {
+    assert(list);
+    assert(block);
+    assert(line >= block->data && line + len <= block->data + block->len);
+
+    struct diff_iterator *knot = diff_alloc_knot(list);
+    knot->line = (char *) line;
+    knot->len = len;
+    knot->block = block;
+    knot->store = DIFF_LINE_BLOCK;
+    knot->n = n;
+    knot->hash = hash;
+    diff_block_ref(block);
+    diff_insert(list, knot);
+}
+
+void diff_add_interned_line(struct diff_list_s *list, long n, const char *line, size_t len, uint64_t hash) {
+    assert(list);
+    assert(list->intern);
+
+    struct diff_iterator *knot = diff_alloc_knot(list);
+    knot->line = (char *) intern_get(list->intern, line, len);
+    knot->len = len;
+    knot->store = DIFF_LINE_INTERNED;
+    knot->n = n;
+    knot->hash = hash;
+    diff_insert(list, knot);
+}
+
+int diff_set_compression(struct diff_list_s *list, int level, size_t hotlimit) {
+    assert(list);
+    assert(level >= 0 && level <= 9);
+
+#ifdef DIFFLIST_COMPRESSION
+    list->level = level;
+    list->hotlimit = hotlimit;
+    diff_pack(list);
+    return 0;
+#else
+    (void) hotlimit;
+    return level? -1: 0;
+#endif
+}
+
+void diff_set_intern(struct diff_list_s *list, struct intern_s *intern) {
+    assert(list);
+    assert(TAILQ_EMPTY(&list->head));
+
+    list->intern = intern;
+}
+
+/* insert the node sorted by line number */
+static void diff_insert(struct diff_list_s *list, struct diff_iterator *knot) {
+    const long n = knot->n;
 
     struct diff_iterator *iterator;
     if (NULL != (iterator = list->tqh_current)) {
@@ -91,6 +429,12 @@ void diff_add_line(struct diff_list_s *list, long n, char *line) {
 	TAILQ_INSERT_HEAD(&list->head, knot, entries);
     }
     list->tqh_current = knot;
+    lineruns_add(list->runs, n, knot);
+
+    if (diff_is_packable(knot)) {
+	list->hotbytes += knot->len;
+	diff_pack(list);
+    }
 }
 
 void diff_remove_line(struct diff_list_s *list, long n) {
@@ -108,14 +452,30 @@ void diff_remove_line(struct diff_list_s *list, long n) {
 		list->tqh_current = TAILQ_PREV(iterator, listhead, entries);
 	    }
 
-	    TAILQ_REMOVE(&list->head, iterator, entries);
-
-	    free(iterator->line);
-	    free(iterator);
+	    diff_free_knot(list, iterator);
 	}
     }
 }
 
+void diff_truncate(struct diff_list_s *list, long n) {
+    assert(list);
+
+    int current = 0;	// current node removed
+    struct diff_iterator *knot;
+    while (NULL != (knot = TAILQ_FIRST(&list->head)) && knot->n <= n) {
+	if (list->tqh_current == knot)
+	    current = 1;
+	if (list->packed == knot)
+	    list->packed = NULL;
+	TAILQ_REMOVE(&list->head, knot, entries);
+	diff_release_knot(list, knot);
+    }
+    if (current)
+	list->tqh_current = TAILQ_FIRST(&list->head);
+
+    lineruns_truncate(list->runs, n, TAILQ_FIRST(&list->head));
+}
+
 struct diff_iterator *diff_iterator_get_first(struct diff_list_s *list) {
     assert(list);
 
@@ -137,14 +497,23 @@ struct diff_iterator *diff_iterator_get_current(struct diff_list_s *list) {
 struct diff_iterator *diff_iterator_get_line(struct diff_list_s *list, long n) {
     assert(list);
 
-    if (list->tqh_current) {
-	diff_iterator_go_equal_before_line(&list->tqh_current, n);
-	assert(list->tqh_current);
-	if (n == list->tqh_current->n)
-	    return list->tqh_current;
-    }
-
-    return NULL;
+    // search the run of line n, the lines of a run are consecutive nodes
+    int64_t first;
+    struct diff_iterator *knot = lineruns_find_node(list->runs, n, &first);
+    if (!knot)
+	return NULL;
+
+    // walk from the current node if it is nearer
+    struct diff_iterator *current = list->tqh_current;
+    if (current && current->n >= first && labs(current->n - n) < n - first)
+	knot = current;
+    while (knot->n < n)
+	knot = TAILQ_NEXT(knot, entries);
+    while (knot->n > n)
+	knot = TAILQ_PREV(knot, listhead, entries);
+    assert(knot->n == n);
+
+    return list->tqh_current = knot;
 }
 
 void diff_next(struct diff_list_s *list) {
@@ -220,25 +589,94 @@ void diff_iterator_go_equal_after_line(struct diff_iterator **iterator, long n)
     }
 }
 
+int diff_get_run(struct diff_list_s *list, long n, long *first, long *last) {
+    assert(list);
+
+    int64_t runfirst, runlast;
+    if (!lineruns_find(list->runs, n, &runfirst, &runlast))
+	return 0;
+
+    if (first)
+	*first = runfirst;
+    if (last)
+	*last = runlast;
+    return 1;
+}
+
+int diff_get_next_line_nr(struct diff_list_s *list, long n, long *next) {
+    assert(list);
+    assert(next);
+
+    int64_t line;
+    if (!lineruns_next(list->runs, n, &line))
+	return 0;
+
+    *next = line;
+    return 1;
+}
+
 const char *diff_get_line(struct diff_iterator *iterator) {
     assert(iterator);
 
+    if (DIFF_LINE_PACKED == iterator->store)
+	return diff_segment_unpack(iterator->segment) + iterator->offset;
     return iterator->line;
 }
 
+size_t diff_get_line_len(struct diff_iterator *iterator) {
+    assert(iterator);
+
+    return iterator->len;
+}
+
 long diff_get_line_nr(struct diff_iterator *iterator) {
     assert(iterator);
 
     return iterator->n;
 }
 
+uint64_t diff_get_hash(struct diff_iterator *iterator) {
+    assert(iterator);
+
+    return iterator->hash;
+}
+
 /* print function for debugging purpose */
 void diff_print(struct diff_list_s *list) {
     assert(list);
 
     struct diff_iterator *iterator;
     TAILQ_FOREACH(iterator, &list->head, entries) {
-	printf("%ld:%s", iterator->n, iterator->line);
+	printf("%ld:%.*s", iterator->n, (int) iterator->len, diff_get_line(iterator));
+    }
+}
+
+
+struct diff_block_s *diff_block_new(size_t capacity) {
+    struct diff_block_s *block = calloc(1, sizeof(*block));
+    assert(block);
+    block->data = malloc(capacity);
+    assert(block->data);
+    block->capacity = capacity;
+    block->refcount = 1;
+
+    return block;
+}
+
+void diff_block_ref(struct diff_block_s *block) {
+    assert(block);
+    assert(block->refcount > 0);
+
+    block->refcount++;
+}
+
+void diff_block_unref(struct diff_block_s *block) {
+    assert(block);
+    assert(block->refcount > 0);
+
+    if (!--block->refcount) {
+	free(block->data);
+	free(block);
     }
 }
 
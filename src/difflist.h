@@ -31,19 +31,86 @@
 #define SRC_ANSIC_DIFFLIST_H_
 
 #include <sys/queue.h>
+#include <stdint.h>
+#include <stddef.h>
 
 
+/* block of "diff" output, stored lines may point into it.
+ * The block is freed when the last reference has been dropped.
+ */
+struct diff_block_s
+{
+    char *data;
+    size_t len;		// bytes used in data
+    size_t capacity;	// bytes allocated for data
+    long refcount;
+};
+
+
+struct diff_list_s;
+
+/* run of stored lines packed into one compressed buffer, see
+ * diff_set_compression(). The segment is freed when the last of its lines
+ * has been removed.
+ */
+struct diff_segment_s
+{
+    unsigned char *data;	// compressed line texts
+    size_t len;		// bytes of compressed data
+    size_t rawlen;	// bytes of line texts
+    long refcount;	// lines stored in the segment
+    struct diff_list_s *list;	// list holding the segment
+};
+
+
+struct intern_s;
+struct lineruns_s;
+struct diff_page_s;
+
 struct diff_list_s
 {
     TAILQ_HEAD(listhead, diff_iterator) head;	/* Linked list head */
     struct diff_iterator *tqh_current;		/* pointer to current element */
+    struct lineruns_s *runs;	// line numbers of the nodes, searched without walking the list
+    struct diff_page_s *page;	// page new nodes are taken from
+    LIST_HEAD(pagehead, diff_page_s) freepages;	// pages with released nodes, taken before a new page
+    long pages;		// statistics: pages of nodes mapped
+    struct intern_s *intern;	// table of interned lines, NULL if not used
+    int level;		// compression level, 0 if lines are not packed
+    size_t hotlimit;	// bytes of line text left unpacked at the tail
+    size_t hotbytes;	// bytes of line text not packed yet
+    struct diff_iterator *packed;	// last line looked at for packing, NULL for none
+    struct diff_segment_s *cached;	// segment unpacked into cache
+    char *cache;	// line texts of the cached segment
+    size_t cachesize;	// bytes allocated for cache
+    long packedlines;	// statistics: lines packed so far
+    unsigned long long rawbytes;	// statistics: bytes of packed line texts
+    unsigned long long packedbytes;	// statistics: bytes after compression
+};
+
+/* where the text of a line is kept */
+enum {
+    DIFF_LINE_OWNED = 0,	// allocated, freed with the line
+    DIFF_LINE_BLOCK,		// view into a block, not NUL terminated
+    DIFF_LINE_INTERNED,		// owned by the intern table of the list
+    DIFF_LINE_PACKED,		// packed into a segment
 };
 
 struct diff_iterator
 {
     TAILQ_ENTRY(diff_iterator) entries;		/* Linked list prev./next entry */
     long n;		// line number
-    char *line;	// diff string
+    uint64_t hash;	// hash of line, see hash_lines()
+    size_t len;		// length of line
+    union {
+	char *line;	// diff string, unless packed
+	size_t offset;	// offset of the line in the unpacked segment if packed
+    };
+    union {
+	struct diff_block_s *block;	// block line points into
+	struct diff_segment_s *segment;	// segment holding the line if packed
+    };
+    int store;		// DIFF_LINE_*, tells which members of the unions are used
 };
 
 
@@ -51,7 +118,30 @@ struct diff_iterator
 struct diff_list_s *diff_new(void);
 void diff_delete(struct diff_list_s *list);
 void diff_add_line(struct diff_list_s *list, long n, char *line);
+void diff_add_hashed_line(struct diff_list_s *list, long n, char *line, uint64_t hash);
+/** add a line pointing into a block, the block gets referenced. */
+void diff_add_block_line(struct diff_list_s *list, long n, struct diff_block_s *block, const char *line, size_t len, uint64_t hash);
+/** add a line stored once in the intern table of the list.
+ * see diff_set_intern()
+ */
+void diff_add_interned_line(struct diff_list_s *list, long n, const char *line, size_t len, uint64_t hash);
+/** share the intern table with the list. Must be set while the list is empty. */
+void diff_set_intern(struct diff_list_s *list, struct intern_s *intern);
+/** pack the lines into compressed segments while more than hotlimit bytes of
+ * them are not packed yet. The oldest lines are packed first, the lines added
+ * last stay as they are.
+ *
+ * @param list: the list
+ * @param level: zlib compression level 1 (fast) to 9 (small), 0 to stop packing
+ * @param hotlimit: bytes of line texts left unpacked
+ * @return 0 on success, -1 if lfdiff is built without zlib
+ */
+int diff_set_compression(struct diff_list_s *list, int level, size_t hotlimit);
 void diff_remove_line(struct diff_list_s *list, long n);
+/** remove all lines up to and including line n.
+ * Takes time in the number of lines removed, without searching the list.
+ */
+void diff_truncate(struct diff_list_s *list, long n);
 struct diff_iterator *diff_iterator_get_first(struct diff_list_s *list);
 struct diff_iterator *diff_iterator_get_last(struct diff_list_s *list);
 struct diff_iterator *diff_iterator_get_current(struct diff_list_s *list);
@@ -63,7 +153,36 @@ void diff_iterator_previous(struct diff_iterator **iterator);
 void diff_iterator_go_equal_before_line(struct diff_iterator **iterator, long n);
 void diff_iterator_go_equal_after_line(struct diff_iterator **iterator, long n);
 
+/** get the run of consecutive lines holding line n, i.e. a block of the diff.
+ * Looks at the line numbers only, the current iterator does not move.
+ *
+ * @param list: the list
+ * @param n: line number
+ * @param first: set to the first line of the run if not NULL
+ * @param last: set to the last line of the run if not NULL
+ * @return 1 if line n is stored, 0 if not
+ */
+int diff_get_run(struct diff_list_s *list, long n, long *first, long *last);
+/** get the number of the first stored line at or after line n.
+ * Looks at the line numbers only, the current iterator does not move.
+ *
+ * @return 1 if a line has been found, 0 if no line >= n is stored
+ */
+int diff_get_next_line_nr(struct diff_list_s *list, long n, long *next);
+
+/** get the line text. Use diff_get_line_len(), lines in blocks are not
+ * NUL terminated.
+ * The text of a packed line is valid until the next line of another segment
+ * of the same list is read.
+ */
 const char *diff_get_line(struct diff_iterator *iterator);
+size_t diff_get_line_len(struct diff_iterator *iterator);
 long diff_get_line_nr(struct diff_iterator *iterator);
+uint64_t diff_get_hash(struct diff_iterator *iterator);
+
+struct diff_block_s *diff_block_new(size_t capacity);
+void diff_block_ref(struct diff_block_s *block);
+/** drop a reference, frees the block with the last one. */
+void diff_block_unref(struct diff_block_s *block);
 
 #endif /* SRC_ANSIC_DIFFLIST_H_ */
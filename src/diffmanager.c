@@ -29,6 +29,10 @@
 
 #include "diffmanager.h"
 #include "difflist.h"
+#include "hash.h"
+#include "mask.h"
+#include "longline.h"
+#include "intern.h"
 
 #include <stdlib.h>
 #include <assert.h>
@@ -37,12 +41,24 @@
 #define MIN(a,b)	((a)<(b)?(a):(b))
 #define MAX(a,b)	((a)>(b)?(a):(b))
 
+// bytes of line texts per file left unpacked, see diffmanager_set_compression()
+#define DIFFMANAGER_HOT_SIZE	(16*1024*1024)
+
+// largest block of lines re-aligned as a whole, in cells of the LCS table
+#define DIFFMANAGER_REALIGN_CELLS	(16*1024)
+// lines re-aligned at the start and the end of larger blocks
+#define DIFFMANAGER_REALIGN_WINDOW	64
+
+static int diffmanager_lines_equal(struct diffmanager_s *manager, struct diff_iterator *itA, struct diff_iterator *itB);
+static void diffmanager_remove_common(struct diffmanager_s *manager, long lineA, long lineB);
 
 struct diffmanager_s *diffmanager_new(void) {
     struct diffmanager_s *manager = calloc(1, sizeof(*manager));
 
     manager->difflistA = diff_new();
     manager->difflistB = diff_new();
+    manager->firstA = 1;
+    manager->firstB = 1;
 
     return manager;
 }
@@ -52,44 +68,389 @@ void diffmanager_delete(struct diffmanager_s *manager) {
 
     diff_delete(manager->difflistA);
     diff_delete(manager->difflistB);
+    if (manager->contextlist)
+	diff_delete(manager->contextlist);
+    if (manager->intern)
+	intern_delete(manager->intern);
+    free(manager->movesA);
+    free(manager->movesB);
 
     free(manager);
 }
 
 
-void diffmanager_input_diff(struct diffmanager_s *manager, const char *line, long nr) {
+void diffmanager_set_compare_flags(struct diffmanager_s *manager, int flags) {
+    assert(manager);
+
+    manager->compareflags = flags;
+}
+
+void diffmanager_enable_ignore_blank_lines(struct diffmanager_s *manager) {
+    assert(manager);
+
+    manager->ignoreblank = 1;
+}
+
+void diffmanager_set_mask(struct diffmanager_s *manager, const struct mask_s *mask) {
+    assert(manager);
+
+    manager->mask = mask;
+}
+
+void diffmanager_set_longlines(struct diffmanager_s *manager, struct longline_s *longlineA, struct longline_s *longlineB) {
+    assert(manager);
+
+    manager->longlineA = longlineA;
+    manager->longlineB = longlineB;
+}
+
+void diffmanager_enable_intern(struct diffmanager_s *manager) {
+    assert(manager);
+    assert(!manager->intern);
+
+    manager->intern = intern_new();
+    diff_set_intern(manager->difflistA, manager->intern);
+    diff_set_intern(manager->difflistB, manager->intern);
+}
+
+int diffmanager_set_compression(struct diffmanager_s *manager, int level) {
+    assert(manager);
+
+    if (diff_set_compression(manager->difflistA, level, DIFFMANAGER_HOT_SIZE))
+	return -1;
+    if (manager->contextlist)
+	diff_set_compression(manager->contextlist, level, DIFFMANAGER_HOT_SIZE);
+    return diff_set_compression(manager->difflistB, level, DIFFMANAGER_HOT_SIZE);
+}
+
+void diffmanager_set_moves(struct diffmanager_s *manager, long minlines) {
+    assert(manager);
+    assert(minlines >= 0);
+
+    manager->moveminlines = minlines;
+}
+
+void diffmanager_set_unified(struct diffmanager_s *manager, long context, const char *labelA, const char *labelB) {
+    assert(manager);
+    assert(context >= 0);
+    assert(labelA);
+    assert(labelB);
+
+    if (!manager->contextlist) {
+	manager->contextlist = diff_new();
+	if (manager->difflistA->level)
+	    diff_set_compression(manager->contextlist, manager->difflistA->level, DIFFMANAGER_HOT_SIZE);
+    }
+    manager->context = context;
+    manager->labelA = labelA;
+    manager->labelB = labelB;
+}
+
+void diffmanager_set_line_count(struct diffmanager_s *manager, long linesA, long linesB) {
+    assert(manager);
+
+    manager->linesA = linesA;
+    manager->linesB = linesB;
+}
+
+void diffmanager_set_first_lines(struct diffmanager_s *manager, long firstA, long firstB) {
+    assert(manager);
+    assert(firstA>0);
+    assert(firstB>0);
+
+    manager->firstA = firstA;
+    manager->firstB = firstB;
+    manager->outputLineNrA = manager->removeLineNrA = firstA - 1;
+    manager->outputLineNrB = manager->removeLineNrB = firstB - 1;
+}
+
+void diffmanager_input_context(struct diffmanager_s *manager, const char *line, size_t len, long nr) {
     assert(manager);
+    assert(manager->contextlist);
     assert(line);
     assert(nr>0);
 
-    if (' ' != line[1]) {
-	fprintf(stderr, "error: can not recognise diff line \"%s\"\n", line);
+    if (diff_get_run(manager->difflistA, nr, NULL, NULL))
+	return;	// printed as differing line
+    diff_add_hashed_line(manager->contextlist, nr, strndup(line, len), 0);
+}
+
+/* print one line of the diff, a long line is streamed from its spill file */
+static void diffmanager_print_line(FILE *output, const char *prefix, struct diff_iterator *it, struct longline_s *longline) {
+
+    const char *line = diff_get_line(it);
+    const size_t len = diff_get_line_len(it);
+
+    fputs(prefix, output);
+    if (!longline_write(longline, line, len, output)) {
+	fwrite(line, 1, len, output);
+	// only the last line of a file may miss it
+	if (!len || '\n' != line[len - 1])
+	    fprintf(output, "\n\\ No newline at end of file\n");
+    }
+}
+
+/* @return: 1 if blank lines are ignored and lines first..last of list are
+ *   all blank
+ */
+static int diffmanager_lines_blank(struct diffmanager_s *manager, struct diff_list_s *list, long first, long last) {
+
+    if (!manager->ignoreblank)
+	return 0;
+
+    const int space = manager->compareflags & (HASH_IGNORE_SPACE_CHANGE|HASH_IGNORE_ALL_SPACE);
+    struct diff_iterator *it = first <= last? diff_iterator_get_line(list, first): NULL;
+    long n;
+    for (n = first; n <= last; n++) {
+	const char *line = diff_get_line(it);
+	size_t len = diff_get_line_len(it);
+	if (len && '\n' == line[len - 1])
+	    len--;
+	size_t i;
+	for (i = 0; space && i < len; i++)
+	    if (' ' != line[i] && '\t' != line[i] && '\v' != line[i] && '\f' != line[i] && '\r' != line[i])
+		break;
+	if (i < len)
+	    return 0;
+	diff_iterator_next(&it);
+    }
+
+    return 1;
+}
+
+/* store line of file A or B, either a copy or a view into block */
+static void diffmanager_input(struct diffmanager_s *manager, const char *line, size_t len, long nr, struct diff_block_s *block) {
+    assert(manager);
+    assert(line);
+    assert(nr>0);
+
+    if (2 > len || ' ' != line[1]) {
+	fprintf(stderr, "error: can not recognise diff line \"%.*s\"\n", (int) len, line);
 	abort();
     }
 
+    const uint64_t hash = mask_hash_lines(manager->mask, &line[2], len - 2, manager->compareflags);
+
+    struct diff_list_s *list;
     switch (*line) {
     case '<':
-	diff_add_line(manager->difflistA, nr, strdup(&line[2]));
+	list = manager->difflistA;
 	if (nr > manager->maxlineA)
 	    manager->maxlineA = nr;
 	break;
 
     case '>':
-	diff_add_line(manager->difflistB, nr, strdup(&line[2]));
+	list = manager->difflistB;
 	if (nr > manager->maxlineB)
 	    manager->maxlineB = nr;
 	break;
 
     default:
-	fprintf(stderr, "error: can not recognise diff line \"%s\"\n", line);
+	fprintf(stderr, "error: can not recognise diff line \"%.*s\"\n", (int) len, line);
 	abort();
     }
+
+    if (manager->intern)
+	diff_add_interned_line(list, nr, &line[2], len - 2, hash);
+    else if (block)
+	diff_add_block_line(list, nr, block, &line[2], len - 2, hash);
+    else
+	diff_add_hashed_line(list, nr, strndup(&line[2], len - 2), hash);
+}
+
+void diffmanager_input_diff(struct diffmanager_s *manager, const char *line, long nr) {
+    assert(line);
+
+    diffmanager_input(manager, line, strlen(line), nr, NULL);
+}
+
+void diffmanager_input_diff_block(struct diffmanager_s *manager, struct diff_block_s *block, const char *line, size_t len, long nr) {
+    assert(block);
+
+    diffmanager_input(manager, line, len, nr, block);
 }
 
+void diffmanager_input_line(struct diffmanager_s *manager, char side, const char *line, size_t len, long nr) {
+    assert(line || !len);
+
+    char *buffer = malloc(len + 2);
+    assert(buffer);
+    buffer[0] = side;
+    buffer[1] = ' ';
+    memcpy(&buffer[2], line, len);
+
+    diffmanager_input(manager, buffer, len + 2, nr, NULL);
+    free(buffer);
+}
+
+
+/* run of lines deleted from A or inserted in B */
+struct diffmanager_run_s {
+    long first;
+    long last;
+    uint64_t hash;	// hash of the hashes of the lines
+    int moved;		// run is part of a move
+};
+
+/* append run first..last of list to runs */
+static void diffmanager_add_run(struct diffmanager_run_s **runs, size_t *count, size_t *size, struct diff_list_s *list, long first, long last) {
+    if (*count == *size) {
+	*size = *size? 2 * *size: 64;
+	*runs = realloc(*runs, *size * sizeof(**runs));
+	assert(*runs);
+    }
+
+    struct diffmanager_run_s *run = &(*runs)[(*count)++];
+    run->first = first;
+    run->last = last;
+    run->moved = 0;
+    run->hash = last - first + 1;
+    struct diff_iterator *it = diff_iterator_get_line(list, first);
+    long n;
+    for (n = first; n <= last; n++) {
+	run->hash = (run->hash ^ diff_get_hash(it)) * 0x100000001b3ULL;
+	diff_iterator_next(&it);
+    }
+}
+
+/* stored lines of A and B are common lines */
+static int diffmanager_runs_equal(struct diffmanager_s *manager, long firstA, long firstB, long count) {
+    struct diff_iterator *itA = diff_iterator_get_line(manager->difflistA, firstA);
+    struct diff_iterator *itB = diff_iterator_get_line(manager->difflistB, firstB);
+
+    while (count--) {
+	if (!diffmanager_lines_equal(manager, itA, itB))
+	    return 0;
+	diff_iterator_next(&itA);
+	diff_iterator_next(&itB);
+    }
+    return 1;
+}
+
+static int diffmanager_compare_moves(const void *a, const void *b) {
+    const struct diffmanager_move_s *moveA = a;
+    const struct diffmanager_move_s *moveB = b;
+
+    return (moveA->firstA > moveB->firstA) - (moveA->firstA < moveB->firstA);
+}
+
+/* find runs of lines deleted from A and inserted unchanged in B at another
+ * place. The runs deleted are indexed by the hash of their lines, the runs
+ * inserted are looked up in the index. The text of the lines moved is freed.
+ */
+static void diffmanager_find_moves(struct diffmanager_s *manager) {
+    struct diffmanager_run_s *deleted = NULL, *inserted = NULL;
+    size_t deletedcount = 0, insertedcount = 0, deletedsize = 0, insertedsize = 0;
+    size_t i;
+
+    // walk the blocks, lineA and lineB are at the same offset
+    long lineA = manager->firstA, lineB = manager->firstB;
+    for (;;) {
+	long nextA, nextB, lastA, lastB;
+	const int foundA = diff_get_next_line_nr(manager->difflistA, lineA, &nextA);
+	const int foundB = diff_get_next_line_nr(manager->difflistB, lineB, &nextB);
+	if (!foundA && !foundB)
+	    break;
+	long skip;
+	if (foundA && foundB)
+	    skip = MIN(nextA - lineA, nextB - lineB);
+	else
+	    skip = foundA? nextA - lineA: nextB - lineB;
+	lineA += skip;
+	lineB += skip;
+
+	const int inA = diff_get_run(manager->difflistA, lineA, NULL, &lastA);
+	const int inB = diff_get_run(manager->difflistB, lineB, NULL, &lastB);
+	if (inA && inB) {
+	    // changed block
+	    lineA = lastA + 1;
+	    lineB = lastB + 1;
+	}
+	else if (inA) {
+	    if (lastA - lineA + 1 >= manager->moveminlines)
+		diffmanager_add_run(&deleted, &deletedcount, &deletedsize, manager->difflistA, lineA, lastA);
+	    lineA = lastA + 1;
+	}
+	else {
+	    if (lastB - lineB + 1 >= manager->moveminlines)
+		diffmanager_add_run(&inserted, &insertedcount, &insertedsize, manager->difflistB, lineB, lastB);
+	    lineB = lastB + 1;
+	}
+    }
+
+    // index the runs deleted, open addressing
+    size_t buckets = 1;
+    while (buckets < 2 * deletedcount)
+	buckets *= 2;
+    size_t *index = calloc(buckets, sizeof(*index));	// run + 1, 0 if empty
+    assert(index);
+    for (i = 0; i < deletedcount; i++) {
+	size_t bucket = deleted[i].hash & (buckets - 1);
+	while (index[bucket])
+	    bucket = (bucket + 1) & (buckets - 1);
+	index[bucket] = i + 1;
+    }
+
+    // moved blocks in order of B
+    manager->movesB = malloc(MAX(insertedcount, 1) * sizeof(*manager->movesB));
+    assert(manager->movesB);
+    manager->moves = 0;
+    for (i = 0; i < insertedcount; i++) {
+	const struct diffmanager_run_s *run = &inserted[i];
+	const long count = run->last - run->first + 1;
+	size_t bucket = run->hash & (buckets - 1);
+	for (; index[bucket]; bucket = (bucket + 1) & (buckets - 1)) {
+	    struct diffmanager_run_s *candidate = &deleted[index[bucket] - 1];
+	    if (candidate->moved || candidate->hash != run->hash
+		    || candidate->last - candidate->first + 1 != count
+		    || !diffmanager_runs_equal(manager, candidate->first, run->first, count))
+		continue;
+
+	    candidate->moved = 1;
+	    struct diffmanager_move_s *move = &manager->movesB[manager->moves++];
+	    move->firstA = candidate->first;
+	    move->lastA = candidate->last;
+	    move->firstB = run->first;
+	    move->lastB = run->last;
+	    manager->movedlines += count;
+	    break;
+	}
+    }
+    free(index);
+    free(deleted);
+    free(inserted);
+
+    manager->movesA = malloc(MAX(manager->moves, 1) * sizeof(*manager->movesA));
+    assert(manager->movesA);
+    memcpy(manager->movesA, manager->movesB, manager->moves * sizeof(*manager->movesA));
+    qsort(manager->movesA, manager->moves, sizeof(*manager->movesA), diffmanager_compare_moves);
+}
+
+/* get the moved block starting at line of A or B, NULL if there is none */
+static const struct diffmanager_move_s *diffmanager_get_move(struct diffmanager_s *manager, long line, int inB) {
+    const struct diffmanager_move_s *moves = inB? manager->movesB: manager->movesA;
+    long lo = 0;
+    long hi = manager->moves;
+
+    while (lo < hi) {
+	const long mid = lo + (hi - lo) / 2;
+	const long first = inB? moves[mid].firstB: moves[mid].firstA;
+	if (first < line)
+	    lo = mid + 1;
+	else if (first > line)
+	    hi = mid;
+	else
+	    return &moves[mid];
+    }
+    return NULL;
+}
 
 void diffmanager_output_diff(struct diffmanager_s *manager, FILE *output, long maxLineNr) {
     // remove doublettes before pushing them out
     diffmanager_remove_common_lines(manager, maxLineNr);
+    // moves are known when all lines are in
+    if (manager->moveminlines && !maxLineNr && !manager->movesA)
+	diffmanager_find_moves(manager);
 
     diffmanager_print_diff_to_stream(manager, output, maxLineNr);
 
@@ -97,11 +458,154 @@ void diffmanager_output_diff(struct diffmanager_s *manager, FILE *output, long m
     diffmanager_delete_diff(manager, maxLineNr);
 }
 
+/* lines of A replaced by lines of B, lastA = firstA-1 if no lines of A */
+struct diffmanager_hunk_s {
+    long firstA;
+    long lastA;
+    long firstB;
+    long lastB;
+};
+
+/* find the next hunk at or after line A and B, both at the same offset.
+ * @return: 1 if found, lineA and lineB are set behind the hunk. 0 if no
+ *   more lines are stored.
+ */
+static int diffmanager_next_hunk(struct diffmanager_s *manager, long *lineA, long *lineB, struct diffmanager_hunk_s *hunk) {
+
+    long nextA, nextB, skip;
+    const int foundA = diff_get_next_line_nr(manager->difflistA, *lineA, &nextA);
+    const int foundB = diff_get_next_line_nr(manager->difflistB, *lineB, &nextB);
+    if (foundA && foundB)
+	skip = MIN(nextA - *lineA, nextB - *lineB);
+    else if (foundA)
+	skip = nextA - *lineA;
+    else if (foundB)
+	skip = nextB - *lineB;
+    else
+	return 0;
+
+    hunk->firstA = *lineA + skip;
+    hunk->firstB = *lineB + skip;
+    if (!diff_get_run(manager->difflistA, hunk->firstA, NULL, &hunk->lastA))
+	hunk->lastA = hunk->firstA - 1;
+    if (!diff_get_run(manager->difflistB, hunk->firstB, NULL, &hunk->lastB))
+	hunk->lastB = hunk->firstB - 1;
+    *lineA = hunk->lastA + 1;
+    *lineB = hunk->lastB + 1;
+
+    return 1;
+}
+
+/* print the range of a unified hunk header, an empty range names the line
+ * in front of it */
+static void diffmanager_print_range(FILE *output, char prefix, long first, long count) {
+
+    if (1 == count)
+	fprintf(output, "%c%ld", prefix, first);
+    else if (!count)
+	fprintf(output, "%c%ld,0", prefix, first - 1);
+    else
+	fprintf(output, "%c%ld,%ld", prefix, first, count);
+}
+
+/* print common line n of A as context */
+static void diffmanager_print_context(struct diffmanager_s *manager, FILE *output, long n) {
+
+    struct diff_iterator *it = diff_iterator_get_line(manager->contextlist, n);
+    if (!it) {
+	fprintf(stderr, "error: context line %ld of file A is not stored\n", n);
+	abort();
+    }
+    diffmanager_print_line(output, " ", it, manager->longlineA);
+}
+
+/* print all hunks in unified format.
+ * Hunks not more than twice the context lines apart are printed as one, so
+ * the hunks of a group are collected first to print the header.
+ */
+static void diffmanager_print_unified(struct diffmanager_s *manager, FILE *output) {
+
+    const long context = manager->context;
+    struct diffmanager_hunk_s *group = NULL;
+    size_t count = 0;
+    size_t size = 0;
+    struct diffmanager_hunk_s hunk;
+    long lineA = manager->firstA;
+    long lineB = manager->firstB;
+    int more = diffmanager_next_hunk(manager, &lineA, &lineB, &hunk);
+    int header = 0;
+
+    while (more) {
+	count = 0;
+	do {
+	    if (count == size) {
+		size = size? 2 * size: 16;
+		group = realloc(group, size * sizeof(*group));
+		assert(group);
+	    }
+	    group[count++] = hunk;
+	    more = diffmanager_next_hunk(manager, &lineA, &lineB, &hunk);
+	} while (more && hunk.firstA - group[count-1].lastA - 1 <= 2 * context);
+
+	size_t i;
+	for (i=0; i<count; i++)
+	    if (!diffmanager_lines_blank(manager, manager->difflistA, group[i].firstA, group[i].lastA)
+		    || !diffmanager_lines_blank(manager, manager->difflistB, group[i].firstB, group[i].lastB))
+		break;
+	if (i == count)
+	    continue;	// blank lines only
+	if (!header) {
+	    fprintf(output, "--- %s\n+++ %s\n", manager->labelA, manager->labelB);
+	    header = 1;
+	}
+
+	const struct diffmanager_hunk_s *first = &group[0];
+	const struct diffmanager_hunk_s *last = &group[count-1];
+	long before = MIN(context, first->firstA - 1);
+	// lines in front of the first line compared have been printed by an
+	// earlier run unless they are kept as context
+	while (before && first->firstA - before < manager->firstA
+		&& !diff_get_run(manager->contextlist, first->firstA - before, NULL, NULL))
+	    before--;
+	const long after = MAX(0, MIN(context, MIN(manager->linesA - last->lastA, manager->linesB - last->lastB)));
+	const long startA = first->firstA - before;
+	const long startB = first->firstB - before;
+
+	fprintf(output, "@@ ");
+	diffmanager_print_range(output, '-', startA, last->lastA + after - startA + 1);
+	fprintf(output, " ");
+	diffmanager_print_range(output, '+', startB, last->lastB + after - startB + 1);
+	fprintf(output, " @@\n");
+
+	long n = startA;
+	for (i=0; i<count; i++) {
+	    for (; n<group[i].firstA; n++)
+		diffmanager_print_context(manager, output, n);
+	    for (n=group[i].firstA; n<=group[i].lastA; n++)
+		diffmanager_print_line(output, "-", diff_iterator_get_line(manager->difflistA, n), manager->longlineA);
+	    long m;
+	    for (m=group[i].firstB; m<=group[i].lastB; m++)
+		diffmanager_print_line(output, "+", diff_iterator_get_line(manager->difflistB, m), manager->longlineB);
+	}
+	for (; n<=last->lastA + after; n++)
+	    diffmanager_print_context(manager, output, n);
+    }
+
+    free(group);
+}
+
 void diffmanager_print_diff_to_stream(struct diffmanager_s *manager, FILE *output, long maxLineNr) {
     assert(manager);
     assert(output);
     assert(maxLineNr>=0);
 
+    if (manager->contextlist) {
+	// the hunks are grouped over the whole file, printed at once
+	assert(!maxLineNr);
+	diffmanager_print_unified(manager, output);
+	return;
+    }
+
     /* Algorithm:
      * 0) start the current line numbers A and B with 0
      * 1) go to the first entry in container A and B
@@ -193,47 +697,42 @@ void diffmanager_print_diff_to_stream(struct diffmanager_s *manager, FILE *outpu
 	const long iterLineNrB = itB? diff_get_line_nr(itB): 0;
 	const long virtualLineNrA = iterLineNrA + diffAB;
 
-	const char *lineA = itA? diff_get_line(itA): NULL;
-	const char *lineB = itB? diff_get_line(itB): NULL;
-
 	if (itA && itB && virtualLineNrA == iterLineNrB) {
 	    // line changed from A to B
 
 	    long diffstartA = manager->outputLineNrA;
 	    long diffstartB = manager->outputLineNrB;
-	    long diffendA = manager->outputLineNrA;
-	    long diffendB = manager->outputLineNrB;
-
-	    diff_iterator_next(&itA);
-	    while (itA && diff_get_line_nr(itA) == diffendA+1) {
-		diffendA = diff_get_line_nr(itA);
-		diff_iterator_next(&itA);
-	    }
-	    diff_iterator_next(&itB);
-	    while (itB && diff_get_line_nr(itB) == diffendB+1) {
-		diffendB = diff_get_line_nr(itB);
-		diff_iterator_next(&itB);
+	    long diffendA = diffstartA;
+	    long diffendB = diffstartB;
+
+	    // the block ends with the run of consecutive lines
+	    diff_get_run(manager->difflistA, diffstartA, NULL, &diffendA);
+	    diff_get_run(manager->difflistB, diffstartB, NULL, &diffendB);
+	    const int print = !diffmanager_lines_blank(manager, manager->difflistA, diffstartA, diffendA)
+		    || !diffmanager_lines_blank(manager, manager->difflistB, diffstartB, diffendB);
+
+	    if (print) {
+		if (diffstartA != diffendA)
+		    fprintf(output, "%ld,%ld", diffstartA, diffendA);
+		else
+		    fprintf(output, "%ld", diffstartA);
+		if (diffstartB != diffendB)
+		    fprintf(output, "c%ld,%ld\n", diffstartB, diffendB);
+		else
+		    fprintf(output, "c%ld\n", diffstartB);
 	    }
 
-	    if (diffstartA != diffendA)
-		fprintf(output, "%ld,%ld", diffstartA, diffendA);
-	    else
-		fprintf(output, "%ld", diffstartA);
-	    if (diffstartB != diffendB)
-		fprintf(output, "c%ld,%ld\n", diffstartB, diffendB);
-	    else
-		fprintf(output, "c%ld\n", diffstartB);
-
 	    for (manager->outputLineNrA=diffstartA; manager->outputLineNrA<=diffendA; manager->outputLineNrA++) {
 		itA = diff_iterator_get_line(manager->difflistA, manager->outputLineNrA);
-		lineA = diff_get_line(itA);
-		fprintf(output, "< %s", lineA);
+		if (print)
+		    diffmanager_print_line(output, "< ", itA, manager->longlineA);
 	    }
-	    fprintf(output, "---\n");
+	    if (print)
+		fprintf(output, "---\n");
 	    for (manager->outputLineNrB=diffstartB; manager->outputLineNrB<=diffendB; manager->outputLineNrB++) {
 		itB = diff_iterator_get_line(manager->difflistB, manager->outputLineNrB);
-		lineB = diff_get_line(itB);
-		fprintf(output, "> %s", lineB);
+		if (print)
+		    diffmanager_print_line(output, "> ", itB, manager->longlineB);
 	    }
 
 	    // advance both to the next line block
@@ -247,29 +746,44 @@ void diffmanager_print_diff_to_stream(struct diffmanager_s *manager, FILE *outpu
 	    // line deleted from A to B
 
 	    long diffstart = manager->outputLineNrA;
-	    long diffend = manager->outputLineNrA;
-	    struct diff_iterator *itLine = itA;
-	    diff_iterator_next(&itLine);
-	    while (itLine && diff_get_line_nr(itLine) == diffend+1) {
-		diffend = diff_get_line_nr(itLine);
-		diff_iterator_next(&itLine);
-	    }
+	    long diffend = diffstart;
+	    diff_get_run(manager->difflistA, diffstart, NULL, &diffend);
 
 	    // correct lineNrB calculation
 	    manager->outputLineNrB--;
 
-	    // now we have start line number and end line number
-	    // printout the diff lines
-	    if (diffstart != diffend)
-		fprintf(output, "%ld,%ldd%ld\n", diffstart, diffend, manager->outputLineNrB);
-	    else
-		fprintf(output, "%ldd%ld\n", diffstart, manager->outputLineNrB);
-
-	    for (manager->outputLineNrA=diffstart; manager->outputLineNrA<=diffend; manager->outputLineNrA++) {
-//		itA = diff_iterator_get_line(manager->difflistA, lineNrA);
-		lineA = diff_get_line(itA);
-		fprintf(output, "< %s", lineA);
-		diff_iterator_next(&itA);
+	    const struct diffmanager_move_s *move = diffmanager_get_move(manager, diffstart, 0);
+	    if (move) {
+		// block moved, print where to
+		if (diffstart != diffend)
+		    fprintf(output, "%ld,%ldm", diffstart, diffend);
+		else
+		    fprintf(output, "%ldm", diffstart);
+		if (move->firstB != move->lastB)
+		    fprintf(output, "%ld,%ld\n", move->firstB, move->lastB);
+		else
+		    fprintf(output, "%ld\n", move->firstB);
+
+		for (manager->outputLineNrA=diffstart; manager->outputLineNrA<=diffend; manager->outputLineNrA++)
+		    diff_iterator_next(&itA);
+	    }
+	    else {
+		// now we have start line number and end line number
+		// printout the diff lines
+		const int print = !diffmanager_lines_blank(manager, manager->difflistA, diffstart, diffend);
+		if (!print)
+		    ;	// blank lines only
+		else if (diffstart != diffend)
+		    fprintf(output, "%ld,%ldd%ld\n", diffstart, diffend, manager->outputLineNrB);
+		else
+		    fprintf(output, "%ldd%ld\n", diffstart, manager->outputLineNrB);
+
+		for (manager->outputLineNrA=diffstart; manager->outputLineNrA<=diffend; manager->outputLineNrA++) {
+//		    itA = diff_iterator_get_line(manager->difflistA, lineNrA);
+		    if (print)
+			diffmanager_print_line(output, "< ", itA, manager->longlineA);
+		    diff_iterator_next(&itA);
+		}
 	    }
 
 	    // advance A to the next line block
@@ -281,12 +795,8 @@ void diffmanager_print_diff_to_stream(struct diffmanager_s *manager, FILE *outpu
 	    // line added from A to B
 
 	    long diffstart = manager->outputLineNrB;
-	    long diffend = manager->outputLineNrB;
-	    diff_iterator_next(&itB);
-	    while (itB && diff_get_line_nr(itB) == diffend+1) {
-		diffend = diff_get_line_nr(itB);
-		diff_iterator_next(&itB);
-	    }
+	    long diffend = diffstart;
+	    diff_get_run(manager->difflistB, diffstart, NULL, &diffend);
 //	    for (itB = diff_iterator_get_line(manager->difflistB, ++diffend);
 //		    itB;
 //		    itB = diff_iterator_get_line(manager->difflistB, ++diffend)) {
@@ -297,17 +807,28 @@ void diffmanager_print_diff_to_stream(struct diffmanager_s *manager, FILE *outpu
 	    // correct lineNrA calculation
 	    manager->outputLineNrA--;
 
-	    // now we have start line number and end line number
-	    // printout the diff lines
-	    if (diffstart != diffend)
-		fprintf(output, "%lda%ld,%ld\n", manager->outputLineNrA, diffstart, diffend);
-	    else
-		fprintf(output, "%lda%ld\n", manager->outputLineNrA, diffstart);
-
-	    for (manager->outputLineNrB=diffstart; manager->outputLineNrB<=diffend; manager->outputLineNrB++) {
-		itB = diff_iterator_get_line(manager->difflistB, manager->outputLineNrB);
-		lineB = diff_get_line(itB);
-		fprintf(output, "> %s", lineB);
+	    if (diffmanager_get_move(manager, diffstart, 1)) {
+		// block moved, printed at its old place
+		itB = diff_iterator_get_line(manager->difflistB, diffend);
+		manager->outputLineNrB = diffend + 1;
+	    }
+	    else if (diffmanager_lines_blank(manager, manager->difflistB, diffstart, diffend)) {
+		// blank lines only
+		itB = diff_iterator_get_line(manager->difflistB, diffend);
+		manager->outputLineNrB = diffend + 1;
+	    }
+	    else {
+		// now we have start line number and end line number
+		// printout the diff lines
+		if (diffstart != diffend)
+		    fprintf(output, "%lda%ld,%ld\n", manager->outputLineNrA, diffstart, diffend);
+		else
+		    fprintf(output, "%lda%ld\n", manager->outputLineNrA, diffstart);
+
+		for (manager->outputLineNrB=diffstart; manager->outputLineNrB<=diffend; manager->outputLineNrB++) {
+		    itB = diff_iterator_get_line(manager->difflistB, manager->outputLineNrB);
+		    diffmanager_print_line(output, "> ", itB, manager->longlineB);
+		}
 	    }
 
 	    // advance B to the next line block
@@ -329,31 +850,10 @@ void diffmanager_delete_diff(struct diffmanager_s *manager, long maxLineNr) {
     assert(manager);
     assert(maxLineNr>=0);
 
-    struct diff_iterator *it;
-    it = diff_iterator_get_first(manager->difflistA);
-    if (it) {
-	long lineNr = diff_get_line_nr(it);
-	while (lineNr <= maxLineNr) {
-	    diff_remove_line(manager->difflistA,lineNr);
-	    it = diff_iterator_get_first(manager->difflistA);
-	    if (!it)
-		break;
-	    lineNr = diff_get_line_nr(it);
-	}
-    }
-
-    it = diff_iterator_get_first(manager->difflistB);
-    if (it) {
-	long lineNr = diff_get_line_nr(it);
-	while (lineNr <= maxLineNr) {
-	    diff_remove_line(manager->difflistB,lineNr);
-	    it = diff_iterator_get_first(manager->difflistB);
-	    if (!it)
-		break;
-	    lineNr = diff_get_line_nr(it);
-	}
-    }
-
+    diff_truncate(manager->difflistA, maxLineNr);
+    diff_truncate(manager->difflistB, maxLineNr);
+    if (manager->contextlist)
+	diff_truncate(manager->contextlist, maxLineNr);
 }
 
 long diffmanager_get_max_common_input_line(struct diffmanager_s *manager) {
@@ -368,6 +868,129 @@ long diffmanager_get_linediff_A_B(struct diffmanager_s *manager) {
     return manager->outputLineNrB - manager->outputLineNrA;
 }
 
+/* lines are common lines, the text is looked at only on equal hashes */
+static int diffmanager_lines_equal(struct diffmanager_s *manager, struct diff_iterator *itA, struct diff_iterator *itB) {
+    if (diff_get_hash(itA) != diff_get_hash(itB))
+	return 0;
+
+    const char *lineA = diff_get_line(itA);
+    const char *lineB = diff_get_line(itB);
+    return mask_lines_equal(manager->mask, lineA, diff_get_line_len(itA), lineB, diff_get_line_len(itB), manager->compareflags);
+}
+
+/* remove a line common to A and B, the unified output keeps it as context */
+static void diffmanager_remove_common(struct diffmanager_s *manager, long lineA, long lineB) {
+
+    if (manager->contextlist) {
+	struct diff_iterator *it = diff_iterator_get_line(manager->difflistA, lineA);
+	diff_add_hashed_line(manager->contextlist, lineA, strndup(diff_get_line(it), diff_get_line_len(it)), 0);
+    }
+    diff_remove_line(manager->difflistA, lineA);
+    diff_remove_line(manager->difflistB, lineB);
+}
+
+/* remove the longest common subsequence of the stored lines
+ * firstA..firstA+countA-1 and firstB..firstB+countB-1.
+ * (countA+1)*(countB+1) must not exceed DIFFMANAGER_REALIGN_CELLS.
+ */
+static void diffmanager_realign_window(struct diffmanager_s *manager, long firstA, long countA, long firstB, long countB) {
+    assert((countA+1)*(countB+1) <= DIFFMANAGER_REALIGN_CELLS);
+
+    if (!countA || !countB)
+	return;
+
+    const long columns = countB + 1;
+    struct diff_iterator **itA = malloc((countA + countB) * sizeof(*itA));
+    struct diff_iterator **itB = &itA[countA];
+    uint16_t *lcs = malloc((countA + 1) * columns * sizeof(*lcs));	// LCS of A[i..] and B[j..]
+    unsigned char *equal = malloc(countA * countB);
+    assert(itA && lcs && equal);
+    long i, j;
+
+    for (i = 0; i < countA; i++) {
+	itA[i] = diff_iterator_get_line(manager->difflistA, firstA + i);
+	assert(itA[i]);
+    }
+    for (j = 0; j < countB; j++) {
+	itB[j] = diff_iterator_get_line(manager->difflistB, firstB + j);
+	assert(itB[j]);
+    }
+
+    for (j = 0; j <= countB; j++)
+	lcs[countA * columns + j] = 0;
+    for (i = countA - 1; i >= 0; i--) {
+	lcs[i * columns + countB] = 0;
+	for (j = countB - 1; j >= 0; j--) {
+	    equal[i * countB + j] = diffmanager_lines_equal(manager, itA[i], itB[j]);
+	    if (equal[i * countB + j])
+		lcs[i * columns + j] = lcs[(i+1) * columns + j + 1] + 1;
+	    else
+		lcs[i * columns + j] = MAX(lcs[(i+1) * columns + j], lcs[i * columns + j + 1]);
+	}
+    }
+
+    // remove the matching lines in order, the iterators get invalid
+    i = j = 0;
+    while (i < countA && j < countB) {
+	if (equal[i * countB + j]) {
+	    diffmanager_remove_common(manager, firstA + i, firstB + j);
+	    i++;
+	    j++;
+	}
+	else if (lcs[(i+1) * columns + j] >= lcs[i * columns + j + 1])
+	    i++;
+	else
+	    j++;
+    }
+
+    free(equal);
+    free(lcs);
+    free(itA);
+}
+
+/* remove common lines of a block of changed lines, i.e. the stored lines
+ * firstA..lastA changed to firstB..lastB.
+ * Blocks cut by the slices fed to "diff" may hold common lines shifted
+ * against each other. Small blocks are re-aligned as a whole. Of larger
+ * blocks the first and the last lines are re-aligned, the lines in between
+ * are compared at equal offsets.
+ */
+static void diffmanager_realign(struct diffmanager_s *manager, long firstA, long lastA, long firstB, long lastB) {
+    const long countA = lastA - firstA + 1;
+    const long countB = lastB - firstB + 1;
+    const long window = DIFFMANAGER_REALIGN_WINDOW;
+
+    if (1 == countA && 1 == countB) {
+	// most common, skip the tables
+	struct diff_iterator *itA = diff_iterator_get_line(manager->difflistA, firstA);
+	struct diff_iterator *itB = diff_iterator_get_line(manager->difflistB, firstB);
+	if (diffmanager_lines_equal(manager, itA, itB)) {
+	    diffmanager_remove_common(manager, firstA, firstB);
+	}
+	return;
+    }
+    if ((countA+1)*(countB+1) <= DIFFMANAGER_REALIGN_CELLS) {
+	diffmanager_realign_window(manager, firstA, countA, firstB, countB);
+	return;
+    }
+
+    diffmanager_realign_window(manager, firstA, MIN(countA, window), firstB, MIN(countB, window));
+
+    long offset;
+    for (offset = window; offset < MIN(countA, countB) - window; offset++) {
+	struct diff_iterator *itA = diff_iterator_get_line(manager->difflistA, firstA + offset);
+	struct diff_iterator *itB = diff_iterator_get_line(manager->difflistB, firstB + offset);
+	if (diffmanager_lines_equal(manager, itA, itB)) {
+	    diffmanager_remove_common(manager, firstA + offset, firstB + offset);
+	}
+    }
+
+    const long tailA = MAX(window, countA - window);
+    const long tailB = MAX(window, countB - window);
+    if (tailA < countA && tailB < countB)
+	diffmanager_realign_window(manager, firstA + tailA, countA - tailA, firstB + tailB, countB - tailB);
+}
+
 void diffmanager_remove_common_lines(struct diffmanager_s *manager, long maxLineNr) {
     assert(manager);
     assert(maxLineNr>=0);
@@ -388,15 +1011,23 @@ void diffmanager_remove_common_lines(struct diffmanager_s *manager, long maxLine
 	itA = diff_iterator_get_line(manager->difflistA, manager->removeLineNrA);
 	itB = diff_iterator_get_line(manager->difflistB, manager->removeLineNrB);
 
-	if (itA && itB) {
+	long lastA, lastB;
+	if (itA && itB
+		&& diff_get_run(manager->difflistA, manager->removeLineNrA, NULL, &lastA)
+		&& diff_get_run(manager->difflistB, manager->removeLineNrB, NULL, &lastB)
+		&& (!maxLineNr || MAX(lastA, lastB) < maxLineNr)) {
+	    // a whole block changed from A to B, find the common lines in it
+	    diffmanager_realign(manager, manager->removeLineNrA, lastA, manager->removeLineNrB, lastB);
+	    // the lines behind the block are at the same offset again
+	    manager->removeLineNrA = lastA + 1;
+	    manager->removeLineNrB = lastB + 1;
+	}
+	else if (itA && itB) {
 	    // both lines defined, maybe the same
-	    const char *lineA = diff_get_line(itA);
-	    const char *lineB = diff_get_line(itB);
-	    if (!strcmp(lineA, lineB)) {
+	    if (diffmanager_lines_equal(manager, itA, itB)) {
 		// lines are same
 		// remove them
-		diff_remove_line(manager->difflistA, manager->removeLineNrA);
-		diff_remove_line(manager->difflistB, manager->removeLineNrB);
+		diffmanager_remove_common(manager, manager->removeLineNrA, manager->removeLineNrB);
 	    }
 	    manager->removeLineNrA++;
 	    manager->removeLineNrB++;
@@ -413,8 +1044,25 @@ void diffmanager_remove_common_lines(struct diffmanager_s *manager, long maxLine
 	}
 	else {
 	    // both lines undefined (i.e. same)
-	    manager->removeLineNrA++;
-	    manager->removeLineNrB++;
+	    // skip to the next line stored in A or B
+	    long nextA, nextB, skip;
+	    const int foundA = diff_get_next_line_nr(manager->difflistA, manager->removeLineNrA, &nextA);
+	    const int foundB = diff_get_next_line_nr(manager->difflistB, manager->removeLineNrB, &nextB);
+	    if (foundA && foundB)
+		skip = MIN(nextA - manager->removeLineNrA, nextB - manager->removeLineNrB);
+	    else if (foundA)
+		skip = nextA - manager->removeLineNrA;
+	    else if (foundB)
+		skip = nextB - manager->removeLineNrB;
+	    else
+		// stop behind the last lines
+		skip = MAX(maxLineNrA - manager->removeLineNrA, maxLineNrB - manager->removeLineNrB) + 1;
+	    if (maxLineNr)
+		skip = MIN(skip, maxLineNr - MIN(manager->removeLineNrA,manager->removeLineNrB));
+	    skip = MAX(skip, 1);
+
+	    manager->removeLineNrA += skip;
+	    manager->removeLineNrB += skip;
 	}
 
     }
@@ -34,6 +34,18 @@
 
 
 struct diff_list_s;
+struct diff_block_s;
+struct mask_s;
+struct longline_s;
+struct intern_s;
+
+/* block of lines deleted from A and inserted in B at another place */
+struct diffmanager_move_s {
+    long firstA;
+    long lastA;
+    long firstB;
+    long lastB;
+};
 
 struct diffmanager_s {
     struct diff_list_s *difflistA;
@@ -44,12 +56,128 @@ struct diffmanager_s {
     long outputLineNrB;
     long removeLineNrA;
     long removeLineNrB;
+    int compareflags;	// HASH_IGNORE_* flags to compare lines
+    int ignoreblank;	// leave out hunks of blank lines on output
+    const struct mask_s *mask;	// regions of lines not compared
+    struct longline_s *longlineA;	// long lines of file A, printed instead of their placeholders
+    struct longline_s *longlineB;
+    struct intern_s *intern;	// lines of A and B stored once, NULL if not used
+    long moveminlines;	// report moved blocks of at least this many lines, 0: do not look for moves
+    struct diffmanager_move_s *movesA;	// moved blocks sorted by line of A
+    struct diffmanager_move_s *movesB;	// moved blocks sorted by line of B
+    long moves;		// number of moved blocks
+    long movedlines;	// lines in moved blocks
+    struct diff_list_s *contextlist;	// common lines of A around the hunks, NULL for normal output
+    long context;	// context lines of unified output
+    const char *labelA;	// name and time of file A in unified output
+    const char *labelB;
+    long linesA;	// lines in file A, limits the context at the end
+    long linesB;
+    long firstA;	// first line of A compared, at the same place as firstB
+    long firstB;
 };
 
 
 struct diffmanager_s *diffmanager_new(void);
 void diffmanager_delete(struct diffmanager_s *manager);
 
+/** set the flags to compare lines with.
+ * Lines equal after hash_normalise() are treated as common lines.
+ *
+ * @param manager: diffmanager handler
+ * @param flags: HASH_IGNORE_* flags
+ */
+void diffmanager_set_compare_flags(struct diffmanager_s *manager, int flags);
+
+/** leave out hunks which only delete or insert blank lines, like "diff -B".
+ * The lines are still stored, only their output is left out. A line is
+ * blank if it is empty, or white space only if HASH_IGNORE_SPACE_CHANGE or
+ * HASH_IGNORE_ALL_SPACE is set.
+ *
+ * @param manager: diffmanager handler
+ */
+void diffmanager_enable_ignore_blank_lines(struct diffmanager_s *manager);
+
+/** set the mask to apply to lines before comparing them.
+ *
+ * @param manager: diffmanager handler
+ * @param mask: compiled mask, NULL for none. Must live as long as manager.
+ */
+void diffmanager_set_mask(struct diffmanager_s *manager, const struct mask_s *mask);
+
+/** set the spill files holding the long lines of file A and B.
+ * Placeholder lines are replaced by the long lines on output.
+ *
+ * @param manager: diffmanager handler
+ * @param longlineA: long lines of file A, may be NULL
+ * @param longlineB: long lines of file B, may be NULL
+ */
+void diffmanager_set_longlines(struct diffmanager_s *manager, struct longline_s *longlineA, struct longline_s *longlineB);
+
+/** store equal lines only once.
+ * Pays off if few distinct lines make up most of the differences. Must be
+ * called before the first line is put into storage.
+ *
+ * @param manager: diffmanager handler
+ */
+void diffmanager_enable_intern(struct diffmanager_s *manager);
+
+/** pack stored lines into compressed segments.
+ * The last 16MB of lines of each file stay unpacked, older lines are
+ * unpacked again while they are compared or printed.
+ *
+ * @param manager: diffmanager handler
+ * @param level: zlib compression level 1 (fast) to 9 (small), 0 for none
+ * @return 0 on success, -1 if lfdiff is built without zlib
+ */
+int diffmanager_set_compression(struct diffmanager_s *manager, int level);
+
+/** report blocks of lines moved from one place to another.
+ * A block deleted from A and inserted unchanged in B at another place is
+ * printed as one line "NmM", N being the lines of A and M the lines in B.
+ * Moves are looked for when all lines are stored, the text of neither copy
+ * is printed.
+ *
+ * @param manager: diffmanager handler
+ * @param minlines: smallest block to report as moved, 0 to turn it off
+ */
+void diffmanager_set_moves(struct diffmanager_s *manager, long minlines);
+
+/** print the diff in unified format.
+ * The common lines printed around the hunks are put in by
+ * diffmanager_input_context(), the lines removed as common by
+ * diffmanager_remove_common_lines() are kept as context.
+ *
+ * @param manager: diffmanager handler
+ * @param context: common lines printed before and after each hunk
+ * @param labelA: name and time of file A, printed in the header. Must live
+ *   as long as manager.
+ * @param labelB: name and time of file B
+ */
+void diffmanager_set_unified(struct diffmanager_s *manager, long context, const char *labelA, const char *labelB);
+
+/** set the number of lines of file A and B.
+ * Needed by the unified output to end the context at the end of the files.
+ */
+void diffmanager_set_line_count(struct diffmanager_s *manager, long linesA, long linesB);
+
+/** set the first lines of file A and B to compare, the lines in front of
+ * them have been compared by an earlier run. Line firstA of A is at the same
+ * place as line firstB of B. Call before any line is put in.
+ */
+void diffmanager_set_first_lines(struct diffmanager_s *manager, long firstA, long firstB);
+
+/** put a common line of file A into storage, printed as context.
+ * The line is copied. It is skipped if line nr of A is stored as a differing
+ * line.
+ *
+ * @param manager: diffmanager handler
+ * @param line: line including the newline character, not NUL terminated
+ * @param len: length of line
+ * @param nr: line number in file A
+ */
+void diffmanager_input_context(struct diffmanager_s *manager, const char *line, size_t len, long nr);
+
 /** put diff line into storage.
  * The storage is memory optimized on the way, i.e. double entries are going
  * to be deleted during this input.
@@ -61,6 +189,30 @@ void diffmanager_delete(struct diffmanager_s *manager);
  */
 void diffmanager_input_diff(struct diffmanager_s *manager, const char *line, long nr);
 
+/** put diff line into storage without copying it.
+ * The stored line points into block and holds a reference on it until the
+ * line is printed or removed.
+ *
+ * @param manager: diffmanager handler
+ * @param block: block holding the line
+ * @param line: line of file A or B in block, starting with '<' or '>'
+ * @param len: length of line including newline character
+ * @param nr: line number
+ */
+void diffmanager_input_diff_block(struct diffmanager_s *manager, struct diff_block_s *block, const char *line, size_t len, long nr);
+
+/** put a line taken from the input into storage, the way "diff" would
+ * print it. A last line without newline keeps it missing and is printed
+ * with the "\ No newline at end of file" marker.
+ *
+ * @param manager: diffmanager handler
+ * @param side: '<' for a line of file A, '>' for file B
+ * @param line: line of the input, not NUL terminated
+ * @param len: length of line including newline character if any
+ * @param nr: line number
+ */
+void diffmanager_input_line(struct diffmanager_s *manager, char side, const char *line, size_t len, long nr);
+
 /** output diff up to line maxLineNr to stream output.
  * note: calls diffmanager_remove_common_lines() and diffmanager_delete_diff() during execution
  *
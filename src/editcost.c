@@ -0,0 +1,111 @@
+/*
+ * editcost.c
+ *
+ *  Created on: 18.10.2026
+ *      Author: jh
+ */
+
+/*
+    Lower bound of the edit cost between two slices of lfdiff
+
+    Copyright (C) 2017  Jörg Habenicht (jh@mwerk.net)
+
+    This file is part of lfdiff
+
+    lfdiff is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    lfdiff is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+
+#include "editcost.h"
+
+#include <stdlib.h>
+#include <assert.h>
+
+
+/* distinct line of A and B */
+struct editcost_entry_s {
+    uint64_t hash;
+    size_t count[2];	// occurrences in A and B
+    size_t posB;	// position of the last occurrence in B
+    int used;
+};
+
+/* open addressing, the table is at most half full */
+static struct editcost_entry_s *editcost_lookup(struct editcost_entry_s *table, size_t mask, uint64_t hash) {
+    size_t i = hash & mask;
+    while (table[i].used && table[i].hash != hash)
+	i = (i + 1) & mask;
+    table[i].used = 1;
+    table[i].hash = hash;
+
+    return &table[i];
+}
+
+int64_t editcost_lower_bound(const uint64_t *hashA, size_t countA, const uint64_t *hashB, size_t countB) {
+
+    size_t size = 16;
+    while (size < 2 * (countA + countB))
+	size *= 2;
+    struct editcost_entry_s *table = calloc(size, sizeof(*table));
+    assert(table);
+
+    size_t i;
+    for (i=0; i<countA; i++)
+	editcost_lookup(table, size - 1, hashA[i])->count[0]++;
+    for (i=0; i<countB; i++) {
+	struct editcost_entry_s *entry = editcost_lookup(table, size - 1, hashB[i]);
+	entry->count[1]++;
+	entry->posB = i;
+    }
+
+    // lines repeated in A or B match as often as the fewer occurrences
+    size_t common = 0;
+    for (i=0; i<size; i++) {
+	const struct editcost_entry_s *entry = &table[i];
+	if (entry->used && (1 != entry->count[0] || 1 != entry->count[1]))
+	    common += entry->count[0] < entry->count[1]? entry->count[0]: entry->count[1];
+    }
+
+    /* the lines found once in A and B match in order only: longest
+     * increasing subsequence of their positions in B, by patience sorting.
+     * tail[k] is the smallest end of an increasing subsequence of k+1.
+     */
+    size_t *tail = malloc((countA + 1) * sizeof(*tail));
+    assert(tail);
+    size_t longest = 0;
+    for (i=0; i<countA; i++) {
+	const struct editcost_entry_s *entry = editcost_lookup(table, size - 1, hashA[i]);
+	if (1 != entry->count[0] || 1 != entry->count[1])
+	    continue;
+	size_t low = 0, high = longest;
+	while (low < high) {
+	    const size_t middle = (low + high) / 2;
+	    if (tail[middle] < entry->posB)
+		low = middle + 1;
+	    else
+		high = middle;
+	}
+	tail[low] = entry->posB;
+	if (low == longest)
+	    longest++;
+    }
+    common += longest;
+
+    free(tail);
+    free(table);
+
+    return (int64_t) (countA + countB) - 2 * (int64_t) common;
+}
@@ -0,0 +1,52 @@
+/*
+ * editcost.h
+ *
+ *  Created on: 18.10.2026
+ *      Author: jh
+ */
+
+/*
+    Lower bound of the edit cost between two slices of lfdiff
+
+    Copyright (C) 2017  Jörg Habenicht (jh@mwerk.net)
+
+    This file is part of lfdiff
+
+    lfdiff is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    lfdiff is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+
+#ifndef SRC_ANSIC_EDITCOST_H_
+#define SRC_ANSIC_EDITCOST_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+/** get a lower bound of the lines deleted and inserted by any diff of two
+ * sequences of lines, in linear memory and O(n log n) time.
+ * A common subsequence holds at most the longest increasing subsequence of
+ * the lines found once in both sequences, and of the other lines at most
+ * as many as both sequences have. Exact if no line is repeated, e.g. for
+ * reordered records.
+ *
+ * @param hashA: hashes of the lines of A
+ * @param hashB: hashes of the lines of B
+ * @return: lines of A and B not in the longest common subsequence, at least
+ */
+int64_t editcost_lower_bound(const uint64_t *hashA, size_t countA, const uint64_t *hashB, size_t countB);
+
+#endif /* SRC_ANSIC_EDITCOST_H_ */
@@ -0,0 +1,275 @@
+/*
+ * hash.c
+ *
+ *  Created on: 18.10.2026
+ *      Author: jh
+ */
+
+/*
+    Hash functions over lines and blocks of lines
+
+    Copyright (C) 2017  Jörg Habenicht (jh@mwerk.net)
+
+    This file is part of lfdiff
+
+    lfdiff is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    lfdiff is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "hash.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#define HASH_MUL1	0x9E3779B97F4A7C15ull
+#define HASH_MUL2	0xBF58476D1CE4E5B9ull
+
+#define HASH_ONES	0x0101010101010101ull
+#define HASH_HIGHS	0x8080808080808080ull
+// any byte of word x is < n, valid for n <= 128
+#define HASH_HASLESS(x,n)	(((x) - HASH_ONES*(n)) & ~(x) & HASH_HIGHS)
+// any byte of word x is > m and < n, valid for m <= 127 and n <= 128
+#define HASH_HASBETWEEN(x,m,n)	(((HASH_ONES*(127+(n)) - ((x) & HASH_ONES*127)) & ~(x) & (((x) & HASH_ONES*127) + HASH_ONES*(127-(m)))) & HASH_HIGHS)
+
+// size of buffer on stack to normalise short lines
+#define HASH_STACKBUFFER_LEN	256
+
+#define HASH_IGNORE_SPACE	(HASH_IGNORE_SPACE_CHANGE|HASH_IGNORE_ALL_SPACE)
+
+
+static inline uint64_t hash_mix(uint64_t h) {
+    h ^= h >> 31;
+    h *= HASH_MUL2;
+    h ^= h >> 29;
+    return h;
+}
+
+uint64_t hash_bytes(const void *data, size_t len, uint64_t seed) {
+    const unsigned char *p = data;
+    uint64_t h = seed ^ (len * HASH_MUL1);
+
+    // process 8 bytes at once
+    while (len >= sizeof(uint64_t)) {
+	uint64_t w;
+	memcpy(&w, p, sizeof(w));
+	h = (h ^ hash_mix(w * HASH_MUL1)) * HASH_MUL2;
+	h ^= h >> 32;
+	p += sizeof(w);
+	len -= sizeof(w);
+    }
+
+    // remaining tail
+    if (len) {
+	uint64_t w = 0;
+	memcpy(&w, p, len);
+	h = (h ^ hash_mix(w * HASH_MUL1)) * HASH_MUL2;
+	h ^= h >> 32;
+    }
+
+    return hash_mix(h);
+}
+
+static inline int hash_is_space(unsigned char c) {
+    return ' ' == c || '\t' == c || '\v' == c || '\f' == c || '\r' == c;
+}
+
+size_t hash_normalise(const char *data, size_t len, char *out, int flags) {
+    assert(data || !len);
+    assert(out || !len);
+
+    const char *p = data;
+    const char * const end = data + len;
+    char *o = out;
+    char *linestart = out;	// start of current line in output
+    int space = 0;		// white space pending to be squeezed into one
+
+    while (p < end) {
+	// fast path: copy words which do not contain any character to change
+	if (end - p >= (long) sizeof(uint64_t)) {
+	    uint64_t w;
+	    memcpy(&w, p, sizeof(w));
+	    uint64_t special = 0;
+	    if (flags & (HASH_IGNORE_SPACE|HASH_IGNORE_BLANK_LINES))
+		special |= HASH_HASLESS(w, '!');	// white space and newline
+	    if (flags & HASH_IGNORE_CASE)
+		special |= HASH_HASBETWEEN(w, 'A'-1, 'Z'+1);
+	    if (!special) {
+		if (space) {
+		    *o++ = ' ';
+		    space = 0;
+		}
+		memcpy(o, p, sizeof(w));
+		o += sizeof(w);
+		p += sizeof(w);
+		continue;
+	    }
+	}
+
+	unsigned char c = *p++;
+	if ('\n' == c) {
+	    // trailing white space is ignored
+	    space = 0;
+	    if ((flags & HASH_IGNORE_BLANK_LINES) && o == linestart)
+		continue;
+	    *o++ = c;
+	    linestart = o;
+	    continue;
+	}
+	if ((flags & HASH_IGNORE_SPACE) && hash_is_space(c)) {
+	    if (!(flags & HASH_IGNORE_ALL_SPACE))
+		space = 1;
+	    continue;
+	}
+	if (space) {
+	    *o++ = ' ';
+	    space = 0;
+	}
+	if ((flags & HASH_IGNORE_CASE) && 'A' <= c && 'Z' >= c)
+	    c += 'a' - 'A';
+	*o++ = c;
+    }
+
+    return o - out;
+}
+
+uint64_t hash_lines(const char *data, size_t len, int flags) {
+
+    if (!flags)
+	return hash_bytes(data, len, 0);
+
+    char stackbuffer[HASH_STACKBUFFER_LEN];
+    char *buffer = len <= sizeof(stackbuffer)? stackbuffer: malloc(len);
+    assert(buffer);
+
+    const size_t normlen = hash_normalise(data, len, buffer, flags);
+    const uint64_t hash = hash_bytes(buffer, normlen, 0);
+
+    if (buffer != stackbuffer)
+	free(buffer);
+
+    return hash;
+}
+
+int hash_lines_equal(const char *a, size_t lena, const char *b, size_t lenb, int flags) {
+
+    if (!flags)
+	return lena == lenb && !memcmp(a, b, lena);
+
+    char stackbuffer[2][HASH_STACKBUFFER_LEN];
+    char *buffera = lena <= sizeof(stackbuffer[0])? stackbuffer[0]: malloc(lena);
+    char *bufferb = lenb <= sizeof(stackbuffer[1])? stackbuffer[1]: malloc(lenb);
+    assert(buffera);
+    assert(bufferb);
+
+    const size_t normlena = hash_normalise(a, lena, buffera, flags);
+    const size_t normlenb = hash_normalise(b, lenb, bufferb, flags);
+    const int equal = normlena == normlenb && !memcmp(buffera, bufferb, normlena);
+
+    if (buffera != stackbuffer[0])
+	free(buffera);
+    if (bufferb != stackbuffer[1])
+	free(bufferb);
+
+    return equal;
+}
+
+const uint64_t hash_gear[256] = {
+    0x6eeaaa17344832a1ull, 0x2aeba765b90edb54ull, 0x32e58548f344fe55ull,
+    0x0659c3f92bb22c2bull, 0x75dd70df19a0673aull, 0x7ced1d319294b3c1ull,
+    0x833c050fa7e3e40bull, 0xc45877f7f5290210ull, 0xe0495770d1a85be3ull,
+    0xb70fb3a438e3ee93ull, 0xcfdbdeb9e53132bcull, 0x9fad5a7d82055889ull,
+    0xe060fe99b1b90a5bull, 0x06bd76da2e72efd6ull, 0x75b16b35a4a2fabfull,
+    0xf671768193f22973ull, 0x343ecce142975ef4ull, 0x3cd0c86cdaaddb30ull,
+    0x11b24f51879723a2ull, 0xd2535920d6394d21ull, 0xeb7add06581247c2ull,
+    0x71794e7dc7c78675ull, 0xcfa4531c9994c34full, 0x0fa0fa688d2a3631ull,
+    0x1a026a30eb746105ull, 0x9351474bc078c900ull, 0x614ffb6d4fe2986aull,
+    0x30d04946a2d1a423ull, 0x976878953a1ba559ull, 0x1ba3694ca2cbbb8dull,
+    0xd3d7a1c255a88305ull, 0x46f14ba3f4eff722ull, 0x9fdac69bc8a84a70ull,
+    0xb45c97fd85874810ull, 0x16607c0909de7c96ull, 0x49a19d755ed93c71ull,
+    0x0cab59a07029c795ull, 0x7f38cb409f26f9feull, 0xe54eddc2fa546261ull,
+    0xc0a242cff46e3937ull, 0x73ec41d7ddf9993eull, 0x4ed14e4b6021e756ull,
+    0x47352f3ce0055997ull, 0x54f1b39ff88b6372ull, 0xeb9c2d4ad5aa40f6ull,
+    0x3ff7ff0f2ccd7d0eull, 0x71d3fe0c05aa45d6ull, 0xd7f2a0a40af6c224ull,
+    0x4e922876b5ccd018ull, 0xe94fb1154c34d13dull, 0x77f702fa763df376ull,
+    0x9bc3015d0e67bd75ull, 0x9a6924c115b6d9baull, 0xe9ef2548d5069927ull,
+    0x173c82e0680ac9ceull, 0x47b8cb918e950d8eull, 0x369b51af458fbe1bull,
+    0x7506eca2056cef7aull, 0xc77e8279f1887377ull, 0x8f648169091477d7ull,
+    0x4e7e96ffb5a6b201ull, 0x8cc5e3c4cb2f0e6aull, 0x39481e91896578b5ull,
+    0x9673e9e6a450ff11ull, 0x3ee6e94b51e07038ull, 0xf382cf02948ae99aull,
+    0xc9fe5c1729106abfull, 0x9c8ee51af23360dbull, 0x47703fd6c8c5232bull,
+    0xe8aa446b312d09b2ull, 0x601f7f5df7fd9dc1ull, 0x0c10388cca19f47bull,
+    0x3463a879c7d1b8f2ull, 0xfe912770741b5d7full, 0x857cd02315311a9aull,
+    0xbed56460ce94be6eull, 0x7dacde7ff24d0e87ull, 0x7c05884e453f714bull,
+    0x2c70c25a3f49c322ull, 0xbdbd369dadbba650ull, 0x74d4a31bd7f3c8fdull,
+    0xd30708ff9917b988ull, 0xee34760aba7f5ea7ull, 0x21897be05e4e335eull,
+    0xba56f91391d2a0e6ull, 0xe690b281274e8d25ull, 0x0c705453bb7b853bull,
+    0x30c3f1776e26025dull, 0xaf1e179cea57ad65ull, 0xe3b6836cd0c8c26cull,
+    0x63fc8f29fae6ee7eull, 0x1ce14c12de5bf74eull, 0xc0896cc9b0aa47bcull,
+    0x277272541c16cd05ull, 0xa38c16dcff2f1a55ull, 0x9c32a729df63cccfull,
+    0x6711d65183da22b1ull, 0x86848364e4e8c92full, 0x5eb07da147564802ull,
+    0x290d19e3aeed6f96ull, 0x43caa1e880523a80ull, 0x3861be3ef0d6504bull,
+    0xe49802bb25fca7fcull, 0x3057a8bfad704a70ull, 0x67c3e1565d2ab7edull,
+    0x495c1463a1b7b5ccull, 0x0705e37895a60a66ull, 0x86b70887603d80cdull,
+    0x0c8ea9fb418ad965ull, 0x31d1b96737958fc4ull, 0xa5ea0544716cd1f6ull,
+    0x5c101841693986ddull, 0x940ddd46c83cdfb3ull, 0x01f4e787158124e8ull,
+    0xa0d7ca319e0dbfabull, 0x5769cd7125bfcdccull, 0x2c19d467963fb361ull,
+    0xfd1291a4ea92b797ull, 0x4e3b7efa0dbb55d3ull, 0xd58cbc63cf5a0c60ull,
+    0x09871cd48e20569cull, 0xea0ec658f38427abull, 0xf3ed52e83fbb0091ull,
+    0xc30db070c72c3f82ull, 0x4fb64ddcf703ab06ull, 0xefc75649410e81bdull,
+    0xdee9d7253642466full, 0x607962492775f684ull, 0x48573701441a2ca4ull,
+    0x3057da09d86bc70dull, 0x287efa37ab79f1a5ull, 0x381ec07867e96902ull,
+    0x98303a959ced52dcull, 0x7f9937c2d894e52bull, 0xab426593c81ba1faull,
+    0x0f96763626e88d4dull, 0x291e50ef5820a0c0ull, 0xce94952c70a4cf4eull,
+    0x73e8d0be02226789ull, 0x1f116377454d71b6ull, 0x31efa250c1800735ull,
+    0x43b9d2d85ccf0bc1ull, 0x992bbe7e0a80c785ull, 0xe338099067d71938ull,
+    0x9dc74e1a32182942ull, 0x42e8428289e2def7ull, 0xfcc7680205542c1full,
+    0x9a3bf3e72dae5e74ull, 0x4b7b599abc92c083ull, 0x520989fe6b003cd6ull,
+    0x4a157d37046a9747ull, 0xf490c82225975be3ull, 0xb7f83a93e3459408ull,
+    0x7406d649e265f5d1ull, 0xe21a700d6d51220bull, 0x59797b885b494fc6ull,
+    0xf6c386acdb76efd5ull, 0x57c0503ecf34d405ull, 0xd5bca5881c3aecd9ull,
+    0x61662ac97a578026ull, 0x2d5e7ebb10f3b5eeull, 0x9f9d15ff2f989e8full,
+    0x84d8bc8c9087e7abull, 0x63c25662325cab99ull, 0x1e682af5308316e6ull,
+    0xa609c21b8d622a1dull, 0xdae2db8d8314535eull, 0x2fbedd3ad8a5e07cull,
+    0x299c2fe309ce1104ull, 0x2674c1794d951dc8ull, 0x31574924227a6889ull,
+    0xd8fa11bf1eb9c3c0ull, 0x3cd11bf5835923aaull, 0xf4a5df00eaeb95beull,
+    0x4505f8f18982d759ull, 0xfa7e5f7c5d7102f5ull, 0x44c98b8db2c271bbull,
+    0x913c98c8cc313efdull, 0x9994ea2039735dfcull, 0xb2ef0b93f72f0e5full,
+    0x602a61841d15b71aull, 0xdd4fe6f14a4eaa6dull, 0x35021d8a8506b740ull,
+    0x943465d4d11c0e36ull, 0x1e63c01aaa97c494ull, 0x07acd0a2061aa79aull,
+    0x6e644d7622ab7efcull, 0xdc88b5d6f7881eeaull, 0xdad5fb1342c9a2f7ull,
+    0x02d5586ae634b277ull, 0x13c0ff18a6a9d2aeull, 0xb40b478247a965f6ull,
+    0x54efc36cc4502448ull, 0x890eb25d1a4ca4feull, 0xdfd1ba77a9d58b3bull,
+    0x5831677f2212f487ull, 0x92e9a1586c575e04ull, 0x3c87ef641af31e7eull,
+    0xf954034ba85d484aull, 0x304ec4cd41b14e55ull, 0x9f6a34c51a493a3full,
+    0x729224107e7e7db4ull, 0x498a4f8fd4c9808dull, 0x209c422083518f34ull,
+    0x51487bdb96ad454full, 0x797d5d1b3492397full, 0x743ad286ca4df1c1ull,
+    0xffc91b65e9921c57ull, 0x48388ee62aec7c6eull, 0xc8dbde9c73c18c3full,
+    0xfd0d35d5bf2e2d8dull, 0x49238f0f5da2739bull, 0x966f07387af3f806ull,
+    0xdf3f2c0a416692a5ull, 0x8f82e2d7ed649ca0ull, 0xf78ae8d9e7677c22ull,
+    0xa18e878d2d5df8a8ull, 0xe2935c4ab8e44a11ull, 0x15eb89f7258c8324ull,
+    0x782585acd1e21786ull, 0x2a2af165281f56e0ull, 0x6a4df3b12ed514d1ull,
+    0x129da2ddb5240f04ull, 0x728d17c85ae1fad3ull, 0xe7541e6905a3b7f5ull,
+    0x26803b3fdac6a347ull, 0xac58806c890e3d12ull, 0xc1ccfbe103148395ull,
+    0x8439c1c34ea203d1ull, 0x572843e973957cabull, 0x8a67562c617871a3ull,
+    0x31f466422c013584ull, 0x9457075fbe07ef2eull, 0xd08b8ee387b64937ull,
+    0x108950ee1ec3d1e3ull, 0xba9fd0f449a545cbull, 0xee830b00259708f2ull,
+    0x6ccfffea11fdb8f5ull, 0x946a026ec8dc87e8ull, 0x9d8acba2400500b6ull,
+    0x4fec5ace6903ab0dull, 0x95c24f89380187a7ull, 0x2686b8c1098ec05eull,
+    0x3537c5aa8e578ca5ull, 0xfbdadc7d44923416ull, 0xcaf612a780c851aeull,
+    0x75b71623c9fa5ff8ull, 0xcfd378f909f420eaull, 0xee0215b412d15c47ull,
+    0xf86e75ad1fd5e506ull, 0xd539de58617611a0ull, 0x14b5c0ad4a9af722ull,
+    0xea86b49fc441f8dfull, 0x8fb3e6ad24b9f4a9ull, 0xc29b4cb4b40e6390ull,
+    0x4f6bb7733deca25eull,
+};
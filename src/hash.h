@@ -0,0 +1,92 @@
+/*
+ * hash.h
+ *
+ *  Created on: 18.10.2026
+ *      Author: jh
+ */
+
+/*
+    Hash functions over lines and blocks of lines
+
+    Copyright (C) 2017  Jörg Habenicht (jh@mwerk.net)
+
+    This file is part of lfdiff
+
+    lfdiff is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    lfdiff is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef SRC_ANSIC_HASH_H_
+#define SRC_ANSIC_HASH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+/* flags to compare lines like "diff -i -b -w -B" */
+enum {
+    HASH_IGNORE_CASE = 1,		// diff -i
+    HASH_IGNORE_SPACE_CHANGE = 2,	// diff -b
+    HASH_IGNORE_ALL_SPACE = 4,		// diff -w
+    HASH_IGNORE_BLANK_LINES = 8,	// diff -B
+};
+
+
+/** hash a memory block.
+ * The hash is not cryptographic, it is meant to find equal data fast. Two
+ * blocks with the same hash should still be compared byte by byte if the
+ * result has to be exact.
+ *
+ * @param data: pointer to memory block
+ * @param len: length of memory block in bytes
+ * @param seed: start value, use the result of a previous call to chain blocks
+ * @return: 64 bit hash value
+ */
+uint64_t hash_bytes(const void *data, size_t len, uint64_t seed);
+
+/** normalise lines according to the compare flags.
+ * Upper case letters are lowered, white space is squeezed or removed and
+ * blank lines are removed. The result never gets longer than the input.
+ * Runs of 8 bytes without any character to change are copied at once.
+ *
+ * @param data: one or more lines
+ * @param len: length of data in bytes
+ * @param out: buffer of at least len bytes for the normalised lines
+ * @param flags: HASH_IGNORE_* flags
+ * @return: length of normalised lines
+ */
+size_t hash_normalise(const char *data, size_t len, char *out, int flags);
+
+/** hash one or more lines according to the compare flags.
+ * Equal lines after hash_normalise() return the same hash value.
+ *
+ * @param data: one or more lines
+ * @param len: length of data in bytes
+ * @param flags: HASH_IGNORE_* flags, 0 to hash the data as is
+ * @return: 64 bit hash value
+ */
+uint64_t hash_lines(const char *data, size_t len, int flags);
+
+/** compare lines according to the compare flags.
+ * @return: 1 if equal after hash_normalise(), else 0
+ */
+int hash_lines_equal(const char *a, size_t lena, const char *b, size_t lenb, int flags);
+
+/** table of random values for the gear rolling hash.
+ * A content defined boundary is found if the rolling value
+ * h = (h << 1) + hash_gear[byte] has the lowest bits all zero.
+ */
+extern const uint64_t hash_gear[256];
+
+#endif /* SRC_ANSIC_HASH_H_ */
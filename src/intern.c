@@ -0,0 +1,133 @@
+/*
+ * intern.c
+ *
+ *  Created on: 18.10.2026
+ *      Author: jh
+ */
+
+/*
+    Interned storage of repeated line contents
+
+    Copyright (C) 2017  Jörg Habenicht (jh@mwerk.net)
+
+    This file is part of lfdiff
+
+    lfdiff is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    lfdiff is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#include "intern.h"
+#include "hash.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <assert.h>
+
+// initial number of buckets, the table grows with the number of entries
+#define INTERN_BUCKETS	1024
+
+
+struct intern_s *intern_new(void) {
+    struct intern_s *intern = calloc(1, sizeof(*intern));
+    assert(intern);
+    intern->buckets = INTERN_BUCKETS;
+    intern->bucket = calloc(intern->buckets, sizeof(*intern->bucket));
+    assert(intern->bucket);
+
+    return intern;
+}
+
+void intern_delete(struct intern_s *intern) {
+    assert(intern);
+    assert(!intern->count);
+
+    free(intern->bucket);
+    free(intern);
+}
+
+/* double the number of buckets */
+static void intern_grow(struct intern_s *intern) {
+
+    const size_t buckets = 2 * intern->buckets;
+    struct intern_entry_s **bucket = calloc(buckets, sizeof(*bucket));
+    assert(bucket);
+
+    size_t i;
+    for (i=0; i<intern->buckets; i++) {
+	struct intern_entry_s *entry;
+	while ((entry = intern->bucket[i])) {
+	    intern->bucket[i] = entry->next;
+	    entry->next = bucket[entry->hash & (buckets - 1)];
+	    bucket[entry->hash & (buckets - 1)] = entry;
+	}
+    }
+    free(intern->bucket);
+    intern->bucket = bucket;
+    intern->buckets = buckets;
+}
+
+const char *intern_get(struct intern_s *intern, const char *data, size_t len) {
+    assert(intern);
+    assert(data || !len);
+
+    const uint64_t hash = hash_bytes(data, len, 0);
+    struct intern_entry_s **bucket = &intern->bucket[hash & (intern->buckets - 1)];
+    struct intern_entry_s *entry;
+
+    intern->lookups++;
+    for (entry = *bucket; entry; entry = entry->next) {
+	if (entry->hash == hash && entry->len == len && !memcmp(entry->data, data, len)) {
+	    entry->refcount++;
+	    intern->hits++;
+	    intern->savedbytes += len + 1;
+	    return entry->data;
+	}
+    }
+
+    entry = malloc(sizeof(*entry) + len + 1);
+    assert(entry);
+    entry->hash = hash;
+    entry->len = len;
+    entry->refcount = 1;
+    memcpy(entry->data, data, len);
+    entry->data[len] = '\0';
+    entry->next = *bucket;
+    *bucket = entry;
+
+    if (++intern->count > intern->maxcount)
+	intern->maxcount = intern->count;
+    if ((size_t) intern->count > intern->buckets)
+	intern_grow(intern);
+
+    return entry->data;
+}
+
+void intern_put(struct intern_s *intern, const char *data) {
+    assert(intern);
+    assert(data);
+
+    struct intern_entry_s *entry = (struct intern_entry_s *) (data - offsetof(struct intern_entry_s, data));
+    assert(entry->refcount > 0);
+    if (--entry->refcount)
+	return;
+
+    struct intern_entry_s **it = &intern->bucket[entry->hash & (intern->buckets - 1)];
+    while (*it != entry)
+	it = &(*it)->next;
+    *it = entry->next;
+    intern->count--;
+    free(entry);
+}
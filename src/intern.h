@@ -0,0 +1,73 @@
+/*
+ * intern.h
+ *
+ *  Created on: 18.10.2026
+ *      Author: jh
+ */
+
+/*
+    Interned storage of repeated line contents
+
+    Copyright (C) 2017  Jörg Habenicht (jh@mwerk.net)
+
+    This file is part of lfdiff
+
+    lfdiff is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    lfdiff is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#ifndef SRC_ANSIC_INTERN_H_
+#define SRC_ANSIC_INTERN_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+struct intern_entry_s {
+    struct intern_entry_s *next;	// next entry in bucket
+    uint64_t hash;	// hash of data
+    size_t len;		// length of data
+    long refcount;
+    char data[];	// content, NUL terminated
+};
+
+struct intern_s {
+    struct intern_entry_s **bucket;
+    size_t buckets;	// number of buckets, power of 2
+    long count;		// number of distinct entries
+    /* statistics */
+    long lookups;	// calls to intern_get()
+    long hits;		// lookups finding an entry
+    long maxcount;	// max number of distinct entries
+    unsigned long long savedbytes;	// bytes not allocated due to hits
+};
+
+
+struct intern_s *intern_new(void);
+/** free the table. All entries must have been put back. */
+void intern_delete(struct intern_s *intern);
+
+/** get the interned copy of data.
+ * @param data: content, need not be NUL terminated
+ * @param len: length of content
+ * @return: pointer to the stored copy, NUL terminated. Release with
+ *   intern_put().
+ */
+const char *intern_get(struct intern_s *intern, const char *data, size_t len);
+
+/** release a copy returned by intern_get(). */
+void intern_put(struct intern_s *intern, const char *data);
+
+#endif /* SRC_ANSIC_INTERN_H_ */
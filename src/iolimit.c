@@ -0,0 +1,135 @@
+/*
+ * iolimit.c
+ *
+ *  Created on: 18.10.2026
+ *      Author: jh
+ */
+
+/*
+    Rate limit and low priority reading of the inputs
+
+    Copyright (C) 2017  Jörg Habenicht (jh@mwerk.net)
+
+    This file is part of lfdiff
+
+    lfdiff is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    lfdiff is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+
+#define _GNU_SOURCE
+#include "iolimit.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+
+/* see linux/ioprio.h, not installed everywhere */
+#define IOLIMIT_IOPRIO_CLASS_SHIFT	13
+#define IOLIMIT_IOPRIO_CLASS_IDLE	3
+#define IOLIMIT_IOPRIO_WHO_PROCESS	1
+
+
+static double iolimit_elapsed(const struct timespec *from, const struct timespec *to) {
+    return (to->tv_sec - from->tv_sec) + (to->tv_nsec - from->tv_nsec) / 1e9;
+}
+
+struct iolimit_s *iolimit_new(double rate, int dontneed) {
+    assert(rate >= 0);
+
+    struct iolimit_s *limit = calloc(1, sizeof(*limit));
+    assert(limit);
+    pthread_mutex_init(&limit->mutex, NULL);
+    limit->rate = rate;
+    // a tenth of a second, readers may not sleep for every read
+    limit->burst = rate / 10;
+    limit->tokens = limit->burst;
+    limit->dontneed = dontneed;
+    clock_gettime(CLOCK_MONOTONIC, &limit->start);
+    limit->last = limit->start;
+
+    return limit;
+}
+
+void iolimit_delete(struct iolimit_s *limit) {
+    assert(limit);
+
+    pthread_mutex_destroy(&limit->mutex);
+    free(limit);
+}
+
+void iolimit_take(struct iolimit_s *limit, size_t bytes) {
+    assert(limit);
+
+    double wait = 0;
+    pthread_mutex_lock(&limit->mutex);
+    limit->bytes += bytes;
+    if (limit->rate) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	limit->tokens += iolimit_elapsed(&limit->last, &now) * limit->rate;
+	if (limit->tokens > limit->burst)
+	    limit->tokens = limit->burst;
+	limit->last = now;
+	limit->tokens -= bytes;
+	if (limit->tokens < 0) {
+	    // the debt of the other readers is paid back first
+	    wait = -limit->tokens / limit->rate;
+	    limit->throttled += wait;
+	}
+    }
+    pthread_mutex_unlock(&limit->mutex);
+
+    if (wait > 0) {
+	struct timespec ts;
+	ts.tv_sec = (time_t) wait;
+	ts.tv_nsec = (long) ((wait - ts.tv_sec) * 1e9);
+	while (nanosleep(&ts, &ts) && EINTR == errno)
+	    ;
+    }
+}
+
+void iolimit_drop(const struct iolimit_s *limit, int fd, off_t offset, off_t len) {
+    assert(limit);
+
+    // fails on pipes and sockets, nothing to drop there
+    if (limit->dontneed && len > 0)
+	(void) posix_fadvise(fd, offset, len, POSIX_FADV_DONTNEED);
+}
+
+double iolimit_seconds(const struct iolimit_s *limit) {
+    assert(limit);
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return iolimit_elapsed(&limit->start, &now);
+}
+
+int iolimit_idle_priority(void) {
+#ifdef SYS_ioprio_set
+    const int prio = IOLIMIT_IOPRIO_CLASS_IDLE << IOLIMIT_IOPRIO_CLASS_SHIFT;
+    return syscall(SYS_ioprio_set, IOLIMIT_IOPRIO_WHO_PROCESS, 0, prio)? -1: 0;
+#else
+    errno = ENOSYS;
+    return -1;
+#endif
+}
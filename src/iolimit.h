@@ -0,0 +1,83 @@
+/*
+ * iolimit.h
+ *
+ *  Created on: 18.10.2026
+ *      Author: jh
+ */
+
+/*
+    Rate limit and low priority reading of the inputs
+
+    Copyright (C) 2017  Jörg Habenicht (jh@mwerk.net)
+
+    This file is part of lfdiff
+
+    lfdiff is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    lfdiff is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+
+#ifndef SRC_ANSIC_IOLIMIT_H_
+#define SRC_ANSIC_IOLIMIT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/types.h>
+
+
+/* token bucket shared by the readers of all inputs. Bytes read take tokens,
+ * a reader in debt sleeps until the rate has paid it back. Counts the bytes
+ * read with or without limit.
+ */
+struct iolimit_s {
+    pthread_mutex_t mutex;
+    double rate;	// bytes per second, 0 for no limit
+    double burst;	// max tokens saved up
+    double tokens;	// bytes which may be read without waiting, < 0 in debt
+    struct timespec last;	// time tokens was updated
+    struct timespec start;	// time of iolimit_new()
+    int dontneed;	// drop the pages read from the page cache
+    unsigned long long bytes;	// bytes read
+    double throttled;	// seconds slept by the readers
+};
+
+
+/** create the limit of all readers.
+ * @param rate: bytes per second, 0 for no limit
+ * @param dontneed: drop the pages of the inputs from the page cache once read
+ */
+struct iolimit_s *iolimit_new(double rate, int dontneed);
+void iolimit_delete(struct iolimit_s *limit);
+
+/** account bytes read by the calling thread, sleep if the rate is exceeded */
+void iolimit_take(struct iolimit_s *limit, size_t bytes);
+
+/** drop the pages of fd from offset to offset+len from the page cache, if
+ * enabled. Pages of other files, pipes and sockets are not touched.
+ */
+void iolimit_drop(const struct iolimit_s *limit, int fd, off_t offset, off_t len);
+
+/** seconds since iolimit_new() */
+double iolimit_seconds(const struct iolimit_s *limit);
+
+/** set the I/O scheduling class of the process to idle. Threads and
+ * processes started afterwards inherit it.
+ * @return: 0 on success, -1 if not supported
+ */
+int iolimit_idle_priority(void);
+
+#endif /* SRC_ANSIC_IOLIMIT_H_ */
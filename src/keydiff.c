@@ -0,0 +1,391 @@
+/*
+ * keydiff.c
+ *
+ *  Created on: 18.10.2026
+ *      Author: jh
+ */
+
+/*
+    Record comparison of delimited files by a key column
+
+    Copyright (C) 2017  Jörg Habenicht (jh@mwerk.net)
+
+    This file is part of lfdiff
+
+    lfdiff is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    lfdiff is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#define _GNU_SOURCE
+#include "keydiff.h"
+#include "hash.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/types.h>
+
+
+enum {
+    KEYDIFF_A = 0,
+    KEYDIFF_B = 1,
+    KEYDIFF_MAX
+};
+
+/* header of one record in a bucket file, followed by the line */
+struct keydiff_record_header_s {
+    long nr;		// line number in input
+    size_t len;		// length of line
+};
+
+struct keydiff_record_s {
+    long nr;
+    char *line;
+    size_t len;
+    const char *key;	// points into line
+    size_t keylen;
+    uint64_t hash;	// hash of key
+    long next;		// next record in hash chain, -1 at the end
+    int matched;	// record found in other input
+};
+
+struct keydiff_s {
+    int column;
+    char delim;
+    int buckets;
+    FILE **bucketfile[KEYDIFF_MAX];	// partitioned input
+    FILE **resultfile;			// diff output per bucket
+    pthread_mutex_t mutex;
+    int nextbucket;			// next bucket to compare, protected by mutex
+    int differ;				// protected by mutex
+};
+
+struct keydiff_partition_args_s {
+    struct keydiff_s *keydiff;
+    FILE *input;
+    int i;		// KEYDIFF_A or KEYDIFF_B
+};
+
+
+/* find the key column in the line */
+static void keydiff_get_key(const struct keydiff_s *keydiff, const char *line, size_t len, const char **key, size_t *keylen) {
+
+    const char *end = line + len;
+    if (len && '\n' == end[-1])
+	end--;
+
+    const char *start = line;
+    int column;
+    for (column=1; column<keydiff->column && start<end; column++) {
+	const char *delim = memchr(start, keydiff->delim, end - start);
+	start = delim? delim + 1: end;
+    }
+
+    const char *delim = memchr(start, keydiff->delim, end - start);
+    *key = start;
+    *keylen = (delim? delim: end) - start;
+}
+
+static void *keydiff_partition_thread(void *args) {
+    assert(args);
+
+    struct keydiff_partition_args_s *myargs = (struct keydiff_partition_args_s *) args;
+    struct keydiff_s *keydiff = myargs->keydiff;
+    char *line = NULL;
+    size_t n = 0;
+    ssize_t len;
+    long nr = 0;
+
+    errno = 0;
+    while (0 <= (len = getline(&line, &n, myargs->input))) {
+	const char *key;
+	size_t keylen;
+	keydiff_get_key(keydiff, line, len, &key, &keylen);
+
+	const uint64_t hash = hash_bytes(key, keylen, 0);
+	FILE *bucket = keydiff->bucketfile[myargs->i][hash % keydiff->buckets];
+	struct keydiff_record_header_s header = { .nr = ++nr, .len = len };
+	if (1 != fwrite(&header, sizeof(header), 1, bucket) || (size_t) len != fwrite(line, 1, len, bucket)) {
+	    fprintf(stderr, "error: writing to bucket file: %s\n", strerror(errno));
+	    abort();
+	}
+    }
+    if (errno) {
+	fprintf(stderr, "error: reading from input file: %s\n", strerror(errno));
+	abort();
+    }
+    free(line);
+
+    return args;
+}
+
+/* read one record of a bucket file.
+ * @return: 0 at end of file, else 1
+ */
+static int keydiff_read_record(const struct keydiff_s *keydiff, FILE *bucket, struct keydiff_record_s *record) {
+
+    struct keydiff_record_header_s header;
+    if (1 != fread(&header, sizeof(header), 1, bucket)) {
+	if (ferror(bucket)) {
+	    fprintf(stderr, "error: reading from bucket file: %s\n", strerror(errno));
+	    abort();
+	}
+	return 0;
+    }
+
+    memset(record, 0, sizeof(*record));
+    record->nr = header.nr;
+    record->len = header.len;
+    record->line = malloc(header.len);
+    assert(record->line);
+    if (header.len != fread(record->line, 1, header.len, bucket)) {
+	fprintf(stderr, "error: reading from bucket file: %s\n", strerror(errno));
+	abort();
+    }
+    keydiff_get_key(keydiff, record->line, record->len, &record->key, &record->keylen);
+    record->hash = hash_bytes(record->key, record->keylen, 0);
+    record->next = -1;
+
+    return 1;
+}
+
+static void keydiff_print_line(FILE *output, char prefix, const char *line, size_t len) {
+
+    fprintf(output, "%c ", prefix);
+    fwrite(line, 1, len, output);
+    if (!len || '\n' != line[len-1])
+	fprintf(output, "\n\\ No newline at end of file\n");
+}
+
+/* compare bucket number "bucket" of A and B.
+ * @return: 1 if the records differ, else 0
+ */
+static int keydiff_compare_bucket(const struct keydiff_s *keydiff, int bucket, FILE *output) {
+
+    FILE *fileA = keydiff->bucketfile[KEYDIFF_A][bucket];
+    FILE *fileB = keydiff->bucketfile[KEYDIFF_B][bucket];
+    struct keydiff_record_s *records = NULL;
+    long count = 0;
+    long capacity = 0;
+    int differ = 0;
+
+    // load all records of A
+    rewind(fileA);
+    for (;;) {
+	if (count == capacity) {
+	    capacity = capacity? 2*capacity: 1024;
+	    records = realloc(records, capacity * sizeof(*records));
+	    assert(records);
+	}
+	if (!keydiff_read_record(keydiff, fileA, &records[count]))
+	    break;
+	count++;
+    }
+
+    // hash table of A records by key, chained through record->next.
+    // insert in reverse order, so the chains keep the order of input A
+    long tablesize = 1;
+    while (tablesize < 2*count)
+	tablesize <<= 1;
+    long *table = malloc(tablesize * sizeof(*table));
+    assert(table);
+    long r;
+    for (r=0; r<tablesize; r++)
+	table[r] = -1;
+    for (r=count-1; r>=0; r--) {
+	const long slot = records[r].hash & (tablesize-1);
+	records[r].next = table[slot];
+	table[slot] = r;
+    }
+
+    // stream records of B and look them up in A
+    struct keydiff_record_s recordB;
+    rewind(fileB);
+    while (keydiff_read_record(keydiff, fileB, &recordB)) {
+	struct keydiff_record_s *recordA = NULL;
+	for (r=table[recordB.hash & (tablesize-1)]; r>=0; r=records[r].next) {
+	    if (!records[r].matched && records[r].hash == recordB.hash
+		    && records[r].keylen == recordB.keylen
+		    && !memcmp(records[r].key, recordB.key, recordB.keylen)) {
+		recordA = &records[r];
+		break;
+	    }
+	}
+
+	if (!recordA) {
+	    fprintf(output, "a%ld\n", recordB.nr);
+	    keydiff_print_line(output, '>', recordB.line, recordB.len);
+	    differ = 1;
+	}
+	else {
+	    recordA->matched = 1;
+	    if (recordA->len != recordB.len || memcmp(recordA->line, recordB.line, recordB.len)) {
+		fprintf(output, "%ldc%ld\n", recordA->nr, recordB.nr);
+		keydiff_print_line(output, '<', recordA->line, recordA->len);
+		fprintf(output, "---\n");
+		keydiff_print_line(output, '>', recordB.line, recordB.len);
+		differ = 1;
+	    }
+	}
+	free(recordB.line);
+    }
+
+    // records of A not found in B
+    for (r=0; r<count; r++) {
+	if (!records[r].matched) {
+	    fprintf(output, "%ldd\n", records[r].nr);
+	    keydiff_print_line(output, '<', records[r].line, records[r].len);
+	    differ = 1;
+	}
+	free(records[r].line);
+    }
+
+    free(table);
+    free(records);
+
+    return differ;
+}
+
+static void *keydiff_compare_thread(void *args) {
+    assert(args);
+
+    struct keydiff_s *keydiff = (struct keydiff_s *) args;
+
+    for (;;) {
+	pthread_mutex_lock(&keydiff->mutex);
+	const int bucket = keydiff->nextbucket++;
+	pthread_mutex_unlock(&keydiff->mutex);
+	if (bucket >= keydiff->buckets)
+	    break;
+
+	const int differ = keydiff_compare_bucket(keydiff, bucket, keydiff->resultfile[bucket]);
+
+	// bucket files are not needed any more
+	fclose(keydiff->bucketfile[KEYDIFF_A][bucket]);
+	fclose(keydiff->bucketfile[KEYDIFF_B][bucket]);
+	keydiff->bucketfile[KEYDIFF_A][bucket] = NULL;
+	keydiff->bucketfile[KEYDIFF_B][bucket] = NULL;
+
+	if (differ) {
+	    pthread_mutex_lock(&keydiff->mutex);
+	    keydiff->differ = 1;
+	    pthread_mutex_unlock(&keydiff->mutex);
+	}
+    }
+
+    return args;
+}
+
+static FILE *keydiff_tmpfile(void) {
+
+    FILE *file = tmpfile();
+    if (NULL == file) {
+	fprintf(stderr, "error: can not create temporary file: %s\n", strerror(errno));
+	abort();
+    }
+
+    return file;
+}
+
+int keydiff_compare(FILE *inputA, FILE *inputB, FILE *output, int column, char delim, int buckets, int threads) {
+    assert(inputA);
+    assert(inputB);
+    assert(output);
+    assert(column > 0);
+    assert(buckets > 0);
+    assert(threads > 0);
+
+    struct keydiff_s keydiff = {
+	.column = column,
+	.delim = delim,
+	.buckets = buckets,
+    };
+    FILE *input[KEYDIFF_MAX] = { inputA, inputB };
+    struct keydiff_partition_args_s partitionargs[KEYDIFF_MAX];
+    pthread_t partitionthread[KEYDIFF_MAX];
+    int retval;
+    int i, b;
+
+    pthread_mutex_init(&keydiff.mutex, NULL);
+    keydiff.resultfile = calloc(buckets, sizeof(*keydiff.resultfile));
+    assert(keydiff.resultfile);
+
+    // partition both inputs in parallel
+    for (i=0; i<KEYDIFF_MAX; i++) {
+	keydiff.bucketfile[i] = calloc(buckets, sizeof(*keydiff.bucketfile[i]));
+	assert(keydiff.bucketfile[i]);
+	for (b=0; b<buckets; b++)
+	    keydiff.bucketfile[i][b] = keydiff_tmpfile();
+
+	partitionargs[i].keydiff = &keydiff;
+	partitionargs[i].input = input[i];
+	partitionargs[i].i = i;
+	retval = pthread_create(&partitionthread[i], NULL, keydiff_partition_thread, &partitionargs[i]);
+	if (retval) {
+	    fprintf(stderr, "error: can not create thread: %s\n", strerror(retval));
+	    abort();
+	}
+    }
+    for (i=0; i<KEYDIFF_MAX; i++) {
+	retval = pthread_join(partitionthread[i], NULL);
+	if (retval) {
+	    fprintf(stderr, "error: can not join thread: %s\n", strerror(retval));
+	    abort();
+	}
+    }
+
+    // compare the buckets in parallel
+    for (b=0; b<buckets; b++)
+	keydiff.resultfile[b] = keydiff_tmpfile();
+
+    pthread_t *comparethread = calloc(threads, sizeof(*comparethread));
+    assert(comparethread);
+    for (i=0; i<threads; i++) {
+	retval = pthread_create(&comparethread[i], NULL, keydiff_compare_thread, &keydiff);
+	if (retval) {
+	    fprintf(stderr, "error: can not create thread: %s\n", strerror(retval));
+	    abort();
+	}
+    }
+    for (i=0; i<threads; i++) {
+	retval = pthread_join(comparethread[i], NULL);
+	if (retval) {
+	    fprintf(stderr, "error: can not join thread: %s\n", strerror(retval));
+	    abort();
+	}
+    }
+    free(comparethread);
+
+    // print the results in bucket order
+    char *buffer = malloc(BUFSIZ);
+    assert(buffer);
+    for (b=0; b<buckets; b++) {
+	size_t len;
+	rewind(keydiff.resultfile[b]);
+	while ((len = fread(buffer, 1, BUFSIZ, keydiff.resultfile[b])))
+	    fwrite(buffer, 1, len, output);
+	fclose(keydiff.resultfile[b]);
+    }
+    free(buffer);
+
+    free(keydiff.resultfile);
+    for (i=0; i<KEYDIFF_MAX; i++)
+	free(keydiff.bucketfile[i]);
+    pthread_mutex_destroy(&keydiff.mutex);
+
+    return keydiff.differ;
+}
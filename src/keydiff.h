@@ -0,0 +1,59 @@
+/*
+ * keydiff.h
+ *
+ *  Created on: 18.10.2026
+ *      Author: jh
+ */
+
+/*
+    Record comparison of delimited files by a key column
+
+    Copyright (C) 2017  Jörg Habenicht (jh@mwerk.net)
+
+    This file is part of lfdiff
+
+    lfdiff is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    lfdiff is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef SRC_ANSIC_KEYDIFF_H_
+#define SRC_ANSIC_KEYDIFF_H_
+
+#include <stdio.h>
+
+
+/** compare two delimited inputs record by record.
+ * Records are matched by the content of the key column, not by their
+ * position. In one pass both inputs are partitioned by the hash of the key
+ * into bucket files on disk. Then the buckets are compared in parallel, so
+ * only one bucket of input A per thread has to fit into memory.
+ *
+ * The output lists each differing record on its own:
+ * "NcM" record changed from line N of A to line M of B,
+ * "Nd" record of line N of A removed,
+ * "aM" record of line M of B added.
+ * The hunks are ordered by bucket, not by line number.
+ *
+ * @param inputA: input A
+ * @param inputB: input B
+ * @param output: stream to print the diff to
+ * @param column: key column, counting from 1
+ * @param delim: column delimiter
+ * @param buckets: number of buckets to partition the inputs into
+ * @param threads: number of threads comparing the buckets
+ * @return: 0 if the inputs are equal, 1 if they differ
+ */
+int keydiff_compare(FILE *inputA, FILE *inputB, FILE *output, int column, char delim, int buckets, int threads);
+
+#endif /* SRC_ANSIC_KEYDIFF_H_ */
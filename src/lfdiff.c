@@ -29,6 +29,21 @@
 
 #define _GNU_SOURCE
 #include "diffmanager.h"
+#include "difflist.h"
+#include "chunkreader.h"
+#include "mergediff.h"
+#include "keydiff.h"
+#include "hash.h"
+#include "intern.h"
+#include "mask.h"
+#include "context.h"
+#include "chunkindex.h"
+#include "longline.h"
+#include "checkpoint.h"
+#include "slicecache.h"
+#include "resources.h"
+#include "iolimit.h"
+#include "editcost.h"
 #include "config.h"
 
 #include <stdlib.h>
@@ -44,6 +59,8 @@
 #include <regex.h>
 #include <limits.h>
 #include <pthread.h>
+#include <getopt.h>
+#include <time.h>
 
 
 #define MIN(a,b)	((a)<(b)?(a):(b))
@@ -58,7 +75,15 @@
     } while (0)
 
 
-static const long long int default_splitsize = 2l*1024*1024*1024; // 2GB
+static const long long int default_splitsize = 2l*1024*1024*1024; // 2GB, if the memory is unknown
+static const size_t default_chunksize = 64*1024; // 64kB
+static const size_t diff_blocksize = 1024*1024;	// "diff" output is read in blocks of this size
+static const int default_keybuckets = 64;
+static const int max_keybuckets = 256;	// three temporary files per bucket
+static const long default_context = 3;	// context lines of unified output
+static const long default_checkpoint_interval = 60;	// seconds between checkpoints
+static const long long int default_cachesize = 256l*1024*1024;	// 256MB
+static const uint64_t slicecache_version = 1;	// changes with the "diff" output parsed
 
 enum {
     FILE_A = 0,
@@ -66,6 +91,30 @@ enum {
     MAX_FILE
 };
 
+/* options without short option character */
+enum {
+    OPT_SORTED = 256,
+    OPT_KEY,
+    OPT_DELIM,
+    OPT_MASK,
+    OPT_INTERN,
+    OPT_COMPRESS,
+    OPT_MOVES,
+    OPT_INDEX_DIR,
+    OPT_FINGERPRINT,
+    OPT_CHECKPOINT,
+    OPT_RESUME,
+    OPT_CHECKPOINT_INTERVAL,
+    OPT_INCREMENTAL,
+    OPT_CACHE_DIR,
+    OPT_CACHE_SIZE,
+    OPT_PREFETCH,
+    OPT_THREADS,
+    OPT_IO_LIMIT,
+    OPT_NICE_IO,
+    OPT_MAX_COST,
+};
+
 enum {
     PIPE_READ_CHANNEL = 0,
     PIPE_WRITE_CHANNEL = 1,
@@ -79,20 +128,67 @@ const char *mybasename(const char *path) {
 }
 
 struct config {
-    long long int splitsize;
+    long long int splitsize;	// 0: derived from the memory
+    int prefetch;	// chunks read ahead per input, 0: derived from the cores
+    long threads;	// threads comparing --key buckets, 0: one per core
     int be_verbose;
+    int sorted;		// inputs are sorted, compare with one merge pass
+    int keycolumn;	// compare records by key column, 0: compare lines
+    char delim;		// column delimiter of records
+    int compareflags;	// HASH_IGNORE_* flags, passed on to "diff"
+    int ignoreblank;	// leave out hunks of blank lines on output
+    struct mask_s *mask;	// regions of lines not compared, NULL for none
+    int intern;		// store equal differing lines once
+    int compress;	// zlib level to pack stored lines with, 0: no packing
+    long moves;		// report moved blocks of at least this many lines, 0: off
+    int unified;	// print unified output
+    long context;	// context lines of unified output
+    const char *indexdir;	// directory of the chunk index files, NULL for none
+    const char *fingerprint;	// chunk index of INPUT1, NULL for none
+    const char *checkpoint;	// checkpoint file, NULL for none
+    int resume;		// continue from the last checkpoint
+    long checkpointinterval;	// seconds between checkpoints, 0: every slice
+    const char *incremental;	// state file of appended inputs, NULL for none
+    const char *cachedir;	// directory of the slice cache, NULL for none
+    long long int cachesize;	// max size of the slice cache
+    double iolimit;	// MB per second read from all inputs, 0: no limit
+    int niceio;		// idle I/O priority, drop the pages read from the page cache
+    long maxcost;	// replace slices with more lines deleted and inserted as a whole, 0: off
     const char *outfilename;
     const char *filename[MAX_FILE];
 } config = {0};
 
 
 struct thread_copy_buffer_args {
-    FILE *infile;
+    struct chunk_list_s *chunks;
+    const struct mask_s *mask;	// mask to apply before writing
     FILE *outfile;
-    long long int max_copy_bytes;
     long long int lines_copied;
 };
 
+/* position of the last line looked up in the chunks fed to "diff" */
+struct span_cursor {
+    struct chunk_s *chunk;
+    size_t offset;	// offset of line in chunk
+    long line;		// line number in span, counting from 1
+};
+
+
+/* chunk in the hash table of a pending list */
+struct pending_entry_s {
+    struct chunk_s *chunk;
+    struct pending_entry_s *next;	// next entry of the same bucket
+};
+
+/* the pending chunks of one input by their hash, so the chunk matching a
+ * new chunk of the other input is found without walking the pending list
+ */
+struct pending_table_s {
+    struct pending_entry_s **bucket;
+    size_t size;	// number of buckets, a power of 2
+    size_t count;	// number of entries
+};
+
 
 struct runtime {
     FILE *infile[MAX_FILE];
@@ -103,22 +199,70 @@ struct runtime {
     pid_t pid;
     struct thread_copy_buffer_args threadbuffer[MAX_FILE];
     pthread_t threads[MAX_FILE];
+    struct chunkreader_s *reader[MAX_FILE];
+    struct chunk_list_s pending[MAX_FILE];	// chunks read, but not compared yet
+    struct pending_table_s pendingtable[MAX_FILE];	// pending chunks by hash
+    long long int pendingbytes[MAX_FILE];
+    int eof[MAX_FILE];
+    struct span_cursor cursor[MAX_FILE];	// original lines of masked input
+    unsigned long skippedlines;
+    struct context_s *context;	// context lines of A for unified output, NULL if not used
+    char *label[MAX_FILE];	// name and time of the inputs in unified output
+    long long int byteOffset[MAX_FILE];	// bytes compared
+    long long int openbytes[MAX_FILE];	// incomplete last line, not compared
+    struct checkpoint_s *checkpoint;	// NULL if not used
+    time_t checkpointtime;	// time of the last checkpoint
+    struct slicecache_s *cache;	// differences of slices compared before, NULL if not used
+    uint64_t cacheparams;	// hash of the options, seed of the slice hashes
+    long slices;	// slices compared
+    long trivialslices;	// slices compared without "diff"
+    long costlyslices;	// slices replaced as a whole, above --max-cost
+    struct slicecache_hunk_s *hunks;	// hunks of the slice being compared
+    size_t hunkcount;
+    size_t hunksize;
+    struct iolimit_s *iolimit;	// rate limit and byte count of the readers
 } runtime = {0};
 
 
 
 void usage(const char *argv0) {
 
-    fprintf(stderr, "usage: %s [-h] [-V] [-v] [-o OUTPUT] [-s SPLITSIZE] [--] INPUT1 INPUT2\n"
+    fprintf(stderr, "usage: %s [-h] [-V] [-v] [-i] [-b] [-w] [-B] [-o OUTPUT] [-s SPLITSIZE] [-u | -U NUM] [--sorted] [--key COL [--delim C]] [--mask REGEX]... [--intern] [--compress LEVEL] [--moves N] [--index-dir DIR] [--fingerprint FILE] [--checkpoint FILE [--resume] [--checkpoint-interval SEC]] [--incremental STATE] [--cache-dir DIR [--cache-size SIZE]] [--prefetch N] [--threads N] [--io-limit MBPS] [--nice-io] [--max-cost N] [--] INPUT1 [INPUT2]\n"
 	    "\t-h: print this help\n"
 	    "\t-V: print version\n"
+	    "\t-i: ignore case differences\n"
+	    "\t-b: ignore changes in the amount of white space\n"
+	    "\t-w: ignore all white space\n"
+	    "\t    -i, -b and -w do not apply to lines longer than 1MB and 4 chunks\n"
+	    "\t-B: ignore changes whose lines are all blank\n"
 	    "\t-o: write output to OUTFILE instead of stdout\n"
-	    "\t-s: split INPUT* into SPLITSIZE chunks. SPLITSIZE can be appended k,kB,M,MB,G,GB to multiply 1024, 1024², 1024³. (default: %lld byte)\n"
+	    "\t-s: split INPUT* into SPLITSIZE chunks. SPLITSIZE can be appended k,kB,M,MB,G,GB to multiply 1024, 1024², 1024³. (default: 1/8 of the memory, 16MB to 16GB)\n"
+	    "\t-u: print unified output with %ld lines of context\n"
+	    "\t-U: print unified output with NUM lines of context\n"
 	    "\t-v: be verbose\n"
+	    "\t--sorted: INPUT1 and INPUT2 are sorted in byte order (i.e. LC_ALL=C sort). Compare them in one pass with constant memory.\n"
+	    "\t--key: compare records of INPUT* matched by the key in column COL (counting from 1) instead of lines by position.\n"
+	    "\t--delim: column delimiter for --key, '\\t' for tab. (default: ',')\n"
+	    "\t--mask: ignore the parts of lines matching the extended regular expression REGEX, e.g. time stamps. Can be given more than once. Lines longer than 1MB and 4 chunks are not masked.\n"
+	    "\t--intern: store equal differing lines only once. Saves memory if few distinct lines make up most of the differences, see -v.\n"
+	    "\t--compress: pack stored differing lines with zlib compression LEVEL 1 (fast) to 9 (small). Saves memory on large differences.\n"
+	    "\t--moves: print blocks of at least N lines deleted and inserted unchanged at another place as moved, \"NmM\".\n"
+	    "\t--index-dir: keep an index of the chunks of INPUT* in DIR. Unchanged files are not read again up to the differing chunks.\n"
+	    "\t--fingerprint: write the chunk index of INPUT1 to FILE if INPUT2 is missing. Else compare INPUT2 to the chunks in FILE, INPUT1 is read only where it differs.\n"
+	    "\t--checkpoint: save the state of the comparison to FILE every --checkpoint-interval seconds. (default: %ld)\n"
+	    "\t--resume: continue from the last checkpoint in FILE after an interruption.\n"
+	    "\t--incremental: INPUT* are only appended to. Compare from the position saved in STATE on and save the new one.\n"
+	    "\t--cache-dir: keep the differences of each pair of slices in DIR. Slices compared before are not fed to \"diff\" again.\n"
+	    "\t--cache-size: remove the least recently used entries of the cache above SIZE, appended k,kB,M,MB,G,GB like -s. (default: %lld byte)\n"
+	    "\t--prefetch: read N chunks ahead per INPUT. (default: 4 per core, 4 to 64)\n"
+	    "\t--threads: compare the buckets of --key with N threads. (default: one per core)\n"
+	    "\t--io-limit: read at most MBPS MB per second from both INPUT together.\n"
+	    "\t--nice-io: read with idle I/O priority and drop the INPUT read from the page cache.\n"
+	    "\t--max-cost: print slices differing in more than N lines as one change, without \"diff\".\n"
 	    "\t--: end option parsing. Next argument is expected to describe INPUT1\n"
 	    "INPUT1 and INPUT2 can be any file, socket or pipe which one can read from.\n"
 	    "Use '-' to read from standard input.\n"
-	    , mybasename(argv0), default_splitsize
+	    , mybasename(argv0), default_context, default_checkpoint_interval, default_cachesize
     );
 
 }
@@ -151,47 +295,36 @@ void myregexbuffercpy(char *dest, const char *src, int start, int end, int buffe
 }
 
 
-void *thread_copy_infile_to_outpipe(void *args) {
+void *thread_copy_chunks_to_outpipe(void *args) {
     assert(args);
 
     struct thread_copy_buffer_args *myargs = (struct thread_copy_buffer_args *) args;
-    assert(myargs->infile);
+    assert(myargs->chunks);
     assert(myargs->outfile);
-    assert(myargs->max_copy_bytes >= 0);
-
-    long long int copy_bytes = 0;
-    char *line = NULL;
-    size_t n;
-
-    while (!feof(myargs->infile) && copy_bytes < myargs->max_copy_bytes) {
 
-	int retval = getline(&line, &n, myargs->infile);
-	if (1 > retval) {
-	    if (errno) {
-		fprintf(stderr, "error: reading from input file: %s\n", strerror(errno));
-	    }
-	    else if (feof(myargs->infile)) {
-		// we have reached the end of input.
-		// why didn't we notice earlier at the top of the loop?
-		break;
-	    }
-	    else {
-		fprintf(stderr, "error: no valid input from input file\n");
+    char *buffer = NULL;	// masked chunk
+    size_t bufferlen = 0;
+    struct chunk_s *chunk;
+    STAILQ_FOREACH(chunk, myargs->chunks, entries) {
+	const char *data = chunk->data;
+	size_t len = chunk->len;
+	if (myargs->mask) {
+	    if (len > bufferlen) {
+		bufferlen = len;
+		buffer = realloc(buffer, bufferlen);
+		assert(buffer);
 	    }
-	    abort();
+	    len = mask_apply(myargs->mask, data, len, buffer);
+	    data = buffer;
 	}
-
-	retval = fputs(line, myargs->outfile);
-	if (EOF==retval) {
-	    fprintf(stderr, "error: writing to output buffer: %s\n", strerror(ferror(myargs->outfile)));
+	size_t retval = fwrite(data, 1, len, myargs->outfile);
+	if (retval != len) {
+	    fprintf(stderr, "error: writing to output buffer: %s\n", strerror(errno));
 	    abort();
 	}
-	copy_bytes += strlen(line);
-	myargs->lines_copied++;
-
+	myargs->lines_copied += chunk->lines;
     }
-
-    free(line);
+    free(buffer);
 
     // close this over here, so the external program gets EOF and is able to
     // close its output stream itself. Which is recognized by this program in
@@ -262,7 +395,19 @@ FILE *diff_open() {
 	}
 
 	// call "diff" program with file descriptors in /dev/fd/
-	execlp("diff", "diff", fdbuff[FILE_A], fdbuff[FILE_B], (char *) NULL);
+	const char *args[8];
+	int argn = 0;
+	args[argn++] = "diff";
+	if (config.compareflags & HASH_IGNORE_CASE)
+	    args[argn++] = "-i";
+	if (config.compareflags & HASH_IGNORE_SPACE_CHANGE)
+	    args[argn++] = "-b";
+	if (config.compareflags & HASH_IGNORE_ALL_SPACE)
+	    args[argn++] = "-w";
+	args[argn++] = fdbuff[FILE_A];
+	args[argn++] = fdbuff[FILE_B];
+	args[argn] = NULL;
+	execvp("diff", (char * const *) args);
 	fprintf(stderr, "error: can not exec: %s\n", strerror(errno));
 	abort();
     }
@@ -284,7 +429,7 @@ FILE *diff_open() {
 	}
 
 	// start the feeding thread
-	retval = pthread_create(&runtime.threads[i], NULL, thread_copy_infile_to_outpipe, &runtime.threadbuffer[i]);
+	retval = pthread_create(&runtime.threads[i], NULL, thread_copy_chunks_to_outpipe, &runtime.threadbuffer[i]);
 	if (retval)
 	{
 	    fprintf(stderr, "error: can not create thread: %s\n", strerror(errno));
@@ -318,7 +463,7 @@ int diff_close(FILE *file) {
 	}
 	runtime.threads[i] = 0;
 
-	// stream is already closed in thread thread_copy_infile_to_outpipe()
+	// stream is already closed in thread thread_copy_chunks_to_outpipe()
     }
 
     retval = fclose(file);
@@ -361,156 +506,262 @@ int diff_close(FILE *file) {
 
 
 
-int main(int argc, char **argv) {
-    int retval;
-    regex_t regex;
-
-    runtime.argv0 = argv[0];
-    config.splitsize = default_splitsize;
+/* look up line nr of the chunks fed to "diff" for input i.
+ * The line numbers must not decrease between calls.
+ * @param len: returns the length of the line including the newline character
+ * @return: pointer to the line in the chunk
+ */
+const char *span_get_line(int i, long nr, size_t *len) {
 
-    int opt;
+    struct span_cursor *cursor = &runtime.cursor[i];
+    assert(cursor->chunk);
+    assert(nr >= cursor->line);
 
-    while ((opt = getopt(argc, argv, "hVvo:s:")) != -1)
-    {
-	if ('-' == opt)
-	    /* '--' option, end processing */
-	    break;
+    for (;;) {
+	const char *line = cursor->chunk->data + cursor->offset;
+	const char *end = cursor->chunk->data + cursor->chunk->len;
+	const char *newline = memchr(line, '\n', end - line);
+	const char *next = newline? newline + 1: end;
 
-	switch (opt)
-	{
-	case 'h':
-	    usage(argv[0]);
-	    exit(EXIT_SUCCESS);
-	case 'v':
-	    config.be_verbose = 1;
-	    break;
-	case 'V':
-	    print_version();
-	    exit(EXIT_SUCCESS);
-	case 'o':
-	    config.outfilename = optarg;
-	    break;
-	case 's':
-	{
-	    retval = regcomp(&regex, "^([0-9]+)([kMG]?)B?$",  REG_EXTENDED/*|REG_NEWLINE*/);
-	    if( retval ) {
-		size_t len = regerror(retval, &regex, NULL, 0);
-		char *buffer = malloc(len);
-		assert(buffer);
-		(void) regerror (retval, &regex, buffer, len);
-		fprintf(stderr, "Could not compile regular expression: %s", buffer);
-		abort();
-	    }
+	if (cursor->line == nr) {
+	    *len = next - line;
+	    return line;
+	}
 
-	    regmatch_t matchptr[3];
-	    retval = regexec(&regex, optarg, 3, matchptr, 0);
-	    if( !retval )
-	    {
-		// Match
-		static const int bufferlen = 32;
-		char buffer[bufferlen];
-
-		// extract data
-		myregexbuffercpy(buffer, optarg, matchptr[1].rm_so, matchptr[1].rm_eo, bufferlen);
-		config.splitsize = atoll(buffer);
-		if (matchptr[2].rm_so != matchptr[2].rm_eo) {
-		    myregexbuffercpy(buffer, optarg, matchptr[2].rm_so, matchptr[2].rm_eo, bufferlen);
-		    switch (*buffer) {
-		    case 'G':
-			if (config.splitsize >= LLONG_MAX/1024) {
-			    fprintf(stderr, "Integer overflow error parsing option -s '%s'\n", optarg);
-			    exit(EXIT_FAILURE);
-			}
-			config.splitsize *= 1024;
-			// no break, fall through
-		    case 'M':
-			if (config.splitsize >= LLONG_MAX/1024) {
-			    fprintf(stderr, "Integer overflow error parsing option -s '%s'\n", optarg);
-			    exit(EXIT_FAILURE);
-			}
-			config.splitsize *= 1024;
-			// no break, fall through
-		    case 'k':
-			if (config.splitsize >= LLONG_MAX/1024) {
-			    fprintf(stderr, "Integer overflow error parsing option -s '%s'\n", optarg);
-			    exit(EXIT_FAILURE);
-			}
-			config.splitsize *= 1024;
-			break;
-
-		    default:
-			fprintf(stderr, "Program error parsing '%s'", optarg);
-			exit(EXIT_FAILURE);
-		    }
-		}
-	    }
-	    else if( retval == REG_NOMATCH )
-	    {
-		// No match on diff header
-		fprintf(stderr, "Invalid argument to option '-s': %s\n", optarg);
-		usage(argv[0]);
-		exit(EXIT_FAILURE);
-	    }
-	    else
-	    {
-		size_t len = regerror(retval, &regex, NULL, 0);
-		char *buffer = malloc(len);
-		assert(buffer);
-		(void) regerror (retval, &regex, buffer, len);
-		fprintf(stderr, "Could not compile regular expression: %s", buffer);
+	cursor->line++;
+	cursor->offset = next - cursor->chunk->data;
+	if (cursor->offset >= cursor->chunk->len) {
+	    cursor->chunk = STAILQ_NEXT(cursor->chunk, entries);
+	    cursor->offset = 0;
+	    if (!cursor->chunk) {
+		fprintf(stderr, "error: line %ld of \"diff\" output not in input\n", nr);
 		abort();
 	    }
-	    regfree(&regex);
-	}
-	    break;
-	default: /* '?' */
-	    usage(argv[0]);
-	    exit(EXIT_FAILURE);
 	}
     }
+}
+
+/* put the original line into the diffmanager instead of the masked line
+ * printed by "diff".
+ */
+void diff_input_original_line(const char *line, int i) {
+
+    const long nr = runtime.currentline[i] - runtime.lineOffset[i];
+    size_t len;
+    const char *original = span_get_line(i, nr, &len);
+
+    // a last line without newline is printed with the marker
+    diffmanager_input_line(runtime.diffmanager, line[0], original, len, runtime.currentline[i]++);
+}
+
+/* note a hunk of the slice being compared for the slice cache */
+void slice_add_hunk(const struct slicecache_hunk_s *hunk) {
+
+    if (runtime.hunkcount == runtime.hunksize) {
+	runtime.hunksize = runtime.hunksize? 2 * runtime.hunksize: 256;
+	runtime.hunks = realloc(runtime.hunks, runtime.hunksize * sizeof(*runtime.hunks));
+	assert(runtime.hunks);
+    }
+    runtime.hunks[runtime.hunkcount++] = *hunk;
+}
+
+/* put the hunks of a slice found in the slice cache into the diffmanager
+ * the way diff_parse_line() does, the lines are taken from the chunks.
+ */
+void slice_replay(const struct slicecache_hunk_s *hunks, size_t count) {
+
+    size_t i;
+    for (i=0; i<count; i++) {
+	const struct slicecache_hunk_s *hunk = &hunks[i];
+	if (runtime.context)
+	    context_add_hunk(runtime.context, hunk->firstA + runtime.lineOffset[FILE_A], hunk->lastA + runtime.lineOffset[FILE_A]);
+	long n;
+	runtime.currentline[FILE_A] = hunk->firstA + runtime.lineOffset[FILE_A];
+	for (n=hunk->firstA; n<=hunk->lastA; n++)
+	    diff_input_original_line("<", FILE_A);
+	runtime.currentline[FILE_B] = hunk->firstB + runtime.lineOffset[FILE_B];
+	for (n=hunk->firstB; n<=hunk->lastB; n++)
+	    diff_input_original_line(">", FILE_B);
+    }
+}
 
+/* evaluate one line of the "diff" output.
+ * @param block: block holding the line
+ * @param line: line including the newline character, not NUL terminated
+ */
+void diff_parse_line(struct diff_block_s *block, const char *line, size_t len, regex_t *regex) {
 
+    int retval;
     int i;
-    for (i=0; i<MAX_FILE; i++) {
-	if (optind >= argc) {
-	    fprintf(stderr, "INPUT%d missing\n", i);
-	    usage(argv[0]);
-	    exit(EXIT_FAILURE);
-	}
-	config.filename[i] = argv[optind++];
+
+    // string at least needs to have '<' or '>' and space character
+    if (2 <= len && ('<' == *line || '>' == *line)) {
+	i = '<' == *line? FILE_A: FILE_B;
+	if (config.mask)
+	    diff_input_original_line(line, i);
+	else
+	    diffmanager_input_diff_block(runtime.diffmanager, block, line, len, runtime.currentline[i]++);
+	return;
+    }
+    if (4 == len && !memcmp(line, "---\n", 4))
+	return;	// regular split between '<' and '>', do nothing
+
+    // the header line is short, make it a string for regexec()
+    static const int headerlen = 64;
+    char header[headerlen];
+    if (len >= headerlen) {
+	fprintf(stderr, "%s error: can not recognise diff line \"%.*s\"\n", mybasename(runtime.argv0), (int) len, line);
+	abort();
     }
+    memcpy(header, line, len);
+    header[len] = '\0';
 
+    regmatch_t matchptr[REGEX_MATCHBUFFER_LEN];
+    retval = regexec(regex, header, REGEX_MATCHBUFFER_LEN, matchptr, 0);
+    if( !retval )
+    {
+	// Match
 
-    if (!strcmp(config.filename[FILE_A], config.filename[FILE_B])) {
-	// input is twice the same file name or twice stdin
-	fprintf(stderr, "no need to compare same files\n");
-	exit(EXIT_FAILURE);
+	static const int bufferlen = 32;
+	static const int actionlen = 2;
+	long lines[MAX_FILE];
+	char buffer[bufferlen];
+	char action[actionlen];
+
+	// extract data
+	myregexbuffercpy(buffer, header, matchptr[1].rm_so, matchptr[1].rm_eo, bufferlen);
+	lines[FILE_A] = atol(buffer);
+	myregexbuffercpy(buffer, header, matchptr[4].rm_so, matchptr[4].rm_eo, bufferlen);
+	lines[FILE_B] = atol(buffer);
+	myregexbuffercpy(action, header, matchptr[3].rm_so, matchptr[3].rm_eo, actionlen);
+
+	for (i=0; i<MAX_FILE; i++)
+	    runtime.currentline[i] = lines[i] + runtime.lineOffset[i];
+
+	if (runtime.context || runtime.cache) {
+	    // lines of the hunk in the slice, empty ranges name no line
+	    long last[MAX_FILE] = { lines[FILE_A], lines[FILE_B] };
+	    for (i=0; i<MAX_FILE; i++) {
+		if (matchptr[2 + 3*i].rm_so != matchptr[2 + 3*i].rm_eo) {
+		    myregexbuffercpy(buffer, header, matchptr[2 + 3*i].rm_so, matchptr[2 + 3*i].rm_eo, bufferlen);
+		    last[i] = atol(buffer);
+		}
+	    }
+	    struct slicecache_hunk_s hunk;
+	    hunk.firstA = 'a' == *action? lines[FILE_A] + 1: lines[FILE_A];
+	    hunk.lastA = 'a' == *action? lines[FILE_A]: last[FILE_A];
+	    hunk.firstB = 'd' == *action? lines[FILE_B] + 1: lines[FILE_B];
+	    hunk.lastB = 'd' == *action? lines[FILE_B]: last[FILE_B];
+
+	    // the lines of A around the hunk are kept as context
+	    if (runtime.context)
+		context_add_hunk(runtime.context, hunk.firstA + runtime.lineOffset[FILE_A], hunk.lastA + runtime.lineOffset[FILE_A]);
+	    if (runtime.cache)
+		slice_add_hunk(&hunk);
+	}
+
+	// write out and free() decoded and optimized differentials to
+	// "outfile" to reduce the amount of memory used
+	// NOTE: currently disabled due to a bug in the diff stream generation
+    //		const long diffAB = diffmanager_get_linediff_A_B(runtime.diffmanager);
+    //		long min_common_lines = (
+    //			diffAB>0?
+    //			MIN(runtime.currentline[FILE_A],runtime.currentline[FILE_B]-diffAB):
+    //			MIN(runtime.currentline[FILE_A]+diffAB,runtime.currentline[FILE_B])
+    //			)-1;
+    //		PRINT_VERBOSE(stderr, "diff output <= line %ld\n", min_common_lines);
+    //		diffmanager_output_diff(runtime.diffmanager, outfile, min_common_lines);
+    }
+    else if( retval == REG_NOMATCH )
+    {
+	fprintf(stderr, "%s error: can not recognise diff line \"%s\"\n", mybasename(runtime.argv0), header);
+	abort();
+    }
+    else
+    {
+	size_t len = regerror(retval, regex, NULL, 0);
+	char *buffer = malloc(len);
+	assert(buffer);
+	(void) regerror (retval, regex, buffer, len);
+	fprintf(stderr, "Could not compile regular expression: %s", buffer);
+	abort();
     }
+}
 
+/* read the output of the "diff" program and put the differing lines
+ * into the diffmanager.
+ * The output is read in large blocks. The stored lines point into the
+ * blocks, a block is freed when all its lines are printed or removed.
+ */
+void diff_read_output(FILE *splitinput, regex_t *regex) {
+    assert(splitinput);
+    assert(regex);
+
+    struct diff_block_s *block = diff_block_new(diff_blocksize);
+    size_t pos = 0;	// start of next line in block
+    int eof = 0;
+
+    for (;;) {
+	const char *line = block->data + pos;
+	const char *newline = memchr(line, '\n', block->len - pos);
+	if (newline) {
+	    const size_t len = newline + 1 - line;
+	    diff_parse_line(block, line, len, regex);
+	    pos += len;
+	    continue;
+	}
 
-    for (i=0; i<MAX_FILE; i++) {
-	if (strcmp(config.filename[i], "-")) {
-	    // file is regular
-	    runtime.infile[i] = fopen(config.filename[i], "r");
-	    if (NULL == runtime.infile[i]) {
-		fprintf(stderr, "error: could not open input file '%s': %s\n", config.filename[i], strerror(errno));
-		exit(EXIT_FAILURE);
+	if (eof) {
+	    if (pos < block->len) {
+		fprintf(stderr, "error: no valid input from \"diff\" program\n");
+		abort();
+	    }
+	    break;
+	}
+
+	// keep the incomplete line at the start of a block
+	const size_t rest = block->len - pos;
+	if (1 == block->refcount) {
+	    // no line points into the block, reuse it
+	    memmove(block->data, block->data + pos, rest);
+	    if (rest == block->capacity) {
+		block->capacity *= 2;
+		block->data = realloc(block->data, block->capacity);
+		assert(block->data);
 	    }
 	}
 	else {
-	    // file is stdin
-	    runtime.infile[i] = stdin;
+	    struct diff_block_s *next = diff_block_new(MAX(diff_blocksize, 2 * rest));
+	    memcpy(next->data, block->data + pos, rest);
+	    diff_block_unref(block);
+	    block = next;
 	}
-    }
+	block->len = rest;
+	pos = 0;
 
+	const size_t got = fread(block->data + block->len, 1, block->capacity - block->len, splitinput);
+	if (!got) {
+	    if (ferror(splitinput)) {
+		fprintf(stderr, "error: reading from \"diff\" programm: %s\n", strerror(errno));
+		abort();
+	    }
+	    eof = 1;
+	}
+	block->len += got;
+    }
+    diff_block_unref(block);
+}
 
-    runtime.diffmanager = diffmanager_new();
 
-    char *line = NULL;	// buffer holding one line of diff
-    size_t n = 0;	// size of the buffer
+/* parse a size like SPLITSIZE, exit on error.
+ * @param option: name of the option in the error message
+ * @return: size in bytes
+ */
+long long int parse_size(const char *argv0, const char *option, const char *arg) {
 
-    // prepare regular expression
-    retval = regcomp(&regex, "^([0-9]+),?([0-9]*)([acd])([0-9]+),?([0-9]*)\n$",  REG_EXTENDED/*|REG_NEWLINE*/);
+    regex_t regex;
+    long long int size = 0;
+    int retval = regcomp(&regex, "^([0-9]+)([kMG]?)B?$",  REG_EXTENDED/*|REG_NEWLINE*/);
     if( retval ) {
 	size_t len = regerror(retval, &regex, NULL, 0);
 	char *buffer = malloc(len);
@@ -520,138 +771,1323 @@ int main(int argc, char **argv) {
 	abort();
     }
 
-    FILE *outfile = config.outfilename?fopen(config.outfilename, "w"):stdout;
-    if (NULL == outfile) {
-	fprintf(stderr, "error: could not open output file '%s': %s\n", config.outfilename, strerror(errno));
+    regmatch_t matchptr[3];
+    retval = regexec(&regex, arg, 3, matchptr, 0);
+    if( !retval )
+    {
+	// Match
+	static const int bufferlen = 32;
+	char buffer[bufferlen];
+
+	// extract data
+	myregexbuffercpy(buffer, arg, matchptr[1].rm_so, matchptr[1].rm_eo, bufferlen);
+	size = atoll(buffer);
+	if (matchptr[2].rm_so != matchptr[2].rm_eo) {
+	    myregexbuffercpy(buffer, arg, matchptr[2].rm_so, matchptr[2].rm_eo, bufferlen);
+	    switch (*buffer) {
+	    case 'G':
+		if (size >= LLONG_MAX/1024) {
+		    fprintf(stderr, "Integer overflow error parsing option %s '%s'\n", option, arg);
+		    exit(EXIT_FAILURE);
+		}
+		size *= 1024;
+		// no break, fall through
+	    case 'M':
+		if (size >= LLONG_MAX/1024) {
+		    fprintf(stderr, "Integer overflow error parsing option %s '%s'\n", option, arg);
+		    exit(EXIT_FAILURE);
+		}
+		size *= 1024;
+		// no break, fall through
+	    case 'k':
+		if (size >= LLONG_MAX/1024) {
+		    fprintf(stderr, "Integer overflow error parsing option %s '%s'\n", option, arg);
+		    exit(EXIT_FAILURE);
+		}
+		size *= 1024;
+		break;
+
+	    default:
+		fprintf(stderr, "Program error parsing '%s'", arg);
+		exit(EXIT_FAILURE);
+	    }
+	}
+    }
+    else if( retval == REG_NOMATCH )
+    {
+	// No match on diff header
+	fprintf(stderr, "Invalid argument to option '%s': %s\n", option, arg);
+	usage(argv0);
 	exit(EXIT_FAILURE);
     }
+    else
+    {
+	size_t len = regerror(retval, &regex, NULL, 0);
+	char *buffer = malloc(len);
+	assert(buffer);
+	(void) regerror (retval, &regex, buffer, len);
+	fprintf(stderr, "Could not compile regular expression: %s", buffer);
+	abort();
+    }
+    regfree(&regex);
 
+    return size;
+}
 
-    int iteration;
-    for (iteration=1; iteration; iteration++) { // exit loop if both split files return 0 bytes
-	FILE *splitinput;
+/* name and time of input i in the header of the unified output, the way
+ * diff(1) prints them. Pipes get the current time.
+ * @return: allocated string
+ */
+char *unified_label(int i) {
+
+    struct stat st;
+    struct timespec ts;
+    if (!fstat(fileno(runtime.infile[i]), &st) && S_ISREG(st.st_mode))
+	ts = st.st_mtim;
+    else
+	clock_gettime(CLOCK_REALTIME, &ts);
+
+    struct tm tm;
+    char date[32], zone[8];
+    localtime_r(&ts.tv_sec, &tm);
+    strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", &tm);
+    strftime(zone, sizeof(zone), "%z", &tm);
+
+    char *label;
+    if (-1 == asprintf(&label, "%s\t%s.%09ld %s", config.filename[i], date, ts.tv_nsec, zone)) {
+	fprintf(stderr, "error: can not print to string: %s\n", strerror(errno));
+	abort();
+    }
 
-	if (feof(runtime.infile[FILE_A]) && feof(runtime.infile[FILE_B]))
-	    break;
+    return label;
+}
 
-	memset(&runtime.threadbuffer, 0, sizeof(runtime.threadbuffer));
-	for (i=0; i<MAX_FILE; i++) {
-	    runtime.threadbuffer[i].infile = runtime.infile[i];
-	    runtime.threadbuffer[i].max_copy_bytes = config.splitsize;
+/* open the chunk index of input i, either the fingerprint of INPUT1 or the
+ * index in the index directory.
+ * @return: index, NULL if none is used
+ */
+struct chunkindex_s *index_open(int i, size_t chunksize) {
+
+    const uint64_t params = chunkreader_index_params(chunksize, config.compareflags, config.mask);
+    const int fd = fileno(runtime.infile[i]);
+    // the index covers files read from the start only
+    const int fromstart = !ftello(runtime.infile[i]);
+
+    if (FILE_A == i && config.fingerprint) {
+	struct chunkindex_s *index = fromstart? chunkindex_open_file(config.fingerprint, fd, params, CHUNKINDEX_READ): NULL;
+	if (!index) {
+	    fprintf(stderr, "fingerprint '%s' does not match '%s' or the options -s, -i, -b, -w and --mask\n", config.fingerprint, config.filename[i]);
+	    exit(EXIT_FAILURE);
 	}
+	return index;
+    }
+    if (config.indexdir && fromstart)
+	return chunkindex_open(config.indexdir, fd, params);
 
-	PRINT_VERBOSE(stderr, "diff input %d\n", iteration);
-	splitinput = diff_open();
-	while (!feof(splitinput)) {
-	    retval = getline(&line, &n, splitinput);
-	    if (1 > retval) {
-		if (errno) {
-		    fprintf(stderr, "error: reading from \"diff\" programm: %s\n", strerror(errno));
-		}
-		else if (feof(splitinput)) {
-		    // we have reached the end of input.
-		    // why didn't we notice earlier at the top of the loop?
-		    break;
-		}
-		else {
-		    fprintf(stderr, "error: no valid input from \"diff\" program\n");
-		}
-		abort();
-	    }
-	    // note: line includes a newline character at the end
-
-	    regmatch_t matchptr[REGEX_MATCHBUFFER_LEN];
-	    retval = regexec(&regex, line, REGEX_MATCHBUFFER_LEN, matchptr, 0);
-	    if( !retval )
-	    {
-		// Match
-
-		static const int bufferlen = 32;
-		static const int actionlen = 2;
-		long lines[MAX_FILE];
-		char buffer[bufferlen];
-		char action[actionlen];
-
-		// extract data
-		myregexbuffercpy(buffer, line, matchptr[1].rm_so, matchptr[1].rm_eo, bufferlen);
-		lines[FILE_A] = atol(buffer);
-		myregexbuffercpy(buffer, line, matchptr[4].rm_so, matchptr[4].rm_eo, bufferlen);
-		lines[FILE_B] = atol(buffer);
-		myregexbuffercpy(action, line, matchptr[3].rm_so, matchptr[3].rm_eo, actionlen);
-
-		for (i=0; i<MAX_FILE; i++)
-		    runtime.currentline[i] = lines[i] + runtime.lineOffset[i];
-
-		// write out and free() decoded and optimized differentials to
-		// "outfile" to reduce the amount of memory used
-		// NOTE: currently disabled due to a bug in the diff stream generation
-//		const long diffAB = diffmanager_get_linediff_A_B(runtime.diffmanager);
-//		long min_common_lines = (
-//			diffAB>0?
-//			MIN(runtime.currentline[FILE_A],runtime.currentline[FILE_B]-diffAB):
-//			MIN(runtime.currentline[FILE_A]+diffAB,runtime.currentline[FILE_B])
-//			)-1;
-//		PRINT_VERBOSE(stderr, "diff output <= line %ld\n", min_common_lines);
-//		diffmanager_output_diff(runtime.diffmanager, outfile, min_common_lines);
-	    }
-	    else if( retval == REG_NOMATCH )
-	    {
-		// No match on diff header
-
-		// string at least needs to have '<' or '>' and space character
-		if (2 <= strlen(line)) {
-		    switch (*line) {
-		    case '<':
-			diffmanager_input_diff(runtime.diffmanager, line, runtime.currentline[FILE_A]++);
-			break;
-
-		    case '>':
-			diffmanager_input_diff(runtime.diffmanager, line, runtime.currentline[FILE_B]++);
-			break;
-
-		    case '-':
-			// we can test on line[2] without pointer failure
-			if ('-'==line[1] && '-'==line[2])
-			    break;	// regular split between '<' and '>', do nothing
-			// else
-			//   error out in default case
-
-			// no break, fall through
-		    default:
-			fprintf(stderr, "%s error: can not recognise diff line \"%s\"\n", mybasename(argv[0]), line);
-			abort();
-		    }
-		}
-		else {
-		    fprintf(stderr, "%s error: can not recognise diff line \"%s\"\n", mybasename(argv[0]), line);
-		    abort();
-		}
-	    }
-	    else
-	    {
-		size_t len = regerror(retval, &regex, NULL, 0);
-		char *buffer = malloc(len);
-		assert(buffer);
-		(void) regerror (retval, &regex, buffer, len);
-		fprintf(stderr, "Could not compile regular expression: %s", buffer);
-		abort();
-	    }
+    return NULL;
+}
+
+/* write the chunk index of INPUT1 to the fingerprint file */
+void fingerprint_write(size_t chunksize) {
+
+    const uint64_t params = chunkreader_index_params(chunksize, config.compareflags, config.mask);
+    struct chunkindex_s *index = NULL;
+    if (!ftello(runtime.infile[FILE_A]))
+	index = chunkindex_open_file(config.fingerprint, fileno(runtime.infile[FILE_A]), params, CHUNKINDEX_WRITE);
+    if (!index) {
+	fprintf(stderr, "can not write fingerprint of '%s', it is no regular file\n", config.filename[FILE_A]);
+	exit(EXIT_FAILURE);
+    }
 
+    struct chunkreader_s *reader = chunkreader_new(runtime.infile[FILE_A], chunksize, config.prefetch, config.compareflags, config.mask, index, runtime.iolimit);
+    struct chunk_s *chunk;
+    long chunks = 0;
+    unsigned long lines = 0;
+    while ((chunk = chunkreader_get(reader))) {
+	chunks++;
+	lines += chunk->lines;
+	chunk_free(chunk);
+    }
+    // the reader has finished the index
+    if (reader->longlines->count) {
+	fprintf(stderr, "can not write fingerprint of '%s', it has lines longer than 1MB\n", config.filename[FILE_A]);
+	exit(EXIT_FAILURE);
+    }
+    chunkreader_delete(reader);
+
+    PRINT_VERBOSE(stderr, "fingerprint of %s: %ld chunks, %lu lines\n", config.filename[FILE_A], chunks, lines);
+}
+
+/* hash of the options and inputs a checkpoint is valid for.
+ * @param appending: the inputs may grow, only their inode counts
+ */
+uint64_t checkpoint_params(size_t chunksize, int appending) {
+
+    const int64_t options[] = { config.splitsize, config.unified, config.context, config.maxcost };
+    uint64_t hash = chunkreader_index_params(chunksize, config.compareflags, config.mask);
+    hash = hash_bytes(options, sizeof(options), hash);
+
+    int i;
+    for (i=0; i<MAX_FILE; i++) {
+	struct stat st;
+	if (fstat(fileno(runtime.infile[i]), &st) || !S_ISREG(st.st_mode)) {
+	    fprintf(stderr, "can not checkpoint '%s', it is no regular file\n", config.filename[i]);
+	    exit(EXIT_FAILURE);
 	}
-	diff_close(splitinput);
+	const int64_t file[] = { st.st_ino, st.st_dev, st.st_size, st.st_mtim.tv_sec, st.st_mtim.tv_nsec };
+	hash = hash_bytes(file, appending? 2*sizeof(*file): sizeof(file), hash);
+    }
 
-	for (i=0; i<MAX_FILE; i++)
-	    runtime.lineOffset[i] += runtime.threadbuffer[i].lines_copied;
+    return hash;
+}
+
+/* open the checkpoint file. On resume the stored lines are put into the
+ * diffmanager and the inputs are set to the position of the checkpoint.
+ */
+void checkpoint_start(size_t chunksize) {
+
+    runtime.checkpoint = checkpoint_open(config.checkpoint, checkpoint_params(chunksize, 0), config.resume);
+    runtime.checkpointtime = time(NULL);
+    if (!config.resume)
+	return;
+
+    struct checkpoint_state_s state;
+    if (!runtime.checkpoint) {
+	fprintf(stderr, "checkpoint '%s' does not match '%s', '%s' or the options\n", config.checkpoint, config.filename[FILE_A], config.filename[FILE_B]);
+	exit(EXIT_FAILURE);
+    }
+    if (!checkpoint_load(runtime.checkpoint, runtime.diffmanager, runtime.context, &state)) {
+	PRINT_VERBOSE(stderr, "no checkpoint in %s, start from the beginning\n", config.checkpoint);
+	return;
     }
-    free(line);
-    regfree(&regex);
 
-    // printout diff
-    diffmanager_output_diff(runtime.diffmanager, outfile, 0);
+    int i;
+    for (i=0; i<MAX_FILE; i++) {
+	if (fseeko(runtime.infile[i], state.offset[i], SEEK_SET)) {
+	    fprintf(stderr, "error: could not seek in input file '%s': %s\n", config.filename[i], strerror(errno));
+	    exit(EXIT_FAILURE);
+	}
+	runtime.byteOffset[i] = state.offset[i];
+	runtime.lineOffset[i] = state.lines[i];
+    }
+    runtime.skippedlines = state.skippedlines;
+    PRINT_VERBOSE(stderr, "resume at line %lu of %s and line %lu of %s\n",
+	    runtime.lineOffset[FILE_A] + 1, config.filename[FILE_A],
+	    runtime.lineOffset[FILE_B] + 1, config.filename[FILE_B]);
+}
 
-    // clean up
-    fclose(outfile);
+/* save a checkpoint if the interval has passed.
+ * @param slice: a slice has just been compared by "diff"
+ */
+void checkpoint_tick(int slice) {
+
+    if (!runtime.checkpoint)
+	return;
+
+    const time_t now = time(NULL);
+    if (config.checkpointinterval? now - runtime.checkpointtime < config.checkpointinterval: !slice)
+	return;
+
+    // the lines in the spill files are not saved
+    int i;
+    for (i=0; i<MAX_FILE; i++) {
+	struct longline_s *longlines = runtime.reader[i]->longlines;
+	pthread_mutex_lock(&longlines->mutex);
+	const long count = longlines->count;
+	pthread_mutex_unlock(&longlines->mutex);
+	if (count)
+	    return;
+    }
+
+    struct checkpoint_state_s state;
+    memset(&state, 0, sizeof(state));
+    for (i=0; i<MAX_FILE; i++) {
+	state.offset[i] = runtime.byteOffset[i];
+	state.lines[i] = runtime.lineOffset[i];
+    }
+    state.skippedlines = runtime.skippedlines;
+    checkpoint_save(runtime.checkpoint, runtime.diffmanager, runtime.context, &state);
+    runtime.checkpointtime = now;
+
+    PRINT_VERBOSE(stderr, "checkpoint %ld at line %lu of %s and line %lu of %s\n",
+	    runtime.checkpoint->checkpoints,
+	    runtime.lineOffset[FILE_A], config.filename[FILE_A],
+	    runtime.lineOffset[FILE_B], config.filename[FILE_B]);
+}
+
+/* set the inputs to the position saved in the state file of the last
+ * incremental run. Nothing is done if there is none.
+ */
+void incremental_start(size_t chunksize) {
+
+    if (access(config.incremental, F_OK)) {
+	PRINT_VERBOSE(stderr, "no state in %s, start from the beginning\n", config.incremental);
+	return;
+    }
+
+    struct checkpoint_s *checkpoint = checkpoint_open(config.incremental, checkpoint_params(chunksize, 1), 1);
+    struct checkpoint_state_s state;
+    if (!checkpoint || !checkpoint_load(checkpoint, runtime.diffmanager, runtime.context, &state)) {
+	fprintf(stderr, "state '%s' does not match '%s', '%s' or the options\n", config.incremental, config.filename[FILE_A], config.filename[FILE_B]);
+	exit(EXIT_FAILURE);
+    }
+    checkpoint_close(checkpoint, 0);
+
+    int i;
+    for (i=0; i<MAX_FILE; i++) {
+	struct stat st;
+	if (fstat(fileno(runtime.infile[i]), &st) || st.st_size < state.offset[i]) {
+	    fprintf(stderr, "'%s' is shorter than at the last run, it has not only been appended to\n", config.filename[i]);
+	    exit(EXIT_FAILURE);
+	}
+	if (fseeko(runtime.infile[i], state.offset[i], SEEK_SET)) {
+	    fprintf(stderr, "error: could not seek in input file '%s': %s\n", config.filename[i], strerror(errno));
+	    exit(EXIT_FAILURE);
+	}
+	runtime.byteOffset[i] = state.offset[i];
+	runtime.lineOffset[i] = state.lines[i];
+    }
+    runtime.skippedlines = state.skippedlines;
+    diffmanager_set_first_lines(runtime.diffmanager, runtime.lineOffset[FILE_A] + 1, runtime.lineOffset[FILE_B] + 1);
+    PRINT_VERBOSE(stderr, "continue at line %lu of %s and line %lu of %s\n",
+	    runtime.lineOffset[FILE_A] + 1, config.filename[FILE_A],
+	    runtime.lineOffset[FILE_B] + 1, config.filename[FILE_B]);
+}
+
+/* save the position of the compared inputs for the next incremental run.
+ * The state file is replaced as a whole.
+ */
+void incremental_save(size_t chunksize) {
+
+    char *path;
+    if (0 > asprintf(&path, "%s.new", config.incremental)) {
+	fprintf(stderr, "error: out of memory\n");
+	abort();
+    }
+
+    struct checkpoint_state_s state;
+    memset(&state, 0, sizeof(state));
+    int i;
+    for (i=0; i<MAX_FILE; i++) {
+	state.offset[i] = runtime.byteOffset[i];
+	state.lines[i] = runtime.lineOffset[i];
+    }
+    state.skippedlines = runtime.skippedlines;
+
+    // the differing lines have been printed, only the context is saved
+    diffmanager_delete_diff(runtime.diffmanager, LONG_MAX);
+    struct checkpoint_s *checkpoint = checkpoint_open(path, checkpoint_params(chunksize, 1), 0);
+    checkpoint_save(checkpoint, runtime.diffmanager, runtime.context, &state);
+    checkpoint_close(checkpoint, 0);
+    if (rename(path, config.incremental)) {
+	fprintf(stderr, "error: could not write state file '%s': %s\n", config.incremental, strerror(errno));
+	exit(EXIT_FAILURE);
+    }
+    free(path);
+}
+
+/* cut off the last line of input i if it is still being written, i.e. the
+ * chunk ends within a line. It is left to the next incremental run.
+ * @return: chunk without the open line, NULL if nothing is left
+ */
+struct chunk_s *incremental_cut_open_line(int i, struct chunk_s *chunk) {
+
+    chunkreader_load(runtime.reader[i], chunk);
+    if (!chunk->len || '\n' == chunk->data[chunk->len - 1])
+	return chunk;
+
+    // the chunks end with whole lines except the last one of the input
+    runtime.eof[i] = 1;
+    const char *newline = memrchr(chunk->data, '\n', chunk->len);
+    if (!newline) {
+	runtime.openbytes[i] = chunk->len;
+	chunk_free(chunk);
+	return NULL;
+    }
+    struct chunk_s *tail = chunk_split(chunk, newline - chunk->data, config.compareflags, config.mask);
+    assert(tail);
+    runtime.openbytes[i] = tail->len;
+    chunk_free(tail);
+
+    return chunk;
+}
+
+/* add a chunk of the pending list of input i to its hash table */
+void pending_table_add(int i, struct chunk_s *chunk) {
+
+    struct pending_table_s *table = &runtime.pendingtable[i];
+    if (table->count >= table->size) {
+	// grow and rehash, one entry per bucket on average at most
+	const size_t size = table->size? 2 * table->size: 1024;
+	struct pending_entry_s **bucket = calloc(size, sizeof(*bucket));
+	assert(bucket);
+	size_t n;
+	for (n=0; n<table->size; n++) {
+	    struct pending_entry_s *entry;
+	    while ((entry = table->bucket[n])) {
+		table->bucket[n] = entry->next;
+		entry->next = bucket[entry->chunk->hash & (size - 1)];
+		bucket[entry->chunk->hash & (size - 1)] = entry;
+	    }
+	}
+	free(table->bucket);
+	table->bucket = bucket;
+	table->size = size;
+    }
+
+    struct pending_entry_s *entry = malloc(sizeof(*entry));
+    assert(entry);
+    entry->chunk = chunk;
+    entry->next = table->bucket[chunk->hash & (table->size - 1)];
+    table->bucket[chunk->hash & (table->size - 1)] = entry;
+    table->count++;
+}
+
+/* remove a chunk of the pending list of input i from its hash table */
+void pending_table_remove(int i, const struct chunk_s *chunk) {
+
+    struct pending_table_s *table = &runtime.pendingtable[i];
+    assert(table->size);
+    struct pending_entry_s **entry = &table->bucket[chunk->hash & (table->size - 1)];
+    while ((*entry)->chunk != chunk)
+	entry = &(*entry)->next;
+    struct pending_entry_s *found = *entry;
+    *entry = found->next;
+    free(found);
+    table->count--;
+}
+
+/* free the hash table of input i, the chunks are not touched */
+void pending_table_free(int i) {
+
+    struct pending_table_s *table = &runtime.pendingtable[i];
+    size_t n;
+    for (n=0; n<table->size; n++) {
+	struct pending_entry_s *entry;
+	while ((entry = table->bucket[n])) {
+	    table->bucket[n] = entry->next;
+	    free(entry);
+	}
+    }
+    free(table->bucket);
+    memset(table, 0, sizeof(*table));
+}
+
+/* fetch the next chunk of input i into the pending list.
+ * @return: the new chunk, NULL at end of input
+ */
+struct chunk_s *pending_fetch(int i) {
+
+    if (runtime.eof[i])
+	return NULL;
+
+    struct chunk_s *chunk = chunkreader_get(runtime.reader[i]);
+    if (chunk && config.incremental)
+	chunk = incremental_cut_open_line(i, chunk);
+    if (chunk) {
+	STAILQ_INSERT_TAIL(&runtime.pending[i], chunk, entries);
+	pending_table_add(i, chunk);
+	runtime.pendingbytes[i] += chunk->len;
+    }
+    else
+	runtime.eof[i] = 1;
+
+    return chunk;
+}
+
+/* remove the first chunk of the pending list of input i.
+ * The lines of this chunk are counted as compared.
+ */
+void pending_drop_first(int i) {
+
+    struct chunk_s *chunk = STAILQ_FIRST(&runtime.pending[i]);
+    assert(chunk);
+
+    STAILQ_REMOVE_HEAD(&runtime.pending[i], entries);
+    pending_table_remove(i, chunk);
+    runtime.pendingbytes[i] -= chunk->len;
+    runtime.lineOffset[i] += chunk->lines;
+    runtime.byteOffset[i] += chunk->inlen;
+    if (runtime.context && FILE_A == i) {
+	chunkreader_load(runtime.reader[i], chunk);
+	context_pass(runtime.context, chunk->data, chunk->len, chunk->lines);
+    }
+    chunk_free(chunk);
+}
+
+/* search the pending list of input i for a chunk equal to the given one.
+ * Equal chunks have the same hash, only those are compared.
+ * @return: the first equal chunk of the list, NULL if none found
+ */
+struct chunk_s *pending_find_equal(int i, const struct chunk_s *chunk) {
+
+    const struct pending_table_s *table = &runtime.pendingtable[i];
+    if (!table->size)
+	return NULL;
+
+    struct chunk_s *found = NULL;
+    const struct pending_entry_s *entry;
+    for (entry = table->bucket[chunk->hash & (table->size - 1)]; entry; entry = entry->next) {
+	// the pending list is ordered by offset
+	struct chunk_s *it = entry->chunk;
+	if (it->hash == chunk->hash && (!found || it->offset < found->offset)
+		&& chunk_equal(it, chunk, config.compareflags, config.mask))
+	    found = it;
+    }
+
+    return found;
+}
+
+/* find the next pair of equal chunks in input A and B.
+ * The first pending chunks of A and B are known to differ. Read on in both
+ * inputs until a chunk of one input matches a pending chunk of the other
+ * input. Stop reading if SPLITSIZE bytes are pending in both inputs.
+ *
+ * @param match: returns the matching chunks of A and B, or NULL if no match
+ *   has been found. In that case SPLITSIZE bytes of both inputs have to be
+ *   compared.
+ */
+void pending_find_resync(struct chunk_s *match[MAX_FILE]) {
+
+    struct chunk_s *chunk;
+
+    match[FILE_A] = match[FILE_B] = NULL;
+
+    // the pending lists may hold chunks which are not compared yet
+    STAILQ_FOREACH(chunk, &runtime.pending[FILE_A], entries) {
+	struct chunk_s *other = pending_find_equal(FILE_B, chunk);
+	if (other) {
+	    match[FILE_A] = chunk;
+	    match[FILE_B] = other;
+	    return;
+	}
+    }
+
+    for (;;) {
+	// read on in the input with less pending data
+	int i = runtime.pendingbytes[FILE_A] <= runtime.pendingbytes[FILE_B]? FILE_A: FILE_B;
+	if (runtime.eof[i] || runtime.pendingbytes[i] >= config.splitsize)
+	    i = !i;
+	if (runtime.eof[i] || runtime.pendingbytes[i] >= config.splitsize)
+	    break;
+
+	chunk = pending_fetch(i);
+	if (!chunk)
+	    continue;
+
+	struct chunk_s *other = pending_find_equal(!i, chunk);
+	if (other) {
+	    match[i] = chunk;
+	    match[!i] = other;
+	    return;
+	}
+    }
+}
+
+/* compare the slices without "diff" if the result is known: slices with
+ * the same bytes do not differ, the lines of a slice compared to an empty
+ * one are all deleted or added.
+ * @return: 1 if compared, else 0
+ */
+int slice_compare_trivial(struct chunk_list_s span[MAX_FILE]) {
+
+    long lines[MAX_FILE];
+    int i;
+
+    const int trivial = chunk_lists_compare_trivial(&span[FILE_A], &span[FILE_B], lines);
+    if (CHUNK_LISTS_DIFFER == trivial)
+	return 0;
+    if (CHUNK_LISTS_ONE_EMPTY == trivial) {
+	const struct slicecache_hunk_s hunk = { 1, lines[FILE_A], 1, lines[FILE_B] };
+	slice_replay(&hunk, 1);
+    }
+
+    for (i=0; i<MAX_FILE; i++)
+	runtime.threadbuffer[i].lines_copied = lines[i];
+    runtime.trivialslices++;
+
+    return 1;
+}
+
+/* hash the lines of a slice the way they are compared.
+ * @return: allocated hashes, count of them in count
+ */
+uint64_t *slice_hash_lines(const struct chunk_list_s *span, long lines, size_t *count) {
+
+    uint64_t *hashes = malloc(MAX(1, lines) * sizeof(*hashes));
+    assert(hashes);
+    const struct chunk_s *chunk;
+    *count = 0;
+    STAILQ_FOREACH(chunk, span, entries) {
+	size_t offset = 0;
+	while (offset < chunk->len) {
+	    const char *line = chunk->data + offset;
+	    const char *newline = memchr(line, '\n', chunk->len - offset);
+	    const size_t len = newline? (size_t) (newline + 1 - line): chunk->len - offset;
+	    offset += len;
+	    assert(*count < (size_t) lines);
+	    hashes[(*count)++] = mask_hash_lines(config.mask, line, len, config.compareflags);
+	}
+    }
+
+    return hashes;
+}
+
+/* replace the slices as a whole if "diff" would delete and insert more
+ * than --max-cost lines. "diff" may take quadratic time on such slices,
+ * the lower bound of its cost takes linear memory.
+ * @return: 1 if replaced, else 0
+ */
+int slice_compare_costly(struct chunk_list_s span[MAX_FILE]) {
+
+    int64_t lines[MAX_FILE];
+    uint64_t *hashes[MAX_FILE];
+    size_t count[MAX_FILE];
+    int i;
+
+    for (i=0; i<MAX_FILE; i++) {
+	const struct chunk_s *chunk;
+	lines[i] = 0;
+	STAILQ_FOREACH(chunk, &span[i], entries)
+	    lines[i] += chunk->lines;
+    }
+    if (lines[FILE_A] + lines[FILE_B] <= config.maxcost)
+	return 0;
+
+    for (i=0; i<MAX_FILE; i++)
+	hashes[i] = slice_hash_lines(&span[i], lines[i], &count[i]);
+    const int64_t cost = editcost_lower_bound(hashes[FILE_A], count[FILE_A], hashes[FILE_B], count[FILE_B]);
+    for (i=0; i<MAX_FILE; i++)
+	free(hashes[i]);
+    if (cost <= config.maxcost)
+	return 0;
+
+    const struct slicecache_hunk_s hunk = { 1, lines[FILE_A], 1, lines[FILE_B] };
+    slice_replay(&hunk, 1);
+    for (i=0; i<MAX_FILE; i++)
+	runtime.threadbuffer[i].lines_copied = lines[i];
+    runtime.costlyslices++;
+
+    return 1;
+}
+
+/* compare the slices of A and B by "diff", or take the differences found
+ * before from the slice cache. The chunks have to be loaded.
+ */
+void slice_compare(struct chunk_list_s span[MAX_FILE], regex_t *regex) {
+
+    uint64_t key[MAX_FILE];
+    int64_t lines[MAX_FILE];
+    int i;
+
+    runtime.slices++;
+    if (slice_compare_trivial(span))
+	return;
+    // before the cache, the cache holds the result of "diff"
+    if (config.maxcost && slice_compare_costly(span))
+	return;
+
+    if (runtime.cache) {
+	for (i=0; i<MAX_FILE; i++) {
+	    const struct chunk_s *chunk;
+	    key[i] = runtime.cacheparams;
+	    lines[i] = 0;
+	    STAILQ_FOREACH(chunk, &span[i], entries) {
+		key[i] = hash_bytes(chunk->data, chunk->len, key[i]);
+		lines[i] += chunk->lines;
+	    }
+	}
+
+	struct slicecache_hunk_s *hunks;
+	size_t count;
+	if (slicecache_get(runtime.cache, key, lines, &hunks, &count)) {
+	    slice_replay(hunks, count);
+	    free(hunks);
+	    for (i=0; i<MAX_FILE; i++)
+		runtime.threadbuffer[i].lines_copied = lines[i];
+	    return;
+	}
+	runtime.hunkcount = 0;
+    }
+
+    FILE *splitinput = diff_open();
+    diff_read_output(splitinput, regex);
+    diff_close(splitinput);
+
+    if (runtime.cache)
+	slicecache_put(runtime.cache, key, lines, runtime.hunks, runtime.hunkcount);
+}
+
+/* run "diff" on the pending chunks in front of the matching chunks.
+ * @param match: first chunk not to compare, NULL to compare SPLITSIZE bytes
+ */
+void pending_diff(struct chunk_s *match[MAX_FILE], regex_t *regex) {
+
+    struct chunk_list_s span[MAX_FILE];
+    struct chunk_s *chunk;
+    int i;
+
+    memset(&runtime.threadbuffer, 0, sizeof(runtime.threadbuffer));
+    for (i=0; i<MAX_FILE; i++) {
+	long long int bytes = 0;
+	STAILQ_INIT(&span[i]);
+	while ((chunk = STAILQ_FIRST(&runtime.pending[i])) && chunk != match[i]) {
+	    if (!match[i] && bytes >= config.splitsize)
+		break;
+	    // chunks taken from the index are read when they are compared
+	    chunkreader_load(runtime.reader[i], chunk);
+	    // before the split, it changes the hash
+	    pending_table_remove(i, chunk);
+	    if (!match[i] && bytes + (long long int) chunk->len > config.splitsize) {
+		// without a matching chunk feed SPLITSIZE bytes, the rest of
+		// this chunk stays pending
+		struct chunk_s *tail = chunk_split(chunk, config.splitsize - bytes - 1, config.compareflags, config.mask);
+		if (tail) {
+		    STAILQ_INSERT_AFTER(&runtime.pending[i], chunk, tail, entries);
+		    pending_table_add(i, tail);
+		}
+	    }
+	    STAILQ_REMOVE_HEAD(&runtime.pending[i], entries);
+	    runtime.pendingbytes[i] -= chunk->len;
+	    bytes += chunk->len;
+	    STAILQ_INSERT_TAIL(&span[i], chunk, entries);
+	}
+	runtime.threadbuffer[i].chunks = &span[i];
+	runtime.threadbuffer[i].mask = config.mask;
+	runtime.cursor[i].chunk = STAILQ_FIRST(&span[i]);
+	runtime.cursor[i].offset = 0;
+	runtime.cursor[i].line = 1;
+    }
+
+    slice_compare(span, regex);
+
+    if (runtime.context) {
+	// the hunks are known now, keep the lines around them
+	STAILQ_FOREACH(chunk, &span[FILE_A], entries)
+	    context_pass(runtime.context, chunk->data, chunk->len, chunk->lines);
+    }
+
+    for (i=0; i<MAX_FILE; i++) {
+	runtime.lineOffset[i] += runtime.threadbuffer[i].lines_copied;
+	while ((chunk = STAILQ_FIRST(&span[i]))) {
+	    STAILQ_REMOVE_HEAD(&span[i], entries);
+	    runtime.byteOffset[i] += chunk->inlen;
+	    chunk_free(chunk);
+	}
+    }
+}
+
+
+/* print the bytes read by the chunk readers so far */
+void print_throughput(void) {
+    const double seconds = iolimit_seconds(runtime.iolimit);
+    const double megabytes = runtime.iolimit->bytes / (1024.0 * 1024.0);
+    PRINT_VERBOSE(stderr, "read %.1f MB in %.1f s, %.1f MB/s", megabytes, seconds, seconds > 0? megabytes / seconds: 0);
+    if (config.iolimit)
+	PRINT_VERBOSE(stderr, ", readers waited %.1f s", runtime.iolimit->throttled);
+    PRINT_VERBOSE(stderr, "\n");
+}
+
+/* derive the options not given from the memory and cores available to the
+ * process, e.g. limited by the cgroup of a container.
+ */
+void tune_defaults(size_t chunksize) {
+    struct resources_s res;
+    resources_detect(&res);
+    PRINT_VERBOSE(stderr, "memory %llu MB%s, %ld of %ld cores usable\n",
+	    (unsigned long long) (res.memory >> 20), res.memorylimited? " (cgroup limit)": "", res.cpus, res.cores);
+
+    if (!config.splitsize) {
+	config.splitsize = resources_splitsize(&res);
+	if (!config.splitsize)
+	    config.splitsize = default_splitsize;
+    }
+    if (!config.prefetch)
+	config.prefetch = resources_prefetch(&res, MIN(chunksize, (size_t) config.splitsize));
+    if (!config.threads)
+	config.threads = resources_threads(&res);
+    PRINT_VERBOSE(stderr, "slice size %lld byte, %d chunks read ahead, %ld threads\n",
+	    config.splitsize, config.prefetch, config.threads);
+}
+
+
+int main(int argc, char **argv) {
+    int retval;
+    regex_t regex;
+
+    runtime.argv0 = argv[0];
+    config.delim = ',';
+    config.context = default_context;
+    config.checkpointinterval = default_checkpoint_interval;
+    config.cachesize = default_cachesize;
+
+    static const struct option long_options[] = {
+	{ "sorted", no_argument, NULL, OPT_SORTED },
+	{ "key", required_argument, NULL, OPT_KEY },
+	{ "delim", required_argument, NULL, OPT_DELIM },
+	{ "mask", required_argument, NULL, OPT_MASK },
+	{ "intern", no_argument, NULL, OPT_INTERN },
+	{ "compress", required_argument, NULL, OPT_COMPRESS },
+	{ "moves", required_argument, NULL, OPT_MOVES },
+	{ "index-dir", required_argument, NULL, OPT_INDEX_DIR },
+	{ "fingerprint", required_argument, NULL, OPT_FINGERPRINT },
+	{ "checkpoint", required_argument, NULL, OPT_CHECKPOINT },
+	{ "resume", no_argument, NULL, OPT_RESUME },
+	{ "checkpoint-interval", required_argument, NULL, OPT_CHECKPOINT_INTERVAL },
+	{ "incremental", required_argument, NULL, OPT_INCREMENTAL },
+	{ "cache-dir", required_argument, NULL, OPT_CACHE_DIR },
+	{ "cache-size", required_argument, NULL, OPT_CACHE_SIZE },
+	{ "prefetch", required_argument, NULL, OPT_PREFETCH },
+	{ "threads", required_argument, NULL, OPT_THREADS },
+	{ "io-limit", required_argument, NULL, OPT_IO_LIMIT },
+	{ "nice-io", no_argument, NULL, OPT_NICE_IO },
+	{ "max-cost", required_argument, NULL, OPT_MAX_COST },
+	{ NULL, 0, NULL, 0 }
+    };
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "hVvibwBo:s:uU:", long_options, NULL)) != -1)
+    {
+	if ('-' == opt)
+	    /* '--' option, end processing */
+	    break;
+
+	switch (opt)
+	{
+	case 'h':
+	    usage(argv[0]);
+	    exit(EXIT_SUCCESS);
+	case 'v':
+	    config.be_verbose = 1;
+	    break;
+	case 'V':
+	    print_version();
+	    exit(EXIT_SUCCESS);
+	case 'i':
+	    config.compareflags |= HASH_IGNORE_CASE;
+	    break;
+	case 'b':
+	    config.compareflags |= HASH_IGNORE_SPACE_CHANGE;
+	    break;
+	case 'w':
+	    config.compareflags |= HASH_IGNORE_ALL_SPACE;
+	    break;
+	case 'B':
+	    // blank lines are compared, their hunks left out on output
+	    config.ignoreblank = 1;
+	    break;
+	case 'o':
+	    config.outfilename = optarg;
+	    break;
+	case 'u':
+	    config.unified = 1;
+	    break;
+	case 'U':
+	{
+	    char *end;
+	    long lines = strtol(optarg, &end, 10);
+	    if (*end || end == optarg || lines < 0) {
+		fprintf(stderr, "Invalid argument to option '-U': %s\n", optarg);
+		usage(argv[0]);
+		exit(EXIT_FAILURE);
+	    }
+	    config.unified = 1;
+	    config.context = lines;
+	}
+	    break;
+	case OPT_SORTED:
+	    config.sorted = 1;
+	    break;
+	case OPT_KEY:
+	{
+	    char *end;
+	    long column = strtol(optarg, &end, 10);
+	    if (*end || column < 1 || column > INT_MAX) {
+		fprintf(stderr, "Invalid argument to option '--key': %s\n", optarg);
+		usage(argv[0]);
+		exit(EXIT_FAILURE);
+	    }
+	    config.keycolumn = column;
+	}
+	    break;
+	case OPT_DELIM:
+	    if (!strcmp(optarg, "\\t"))
+		config.delim = '\t';
+	    else if (1 == strlen(optarg))
+		config.delim = *optarg;
+	    else {
+		fprintf(stderr, "Invalid argument to option '--delim': %s\n", optarg);
+		usage(argv[0]);
+		exit(EXIT_FAILURE);
+	    }
+	    break;
+	case OPT_INTERN:
+	    config.intern = 1;
+	    break;
+	case OPT_COMPRESS:
+	{
+	    char *end;
+	    long level = strtol(optarg, &end, 10);
+	    if (*end || level < 1 || level > 9) {
+		fprintf(stderr, "Invalid argument to option '--compress': %s\n", optarg);
+		usage(argv[0]);
+		exit(EXIT_FAILURE);
+	    }
+	    config.compress = level;
+	}
+	    break;
+	case OPT_MOVES:
+	{
+	    char *end;
+	    long lines = strtol(optarg, &end, 10);
+	    if (*end || lines < 1) {
+		fprintf(stderr, "Invalid argument to option '--moves': %s\n", optarg);
+		usage(argv[0]);
+		exit(EXIT_FAILURE);
+	    }
+	    config.moves = lines;
+	}
+	    break;
+	case OPT_INDEX_DIR:
+	    config.indexdir = optarg;
+	    break;
+	case OPT_FINGERPRINT:
+	    config.fingerprint = optarg;
+	    break;
+	case OPT_CHECKPOINT:
+	    config.checkpoint = optarg;
+	    break;
+	case OPT_RESUME:
+	    config.resume = 1;
+	    break;
+	case OPT_CHECKPOINT_INTERVAL:
+	{
+	    char *end;
+	    long seconds = strtol(optarg, &end, 10);
+	    if (*end || end == optarg || seconds < 0) {
+		fprintf(stderr, "Invalid argument to option '--checkpoint-interval': %s\n", optarg);
+		usage(argv[0]);
+		exit(EXIT_FAILURE);
+	    }
+	    config.checkpointinterval = seconds;
+	}
+	    break;
+	case OPT_INCREMENTAL:
+	    config.incremental = optarg;
+	    break;
+	case OPT_CACHE_DIR:
+	    config.cachedir = optarg;
+	    break;
+	case OPT_CACHE_SIZE:
+	    config.cachesize = parse_size(argv[0], "--cache-size", optarg);
+	    if (!config.cachesize) {
+		fprintf(stderr, "Invalid argument to option '--cache-size': %s\n", optarg);
+		usage(argv[0]);
+		exit(EXIT_FAILURE);
+	    }
+	    break;
+	case OPT_MASK:
+	    if (!config.mask)
+		config.mask = mask_new();
+	    mask_add(config.mask, optarg);
+	    break;
+	case OPT_PREFETCH:
+	{
+	    char *end;
+	    long depth = strtol(optarg, &end, 10);
+	    if (*end || depth < 1 || depth > INT_MAX) {
+		fprintf(stderr, "Invalid argument to option '--prefetch': %s\n", optarg);
+		usage(argv[0]);
+		exit(EXIT_FAILURE);
+	    }
+	    config.prefetch = depth;
+	}
+	    break;
+	case OPT_THREADS:
+	{
+	    char *end;
+	    long threads = strtol(optarg, &end, 10);
+	    if (*end || threads < 1) {
+		fprintf(stderr, "Invalid argument to option '--threads': %s\n", optarg);
+		usage(argv[0]);
+		exit(EXIT_FAILURE);
+	    }
+	    config.threads = threads;
+	}
+	    break;
+	case OPT_IO_LIMIT:
+	{
+	    char *end;
+	    double rate = strtod(optarg, &end);
+	    if (*end || end == optarg || !(rate > 0)) {
+		fprintf(stderr, "Invalid argument to option '--io-limit': %s\n", optarg);
+		usage(argv[0]);
+		exit(EXIT_FAILURE);
+	    }
+	    config.iolimit = rate;
+	}
+	    break;
+	case OPT_NICE_IO:
+	    config.niceio = 1;
+	    break;
+	case OPT_MAX_COST:
+	{
+	    char *end;
+	    long lines = strtol(optarg, &end, 10);
+	    if (*end || lines < 1) {
+		fprintf(stderr, "Invalid argument to option '--max-cost': %s\n", optarg);
+		usage(argv[0]);
+		exit(EXIT_FAILURE);
+	    }
+	    config.maxcost = lines;
+	}
+	    break;
+	case 's':
+	    config.splitsize = parse_size(argv[0], "-s", optarg);
+	    if (!config.splitsize) {
+		fprintf(stderr, "Invalid argument to option '-s': %s\n", optarg);
+		usage(argv[0]);
+		exit(EXIT_FAILURE);
+	    }
+	    break;
+	default: /* '?' */
+	    usage(argv[0]);
+	    exit(EXIT_FAILURE);
+	}
+    }
+
+
+    if (config.sorted && config.keycolumn) {
+	fprintf(stderr, "options '--sorted' and '--key' can not be combined\n");
+	usage(argv[0]);
+	exit(EXIT_FAILURE);
+    }
+
+    if (config.mask && (config.sorted || config.keycolumn)) {
+	fprintf(stderr, "option '--mask' can not be combined with '--sorted' or '--key'\n");
+	usage(argv[0]);
+	exit(EXIT_FAILURE);
+    }
+
+    if (config.maxcost && (config.sorted || config.keycolumn)) {
+	fprintf(stderr, "option '--max-cost' can not be combined with '--sorted' or '--key'\n");
+	usage(argv[0]);
+	exit(EXIT_FAILURE);
+    }
+
+    if (config.moves && (config.sorted || config.keycolumn)) {
+	fprintf(stderr, "option '--moves' can not be combined with '--sorted' or '--key'\n");
+	usage(argv[0]);
+	exit(EXIT_FAILURE);
+    }
+
+    if ((config.indexdir || config.fingerprint) && (config.sorted || config.keycolumn)) {
+	fprintf(stderr, "options '--index-dir' and '--fingerprint' can not be combined with '--sorted' or '--key'\n");
+	usage(argv[0]);
+	exit(EXIT_FAILURE);
+    }
+
+    if ((config.resume || config.checkpointinterval != default_checkpoint_interval) && !config.checkpoint) {
+	fprintf(stderr, "options '--resume' and '--checkpoint-interval' require '--checkpoint'\n");
+	usage(argv[0]);
+	exit(EXIT_FAILURE);
+    }
+
+    if (config.checkpoint && (config.sorted || config.keycolumn || config.fingerprint)) {
+	fprintf(stderr, "option '--checkpoint' can not be combined with '--sorted', '--key' or '--fingerprint'\n");
+	usage(argv[0]);
+	exit(EXIT_FAILURE);
+    }
+
+    if (config.incremental && (config.sorted || config.keycolumn || config.fingerprint || config.checkpoint)) {
+	fprintf(stderr, "option '--incremental' can not be combined with '--sorted', '--key', '--fingerprint' or '--checkpoint'\n");
+	usage(argv[0]);
+	exit(EXIT_FAILURE);
+    }
+
+    if (config.cachedir && (config.sorted || config.keycolumn)) {
+	fprintf(stderr, "option '--cache-dir' can not be combined with '--sorted' or '--key'\n");
+	usage(argv[0]);
+	exit(EXIT_FAILURE);
+    }
+
+    if ((config.iolimit || config.niceio) && (config.sorted || config.keycolumn)) {
+	fprintf(stderr, "options '--io-limit' and '--nice-io' can not be combined with '--sorted' or '--key'\n");
+	usage(argv[0]);
+	exit(EXIT_FAILURE);
+    }
+
+    if (config.unified && (config.sorted || config.keycolumn || config.moves)) {
+	fprintf(stderr, "option '-u' can not be combined with '--sorted', '--key' or '--moves'\n");
+	usage(argv[0]);
+	exit(EXIT_FAILURE);
+    }
+
+    tune_defaults(default_chunksize);
+
+    if (config.mask) {
+	retval = mask_compile(config.mask);
+	if (retval) {
+	    size_t len = regerror(retval, &config.mask->regex, NULL, 0);
+	    char *buffer = malloc(len);
+	    assert(buffer);
+	    (void) regerror (retval, &config.mask->regex, buffer, len);
+	    fprintf(stderr, "Invalid argument to option '--mask': %s\n", buffer);
+	    exit(EXIT_FAILURE);
+	}
+    }
+
+
+    // only INPUT1 to write its fingerprint
+    const int inputs = config.fingerprint && argc - optind == 1? 1: MAX_FILE;
+    int i;
+    for (i=0; i<inputs; i++) {
+	if (optind >= argc) {
+	    fprintf(stderr, "INPUT%d missing\n", i);
+	    usage(argv[0]);
+	    exit(EXIT_FAILURE);
+	}
+	config.filename[i] = argv[optind++];
+    }
+
+
+    if (MAX_FILE == inputs && !strcmp(config.filename[FILE_A], config.filename[FILE_B])) {
+	// input is twice the same file name or twice stdin
+	fprintf(stderr, "no need to compare same files\n");
+	exit(EXIT_FAILURE);
+    }
+
+
+    for (i=0; i<inputs; i++) {
+	if (strcmp(config.filename[i], "-")) {
+	    // file is regular
+	    runtime.infile[i] = fopen(config.filename[i], "r");
+	    if (NULL == runtime.infile[i]) {
+		fprintf(stderr, "error: could not open input file '%s': %s\n", config.filename[i], strerror(errno));
+		exit(EXIT_FAILURE);
+	    }
+	}
+	else {
+	    // file is stdin
+	    runtime.infile[i] = stdin;
+	}
+    }
+
+
+    // before any thread or "diff" is started, they inherit the priority
+    if (config.niceio && iolimit_idle_priority())
+	fprintf(stderr, "warning: can not set idle I/O priority: %s\n", strerror(errno));
+    runtime.iolimit = iolimit_new(config.iolimit * 1024 * 1024, config.niceio);
+
+    const size_t chunksize = MIN(default_chunksize, (size_t) config.splitsize);
+    if (1 == inputs) {
+	fingerprint_write(chunksize);
+	print_throughput();
+	iolimit_delete(runtime.iolimit);
+	return 0;
+    }
+
+
+    FILE *outfile = config.outfilename?fopen(config.outfilename, "w"):stdout;
+    if (NULL == outfile) {
+	fprintf(stderr, "error: could not open output file '%s': %s\n", config.outfilename, strerror(errno));
+	exit(EXIT_FAILURE);
+    }
+
+
+    if (config.sorted) {
+	// one merge pass, neither "diff" nor the diffmanager is needed
+	mergediff_compare(runtime.infile[FILE_A], runtime.infile[FILE_B], outfile);
+	fclose(outfile);
+	return 0;
+    }
+
+    if (config.keycolumn) {
+	// partition the records into buckets, one bucket of A has to fit into
+	// memory per thread. Try to keep that below SPLITSIZE.
+	int buckets = default_keybuckets;
+	long threads = config.threads;
+	struct stat st;
+	if (!fstat(fileno(runtime.infile[FILE_A]), &st) && S_ISREG(st.st_mode) && st.st_size) {
+	    buckets = MIN(max_keybuckets, MAX(default_keybuckets, 2*st.st_size/config.splitsize));
+	    threads = MIN(threads, config.splitsize / (st.st_size/buckets + 1));
+	}
+	threads = MAX(1, threads);
+	PRINT_VERBOSE(stderr, "key compare with %d buckets, %ld threads\n", buckets, threads);
+
+	keydiff_compare(runtime.infile[FILE_A], runtime.infile[FILE_B], outfile, config.keycolumn, config.delim, buckets, threads);
+	fclose(outfile);
+	return 0;
+    }
+
+
+    runtime.diffmanager = diffmanager_new();
+    diffmanager_set_compare_flags(runtime.diffmanager, config.compareflags);
+    if (config.ignoreblank)
+	diffmanager_enable_ignore_blank_lines(runtime.diffmanager);
+    diffmanager_set_mask(runtime.diffmanager, config.mask);
+    if (config.intern)
+	diffmanager_enable_intern(runtime.diffmanager);
+    diffmanager_set_moves(runtime.diffmanager, config.moves);
+    if (config.unified) {
+	for (i=0; i<MAX_FILE; i++)
+	    runtime.label[i] = unified_label(i);
+	diffmanager_set_unified(runtime.diffmanager, config.context, runtime.label[FILE_A], runtime.label[FILE_B]);
+	runtime.context = context_new(runtime.diffmanager, config.context);
+    }
+    if (diffmanager_set_compression(runtime.diffmanager, config.compress)) {
+	fprintf(stderr, "option '--compress' is not supported, lfdiff is built without zlib\n");
+	exit(EXIT_FAILURE);
+    }
+
+    // prepare regular expression
+    retval = regcomp(&regex, "^([0-9]+),?([0-9]*)([acd])([0-9]+),?([0-9]*)\n$",  REG_EXTENDED/*|REG_NEWLINE*/);
+    if( retval ) {
+	size_t len = regerror(retval, &regex, NULL, 0);
+	char *buffer = malloc(len);
+	assert(buffer);
+	(void) regerror (retval, &regex, buffer, len);
+	fprintf(stderr, "Could not compile regular expression: %s", buffer);
+	abort();
+    }
+
+    // a resumed run reads the inputs from the checkpoint on, without index
+    if (config.checkpoint)
+	checkpoint_start(chunksize);
+    if (config.incremental)
+	incremental_start(chunksize);
+    if (config.cachedir) {
+	const uint64_t options[] = { slicecache_version, config.compareflags };
+	runtime.cacheparams = hash_bytes(options, sizeof(options), 0);
+	if (config.mask)
+	    runtime.cacheparams = hash_bytes(config.mask->pattern, strlen(config.mask->pattern), runtime.cacheparams);
+	runtime.cache = slicecache_open(config.cachedir, config.cachesize);
+    }
+
+    for (i=0; i<MAX_FILE; i++) {
+	runtime.reader[i] = chunkreader_new(runtime.infile[i], chunksize, config.prefetch, config.compareflags, config.mask, index_open(i, chunksize), runtime.iolimit);
+	STAILQ_INIT(&runtime.pending[i]);
+	if (runtime.reader[i]->indexed)
+	    PRINT_VERBOSE(stderr, "chunks of %s taken from index\n", config.filename[i]);
+    }
+    diffmanager_set_longlines(runtime.diffmanager, runtime.reader[FILE_A]->longlines, runtime.reader[FILE_B]->longlines);
+
+    /* Algorithm:
+     * 1) read chunks of whole lines from A and B in parallel
+     * 2) skip the chunks as long as they are equal
+     * 3) read on until a chunk of A matches a chunk of B
+     * 4) feed only the chunks in front of the matching chunks to "diff"
+     * 5) skip the matching chunks and start over with 2)
+     * The chunk boundaries depend on the content, so equal regions are found
+     * even if lines have been added or removed in front of them.
+     */
+    int iteration = 0;
+    for (;;) {
+	for (i=0; i<MAX_FILE; i++)
+	    if (STAILQ_EMPTY(&runtime.pending[i]))
+		pending_fetch(i);
+
+	struct chunk_s *chunkA = STAILQ_FIRST(&runtime.pending[FILE_A]);
+	struct chunk_s *chunkB = STAILQ_FIRST(&runtime.pending[FILE_B]);
+	if (!chunkA && !chunkB)
+	    break;
+
+	if (chunkA && chunkB && chunk_equal(chunkA, chunkB, config.compareflags, config.mask)) {
+	    runtime.skippedlines += chunkA->lines;
+	    pending_drop_first(FILE_A);
+	    pending_drop_first(FILE_B);
+	    checkpoint_tick(0);
+	    continue;
+	}
+
+	struct chunk_s *match[MAX_FILE];
+	pending_find_resync(match);
+	if (config.incremental && !match[FILE_A] && (runtime.eof[FILE_A] || runtime.eof[FILE_B]))
+	    break;	// the lines matching the differences may not be written yet
+
+	PRINT_VERBOSE(stderr, "diff input %d\n", ++iteration);
+	pending_diff(match, &regex);
+
+	if (match[FILE_A]) {
+	    // pending lists start with the matching chunks now
+	    runtime.skippedlines += match[FILE_A]->lines;
+	    pending_drop_first(FILE_A);
+	    pending_drop_first(FILE_B);
+	}
+	checkpoint_tick(1);
+    }
+    PRINT_VERBOSE(stderr, "skipped %lu equal lines\n", runtime.skippedlines);
+    print_throughput();
+    PRINT_VERBOSE(stderr, "compared %ld of %ld slices without \"diff\"\n", runtime.trivialslices, runtime.slices);
+    if (config.maxcost)
+	PRINT_VERBOSE(stderr, "replaced %ld slices as a whole, above --max-cost\n", runtime.costlyslices);
+    if (config.incremental) {
+	PRINT_VERBOSE(stderr, "left %lld bytes of %s and %lld bytes of %s to the next run\n",
+		runtime.pendingbytes[FILE_A] + runtime.openbytes[FILE_A], config.filename[FILE_A],
+		runtime.pendingbytes[FILE_B] + runtime.openbytes[FILE_B], config.filename[FILE_B]);
+	for (i=0; i<MAX_FILE; i++) {
+	    struct chunk_s *chunk;
+	    while ((chunk = STAILQ_FIRST(&runtime.pending[i]))) {
+		STAILQ_REMOVE_HEAD(&runtime.pending[i], entries);
+		chunk_free(chunk);
+	    }
+	}
+    }
+    for (i=0; i<MAX_FILE; i++)
+	pending_table_free(i);
+
+    regfree(&regex);
+
+    // printout diff, long lines are read from the spill files of the readers
+    diffmanager_set_line_count(runtime.diffmanager, runtime.lineOffset[FILE_A], runtime.lineOffset[FILE_B]);
+    diffmanager_output_diff(runtime.diffmanager, outfile, 0);
+    if (config.incremental) {
+	// the state may only move on once the output is written
+	fflush(outfile);
+	incremental_save(chunksize);
+    }
+    for (i=0; i<MAX_FILE; i++) {
+	if (runtime.reader[i]->indexed)
+	    PRINT_VERBOSE(stderr, "read %llu bytes of %s on demand\n", runtime.reader[i]->loaded, config.filename[i]);
+	chunkreader_delete(runtime.reader[i]);
+    }
+
+    if (runtime.diffmanager->intern) {
+	const struct intern_s *intern = runtime.diffmanager->intern;
+	PRINT_VERBOSE(stderr, "interned %ld lines, %ld distinct at most, saved %llu bytes\n",
+		intern->lookups, intern->maxcount, intern->savedbytes);
+    }
+    if (runtime.cache) {
+	PRINT_VERBOSE(stderr, "slice cache: %ld hits, %ld misses, %ld entries removed\n",
+		runtime.cache->hits, runtime.cache->misses, runtime.cache->evicted);
+	slicecache_close(runtime.cache);
+	free(runtime.hunks);
+    }
+    if (config.moves) {
+	PRINT_VERBOSE(stderr, "moved %ld blocks of %ld lines\n",
+		runtime.diffmanager->moves, runtime.diffmanager->movedlines);
+    }
+    if (config.compress) {
+	const struct diff_list_s *listA = runtime.diffmanager->difflistA;
+	const struct diff_list_s *listB = runtime.diffmanager->difflistB;
+	PRINT_VERBOSE(stderr, "packed %ld lines, %llu bytes into %llu bytes\n",
+		listA->packedlines + listB->packedlines,
+		listA->rawbytes + listB->rawbytes,
+		listA->packedbytes + listB->packedbytes);
+    }
+
+    // clean up
+    fclose(outfile);
+    if (runtime.checkpoint)
+	checkpoint_close(runtime.checkpoint, 1);
+    if (runtime.context)
+	context_delete(runtime.context);
+    for (i=0; i<MAX_FILE; i++)
+	free(runtime.label[i]);
     diffmanager_delete(runtime.diffmanager);
+    iolimit_delete(runtime.iolimit);
+    if (config.mask)
+	mask_delete(config.mask);
 
 
     return 0;
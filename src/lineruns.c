@@ -0,0 +1,287 @@
+/*
+ * lineruns.c
+ *
+ *  Created on: 18.10.2026
+ *      Author: jh
+ */
+
+/*
+    Line numbers stored as runs of consecutive lines
+
+    Copyright (C) 2017  Jörg Habenicht (jh@mwerk.net)
+
+    This file is part of lfdiff
+
+    lfdiff is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    lfdiff is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#include "lineruns.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#define LINERUNS_INITIAL_CAPACITY	64
+
+
+struct lineruns_s *lineruns_new(void) {
+    struct lineruns_s *runs = calloc(1, sizeof(*runs));
+    assert(runs);
+    runs->capacity = LINERUNS_INITIAL_CAPACITY;
+    runs->first = malloc(runs->capacity * sizeof(*runs->first));
+    runs->last = malloc(runs->capacity * sizeof(*runs->last));
+    runs->node = malloc(runs->capacity * sizeof(*runs->node));
+    assert(runs->first && runs->last && runs->node);
+    runs->gapend = runs->capacity;
+
+    return runs;
+}
+
+void lineruns_delete(struct lineruns_s *runs) {
+    assert(runs);
+
+    free(runs->first);
+    free(runs->last);
+    free(runs->node);
+    free(runs);
+}
+
+size_t lineruns_count(const struct lineruns_s *runs) {
+    assert(runs);
+
+    return runs->capacity - runs->start - (runs->gapend - runs->gapstart);
+}
+
+/* array index of run i */
+static inline size_t lineruns_index(const struct lineruns_s *runs, size_t i) {
+    const size_t index = runs->start + i;
+    return index < runs->gapstart? index: index + (runs->gapend - runs->gapstart);
+}
+
+/* number of the last run starting at or before line n, -1 if there is none */
+static long lineruns_search(const struct lineruns_s *runs, int64_t n) {
+    const size_t before = runs->gapstart - runs->start;	// runs in front of the gap
+    size_t lo = 0;
+    size_t hi = lineruns_count(runs);
+
+    // most lookups are next to the last change
+    if (before && runs->first[runs->gapstart-1] <= n) {
+	if (runs->gapend == runs->capacity || runs->first[runs->gapend] > n)
+	    return before - 1;
+	lo = before;
+    }
+    else if (before)
+	hi = before - 1;
+
+    while (lo < hi) {
+	const size_t mid = lo + (hi - lo) / 2;
+	if (runs->first[lineruns_index(runs, mid)] <= n)
+	    lo = mid + 1;
+	else
+	    hi = mid;
+    }
+
+    return (long) lo - 1;
+}
+
+/* move the gap in front of run i */
+static void lineruns_move_gap(struct lineruns_s *runs, size_t i) {
+    const size_t index = runs->start + i;
+
+    if (index < runs->gapstart) {
+	const size_t count = runs->gapstart - index;
+	runs->gapend -= count;
+	memmove(&runs->first[runs->gapend], &runs->first[index], count * sizeof(*runs->first));
+	memmove(&runs->last[runs->gapend], &runs->last[index], count * sizeof(*runs->last));
+	memmove(&runs->node[runs->gapend], &runs->node[index], count * sizeof(*runs->node));
+    }
+    else if (index > runs->gapstart) {
+	const size_t count = index - runs->gapstart;
+	memmove(&runs->first[runs->gapstart], &runs->first[runs->gapend], count * sizeof(*runs->first));
+	memmove(&runs->last[runs->gapstart], &runs->last[runs->gapend], count * sizeof(*runs->last));
+	memmove(&runs->node[runs->gapstart], &runs->node[runs->gapend], count * sizeof(*runs->node));
+	runs->gapend += count;
+    }
+    runs->gapstart = index;
+}
+
+/* insert run from first to last in front of run i */
+static void lineruns_insert(struct lineruns_s *runs, size_t i, int64_t first, int64_t last, void *node) {
+    lineruns_move_gap(runs, i);
+    if (runs->gapstart == runs->gapend && runs->start >= runs->capacity / 4) {
+	// full, take the space of the runs dropped from the front
+	const size_t before = runs->gapstart - runs->start;
+	memmove(&runs->first[0], &runs->first[runs->start], before * sizeof(*runs->first));
+	memmove(&runs->last[0], &runs->last[runs->start], before * sizeof(*runs->last));
+	memmove(&runs->node[0], &runs->node[runs->start], before * sizeof(*runs->node));
+	runs->gapstart = before;
+	runs->start = 0;
+    }
+    else if (runs->gapstart == runs->gapend) {
+	// full, double the capacity. The gap stays at i.
+	const size_t tail = runs->capacity - runs->gapend;
+	const size_t capacity = 2 * runs->capacity;
+	runs->first = realloc(runs->first, capacity * sizeof(*runs->first));
+	runs->last = realloc(runs->last, capacity * sizeof(*runs->last));
+	runs->node = realloc(runs->node, capacity * sizeof(*runs->node));
+	assert(runs->first && runs->last && runs->node);
+	memmove(&runs->first[capacity - tail], &runs->first[runs->gapend], tail * sizeof(*runs->first));
+	memmove(&runs->last[capacity - tail], &runs->last[runs->gapend], tail * sizeof(*runs->last));
+	memmove(&runs->node[capacity - tail], &runs->node[runs->gapend], tail * sizeof(*runs->node));
+	runs->gapend = capacity - tail;
+	runs->capacity = capacity;
+    }
+    runs->first[runs->gapstart] = first;
+    runs->last[runs->gapstart] = last;
+    runs->node[runs->gapstart] = node;
+    runs->gapstart++;
+}
+
+/* remove run i */
+static void lineruns_erase(struct lineruns_s *runs, size_t i) {
+    if (!i && runs->gapstart != runs->start) {
+	runs->start++;
+	return;
+    }
+    lineruns_move_gap(runs, i);
+    runs->gapend++;
+}
+
+void lineruns_add(struct lineruns_s *runs, int64_t n, void *node) {
+    assert(runs);
+
+    const long i = lineruns_search(runs, n);
+    const size_t count = lineruns_count(runs);
+    const size_t prev = i >= 0? lineruns_index(runs, i): 0;
+    const size_t next = (size_t) (i + 1) < count? lineruns_index(runs, i + 1): 0;
+    const int joinprev = i >= 0 && runs->last[prev] + 1 == n;
+    const int joinnext = (size_t) (i + 1) < count && runs->first[next] - 1 == n;
+
+    assert(i < 0 || runs->last[prev] < n);	// line is stored already
+
+    if (joinprev && joinnext) {
+	runs->last[prev] = runs->last[next];
+	lineruns_erase(runs, i + 1);
+    }
+    else if (joinprev)
+	runs->last[prev] = n;
+    else if (joinnext) {
+	runs->first[next] = n;
+	runs->node[next] = node;
+    }
+    else
+	lineruns_insert(runs, i + 1, n, n, node);
+}
+
+void lineruns_remove(struct lineruns_s *runs, int64_t n, void *nextnode) {
+    assert(runs);
+
+    const long i = lineruns_search(runs, n);
+    if (i < 0)
+	return;
+
+    const size_t run = lineruns_index(runs, i);
+    const int64_t first = runs->first[run];
+    const int64_t last = runs->last[run];
+    if (last < n)
+	return;
+
+    if (first == last)
+	lineruns_erase(runs, i);
+    else if (first == n) {
+	runs->first[run] = n + 1;
+	runs->node[run] = nextnode;
+    }
+    else if (last == n)
+	runs->last[run] = n - 1;
+    else {
+	// split the run
+	runs->last[run] = n - 1;
+	lineruns_insert(runs, i + 1, n + 1, last, nextnode);
+    }
+}
+
+void lineruns_truncate(struct lineruns_s *runs, int64_t n, void *nextnode) {
+    assert(runs);
+
+    const long i = lineruns_search(runs, n);
+    if (i < 0)
+	return;
+
+    // runs to remove
+    size_t count = i + 1;
+    const size_t run = lineruns_index(runs, i);
+    if (runs->last[run] > n) {
+	runs->first[run] = n + 1;
+	runs->node[run] = nextnode;
+	count = i;
+    }
+
+    // the runs to remove must be in front of the gap
+    if (runs->gapstart - runs->start < count)
+	lineruns_move_gap(runs, count);
+    runs->start += count;
+}
+
+int lineruns_find(const struct lineruns_s *runs, int64_t n, int64_t *first, int64_t *last) {
+    assert(runs);
+
+    const long i = lineruns_search(runs, n);
+    if (i < 0)
+	return 0;
+
+    const size_t run = lineruns_index(runs, i);
+    if (runs->last[run] < n)
+	return 0;
+
+    if (first)
+	*first = runs->first[run];
+    if (last)
+	*last = runs->last[run];
+    return 1;
+}
+
+void *lineruns_find_node(const struct lineruns_s *runs, int64_t n, int64_t *first) {
+    assert(runs);
+
+    const long i = lineruns_search(runs, n);
+    if (i < 0)
+	return NULL;
+
+    const size_t run = lineruns_index(runs, i);
+    if (runs->last[run] < n)
+	return NULL;
+
+    if (first)
+	*first = runs->first[run];
+    return runs->node[run];
+}
+
+int lineruns_next(const struct lineruns_s *runs, int64_t n, int64_t *next) {
+    assert(runs);
+    assert(next);
+
+    const long i = lineruns_search(runs, n);
+    if (i >= 0 && runs->last[lineruns_index(runs, i)] >= n) {
+	*next = n;
+	return 1;
+    }
+    if ((size_t) (i + 1) < lineruns_count(runs)) {
+	*next = runs->first[lineruns_index(runs, i + 1)];
+	return 1;
+    }
+    return 0;
+}
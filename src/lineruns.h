@@ -0,0 +1,106 @@
+/*
+ * lineruns.h
+ *
+ *  Created on: 18.10.2026
+ *      Author: jh
+ */
+
+/*
+    Line numbers stored as runs of consecutive lines
+
+    Copyright (C) 2017  Jörg Habenicht (jh@mwerk.net)
+
+    This file is part of lfdiff
+
+    lfdiff is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    lfdiff is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#ifndef SRC_ANSIC_LINERUNS_H_
+#define SRC_ANSIC_LINERUNS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+/* sorted set of line numbers, stored as runs of consecutive lines.
+ * The first and last line of every run are kept in two dense arrays, apart
+ * from the text of the lines. A third array keeps a pointer given by the
+ * caller to the node of the first line of every run. The arrays have a gap at the run changed last,
+ * so adding and removing lines in ascending order moves no memory. Runs
+ * dropped from the front just advance start.
+ */
+struct lineruns_s {
+    int64_t *first;	// first line of run
+    int64_t *last;	// last line of run
+    void **node;	// node of the first line of run
+    size_t capacity;	// runs allocated in first and last
+    size_t start;	// index of the first run
+    size_t gapstart;	// index of the first unused entry
+    size_t gapend;	// index of the first used entry after the gap
+};
+
+
+struct lineruns_s *lineruns_new(void);
+void lineruns_delete(struct lineruns_s *runs);
+
+/** number of runs */
+size_t lineruns_count(const struct lineruns_s *runs);
+
+/** add line n, must not be stored already.
+ * node is the node of line n, kept if n starts a run.
+ */
+void lineruns_add(struct lineruns_s *runs, int64_t n, void *node);
+
+/** remove line n if it is stored.
+ * nextnode is the node of line n+1, kept if n+1 starts a run now.
+ */
+void lineruns_remove(struct lineruns_s *runs, int64_t n, void *nextnode);
+
+/** remove all lines up to and including line n.
+ * Takes time in the number of runs removed. nextnode is the node of line
+ * n+1, kept if n+1 starts a run now.
+ */
+void lineruns_truncate(struct lineruns_s *runs, int64_t n, void *nextnode);
+
+/** get the run holding line n.
+ *
+ * @param runs: the set of lines
+ * @param n: line number
+ * @param first: set to first line of run if not NULL
+ * @param last: set to last line of run if not NULL
+ * @return 1 if line n is stored, 0 if not
+ */
+int lineruns_find(const struct lineruns_s *runs, int64_t n, int64_t *first, int64_t *last);
+
+/** get the node of the first line of the run holding line n.
+ *
+ * @param runs: the set of lines
+ * @param n: line number
+ * @param first: set to first line of run if not NULL
+ * @return the node, NULL if line n is not stored
+ */
+void *lineruns_find_node(const struct lineruns_s *runs, int64_t n, int64_t *first);
+
+/** get the first stored line at or after line n.
+ *
+ * @param runs: the set of lines
+ * @param n: line number
+ * @param next: set to the line found
+ * @return 1 if a line has been found, 0 if no line >= n is stored
+ */
+int lineruns_next(const struct lineruns_s *runs, int64_t n, int64_t *next);
+
+#endif /* SRC_ANSIC_LINERUNS_H_ */
@@ -0,0 +1,233 @@
+/*
+ * longline.c
+ *
+ *  Created on: 18.10.2026
+ *      Author: jh
+ */
+
+/*
+    Spill file for lines too long to keep in memory
+
+    Copyright (C) 2017  Jörg Habenicht (jh@mwerk.net)
+
+    This file is part of lfdiff
+
+    lfdiff is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    lfdiff is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#include "longline.h"
+#include "hash.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <unistd.h>
+#include <inttypes.h>
+
+#define MIN(a,b)	((a)<(b)?(a):(b))
+
+#define LONGLINE_PREFIX	"\033longline "
+// seeds of the two hashes identifying a long line
+#define LONGLINE_SEED0	0
+#define LONGLINE_SEED1	0x6c6f6e676c696e65ull
+
+
+struct longline_s *longline_new(void) {
+    struct longline_s *longline = calloc(1, sizeof(*longline));
+    assert(longline);
+
+    pthread_mutex_init(&longline->mutex, NULL);
+
+    return longline;
+}
+
+void longline_delete(struct longline_s *longline) {
+    assert(longline);
+
+    int i;
+    for (i=0; i<LONGLINE_BUCKETS; i++) {
+	struct longline_entry_s *entry;
+	while ((entry = longline->bucket[i])) {
+	    longline->bucket[i] = entry->next;
+	    free(entry);
+	}
+    }
+    pthread_mutex_destroy(&longline->mutex);
+    if (longline->spill)
+	fclose(longline->spill);
+    free(longline);
+}
+
+void longline_begin(struct longline_s *longline) {
+    assert(longline);
+
+    // create the file on the first long line only
+    if (!longline->spill) {
+	longline->spill = tmpfile();
+	if (!longline->spill) {
+	    fprintf(stderr, "error: can not create temporary file: %s\n", strerror(errno));
+	    abort();
+	}
+    }
+
+    memset(&longline->current, 0, sizeof(longline->current));
+    longline->current.offset = longline->size;
+    longline->current.hash[0] = LONGLINE_SEED0;
+    longline->current.hash[1] = LONGLINE_SEED1;
+    longline->buffered = 0;
+}
+
+/* hash the buffered block and write it to the spill file */
+static void longline_flush(struct longline_s *longline) {
+
+    const char *data = longline->buffer;
+    size_t len = longline->buffered;
+    longline->current.hash[0] = hash_bytes(data, len, longline->current.hash[0]);
+    longline->current.hash[1] = hash_bytes(data, len, longline->current.hash[1]);
+
+    while (len) {
+	ssize_t retval = pwrite(fileno(longline->spill), data, len, longline->size);
+	if (0 > retval) {
+	    if (EINTR == errno)
+		continue;
+	    fprintf(stderr, "error: writing to temporary file: %s\n", strerror(errno));
+	    abort();
+	}
+	data += retval;
+	len -= retval;
+	longline->size += retval;
+    }
+    longline->buffered = 0;
+}
+
+void longline_append(struct longline_s *longline, const char *data, size_t len) {
+    assert(longline);
+    assert(data || !len);
+
+    longline->current.len += len;
+    while (len) {
+	const size_t n = MIN(len, sizeof(longline->buffer) - longline->buffered);
+	memcpy(longline->buffer + longline->buffered, data, n);
+	longline->buffered += n;
+	data += n;
+	len -= n;
+	if (longline->buffered == sizeof(longline->buffer))
+	    longline_flush(longline);
+    }
+}
+
+size_t longline_end(struct longline_s *longline, char *placeholder) {
+    assert(longline);
+    assert(placeholder);
+
+    if (longline->buffered)
+	longline_flush(longline);
+
+    struct longline_entry_s *entry = malloc(sizeof(*entry));
+    assert(entry);
+    *entry = longline->current;
+
+    pthread_mutex_lock(&longline->mutex);
+    struct longline_entry_s **bucket = &longline->bucket[entry->hash[0] % LONGLINE_BUCKETS];
+    entry->next = *bucket;
+    *bucket = entry;
+    longline->count++;
+    pthread_mutex_unlock(&longline->mutex);
+
+    int retval = snprintf(placeholder, LONGLINE_PLACEHOLDER_LEN, LONGLINE_PREFIX "%zu %016" PRIx64 "%016" PRIx64 "\n",
+	    entry->len, entry->hash[0], entry->hash[1]);
+    assert(retval > 0 && retval < LONGLINE_PLACEHOLDER_LEN);
+
+    return retval;
+}
+
+int longline_is_placeholder(const char *line, size_t len) {
+    assert(line || !len);
+
+    return len > sizeof(LONGLINE_PREFIX) - 1 && !memcmp(line, LONGLINE_PREFIX, sizeof(LONGLINE_PREFIX) - 1);
+}
+
+size_t longline_length(const char *line, size_t len) {
+
+    if (!longline_is_placeholder(line, len) || len >= LONGLINE_PLACEHOLDER_LEN)
+	return 0;
+
+    // the line may not be NUL terminated
+    char placeholder[LONGLINE_PLACEHOLDER_LEN];
+    memcpy(placeholder, line, len);
+    placeholder[len] = '\0';
+
+    size_t longlen;
+    if (1 != sscanf(placeholder + sizeof(LONGLINE_PREFIX) - 1, "%zu ", &longlen))
+	return 0;
+    return longlen;
+}
+
+int longline_write(struct longline_s *longline, const char *line, size_t linelen, FILE *output) {
+    assert(line);
+    assert(output);
+
+    if (!longline || !longline_is_placeholder(line, linelen) || linelen >= LONGLINE_PLACEHOLDER_LEN)
+	return 0;
+
+    // the line may not be NUL terminated
+    char placeholder[LONGLINE_PLACEHOLDER_LEN];
+    memcpy(placeholder, line, linelen);
+    placeholder[linelen] = '\0';
+
+    size_t len;
+    uint64_t hash[2];
+    if (3 != sscanf(placeholder + sizeof(LONGLINE_PREFIX) - 1, "%zu %16" SCNx64 "%16" SCNx64, &len, &hash[0], &hash[1]))
+	return 0;
+
+    // equal hashes mean equal content, any copy of the line will do
+    struct longline_entry_s *entry;
+    pthread_mutex_lock(&longline->mutex);
+    for (entry = longline->bucket[hash[0] % LONGLINE_BUCKETS]; entry; entry = entry->next)
+	if (entry->hash[0] == hash[0] && entry->hash[1] == hash[1] && entry->len == len)
+	    break;
+    pthread_mutex_unlock(&longline->mutex);
+    if (!entry)
+	return 0;
+
+    char *buffer = malloc(LONGLINE_BLOCKSIZE);
+    assert(buffer);
+    off_t offset = entry->offset;
+    char last = '\n';
+    while (len) {
+	ssize_t retval = pread(fileno(longline->spill), buffer, MIN(len, LONGLINE_BLOCKSIZE), offset);
+	if (0 >= retval) {
+	    if (0 > retval && EINTR == errno)
+		continue;
+	    fprintf(stderr, "error: reading from temporary file: %s\n", retval? strerror(errno): "unexpected end of file");
+	    abort();
+	}
+	if ((size_t) retval != fwrite(buffer, 1, retval, output)) {
+	    fprintf(stderr, "error: writing to output: %s\n", strerror(errno));
+	    abort();
+	}
+	offset += retval;
+	len -= retval;
+	last = buffer[retval - 1];
+    }
+    free(buffer);
+    // the last line of a file may miss it, keep the diff format intact
+    if ('\n' != last)
+	fputc('\n', output);
+
+    return 1;
+}
@@ -0,0 +1,104 @@
+/*
+ * longline.h
+ *
+ *  Created on: 18.10.2026
+ *      Author: jh
+ */
+
+/*
+    Spill file for lines too long to keep in memory
+
+    Copyright (C) 2017  Jörg Habenicht (jh@mwerk.net)
+
+    This file is part of lfdiff
+
+    lfdiff is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    lfdiff is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#ifndef SRC_ANSIC_LONGLINE_H_
+#define SRC_ANSIC_LONGLINE_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <pthread.h>
+
+// long lines are hashed in blocks of this size, independent of the reads
+#define LONGLINE_BLOCKSIZE	(64*1024)
+// max length of a placeholder line, see longline_end()
+#define LONGLINE_PLACEHOLDER_LEN	64
+#define LONGLINE_BUCKETS	256
+
+struct longline_entry_s {
+    struct longline_entry_s *next;	// next entry in bucket
+    uint64_t hash[2];
+    off_t offset;	// position of line in spill file
+    size_t len;		// length of line including newline character
+};
+
+/* The lines are written to the spill file by one thread and looked up by
+ * another one. The table is protected by mutex, the line being written is
+ * only accessed by the writing thread.
+ */
+struct longline_s {
+    FILE *spill;	// temporary file holding the long lines, NULL if none yet
+    off_t size;		// bytes written to spill file
+    pthread_mutex_t mutex;
+    struct longline_entry_s *bucket[LONGLINE_BUCKETS];
+    long count;		// number of lines in spill file
+
+    /* line being written */
+    struct longline_entry_s current;
+    size_t buffered;	// bytes in buffer
+    char buffer[LONGLINE_BLOCKSIZE];
+};
+
+
+struct longline_s *longline_new(void);
+void longline_delete(struct longline_s *longline);
+
+/** start writing a long line to the spill file. */
+void longline_begin(struct longline_s *longline);
+
+/** append the next part of the line. */
+void longline_append(struct longline_s *longline, const char *data, size_t len);
+
+/** finish the line and make it available to longline_write().
+ * @param placeholder: buffer of LONGLINE_PLACEHOLDER_LEN bytes, returns a
+ *   line standing in for the long line. Equal long lines get equal
+ *   placeholders.
+ * @return: length of placeholder line
+ */
+size_t longline_end(struct longline_s *longline, char *placeholder);
+
+/** test whether line is a placeholder written by longline_end(). */
+int longline_is_placeholder(const char *line, size_t len);
+
+/** get the length of the long line a placeholder stands for.
+ * @return: length including the newline character, 0 if line is no placeholder
+ */
+size_t longline_length(const char *line, size_t len);
+
+/** write the long line a placeholder stands for.
+ * @param longline: spill file, may be NULL
+ * @param line: placeholder or any other line
+ * @param linelen: length of line
+ * @return: 1 if the long line has been written, 0 if line is no known
+ *   placeholder. Nothing is written in that case.
+ */
+int longline_write(struct longline_s *longline, const char *line, size_t linelen, FILE *output);
+
+#endif /* SRC_ANSIC_LONGLINE_H_ */
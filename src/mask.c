@@ -0,0 +1,198 @@
+/*
+ * mask.c
+ *
+ *  Created on: 18.10.2026
+ *      Author: jh
+ */
+
+/*
+    Mask regions of lines which are not compared, e.g. time stamps
+
+    Copyright (C) 2017  Jörg Habenicht (jh@mwerk.net)
+
+    This file is part of lfdiff
+
+    lfdiff is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    lfdiff is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "mask.h"
+#include "hash.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+// size of buffer on stack to mask short lines
+#define MASK_STACKBUFFER_LEN	256
+
+
+struct mask_s *mask_new(void) {
+    struct mask_s *mask = calloc(1, sizeof(*mask));
+    assert(mask);
+
+    return mask;
+}
+
+void mask_delete(struct mask_s *mask) {
+    assert(mask);
+
+    if (mask->compiled)
+	regfree(&mask->regex);
+    free(mask->pattern);
+    free(mask);
+}
+
+void mask_add(struct mask_s *mask, const char *pattern) {
+    assert(mask);
+    assert(pattern);
+    assert(!mask->compiled);
+
+    // "(a)" for the first, "(a)|(b)" for the following patterns
+    const size_t oldlen = mask->pattern? strlen(mask->pattern): 0;
+    const size_t len = oldlen + strlen(pattern) + sizeof("|()");
+    mask->pattern = realloc(mask->pattern, len);
+    assert(mask->pattern);
+    snprintf(mask->pattern + oldlen, len - oldlen, "%s(%s)", oldlen? "|": "", pattern);
+    mask->count++;
+}
+
+int mask_compile(struct mask_s *mask) {
+    assert(mask);
+    assert(mask->pattern);
+
+    int retval = regcomp(&mask->regex, mask->pattern, REG_EXTENDED);
+    if (!retval)
+	mask->compiled = 1;
+
+    return retval;
+}
+
+/* search the pattern in line[so..eo[.
+ * @return: 1 if found, match set to the found region
+ */
+static int mask_search(const struct mask_s *mask, const char *line, size_t so, size_t eo, int eflags, regmatch_t *match) {
+
+#ifdef REG_STARTEND
+    match->rm_so = so;
+    match->rm_eo = eo;
+    return !regexec(&mask->regex, line, 1, match, eflags | REG_STARTEND);
+#else
+    // regexec() needs a NUL terminated string
+    char *buffer = strndup(line + so, eo - so);
+    assert(buffer);
+    const int found = !regexec(&mask->regex, buffer, 1, match, eflags);
+    free(buffer);
+    if (found) {
+	match->rm_so += so;
+	match->rm_eo += so;
+    }
+    return found;
+#endif
+}
+
+size_t mask_apply(const struct mask_s *mask, const char *data, size_t len, char *out) {
+    assert(data || !len);
+    assert(out || !len);
+
+    if (!mask) {
+	memcpy(out, data, len);
+	return len;
+    }
+    assert(mask->compiled);
+
+    const char *line = data;
+    const char * const end = data + len;
+    char *o = out;
+
+    while (line < end) {
+	const char *newline = memchr(line, '\n', end - line);
+	const size_t linelen = (newline? newline: end) - line;
+	size_t pos = 0;
+	int eflags = 0;
+	regmatch_t match;
+
+	while (pos < linelen && mask_search(mask, line, pos, linelen, eflags, &match)) {
+	    // copy the unmasked text in front of the match
+	    memcpy(o, line + pos, match.rm_so - pos);
+	    o += match.rm_so - pos;
+	    if (match.rm_eo > match.rm_so) {
+		*o++ = MASK_CHAR;
+		pos = match.rm_eo;
+	    }
+	    else if ((size_t) match.rm_so < linelen) {
+		// empty match, step over one character
+		*o++ = line[match.rm_so];
+		pos = match.rm_so + 1;
+	    }
+	    else {
+		// empty match at the end of line
+		pos = linelen;
+		break;
+	    }
+	    eflags = REG_NOTBOL;
+	}
+	memcpy(o, line + pos, linelen - pos);
+	o += linelen - pos;
+
+	if (!newline)
+	    break;
+	*o++ = '\n';
+	line = newline + 1;
+    }
+
+    return o - out;
+}
+
+uint64_t mask_hash_lines(const struct mask_s *mask, const char *data, size_t len, int flags) {
+
+    if (!mask)
+	return hash_lines(data, len, flags);
+
+    char stackbuffer[MASK_STACKBUFFER_LEN];
+    char *buffer = len <= sizeof(stackbuffer)? stackbuffer: malloc(len);
+    assert(buffer);
+
+    const size_t masklen = mask_apply(mask, data, len, buffer);
+    const uint64_t hash = hash_lines(buffer, masklen, flags);
+
+    if (buffer != stackbuffer)
+	free(buffer);
+
+    return hash;
+}
+
+int mask_lines_equal(const struct mask_s *mask, const char *a, size_t lena, const char *b, size_t lenb, int flags) {
+
+    if (!mask)
+	return hash_lines_equal(a, lena, b, lenb, flags);
+
+    char stackbuffer[2][MASK_STACKBUFFER_LEN];
+    char *buffera = lena <= sizeof(stackbuffer[0])? stackbuffer[0]: malloc(lena);
+    char *bufferb = lenb <= sizeof(stackbuffer[1])? stackbuffer[1]: malloc(lenb);
+    assert(buffera);
+    assert(bufferb);
+
+    const size_t masklena = mask_apply(mask, a, lena, buffera);
+    const size_t masklenb = mask_apply(mask, b, lenb, bufferb);
+    const int equal = hash_lines_equal(buffera, masklena, bufferb, masklenb, flags);
+
+    if (buffera != stackbuffer[0])
+	free(buffera);
+    if (bufferb != stackbuffer[1])
+	free(bufferb);
+
+    return equal;
+}
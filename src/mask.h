@@ -0,0 +1,84 @@
+/*
+ * mask.h
+ *
+ *  Created on: 18.10.2026
+ *      Author: jh
+ */
+
+/*
+    Mask regions of lines which are not compared, e.g. time stamps
+
+    Copyright (C) 2017  Jörg Habenicht (jh@mwerk.net)
+
+    This file is part of lfdiff
+
+    lfdiff is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    lfdiff is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef SRC_ANSIC_MASK_H_
+#define SRC_ANSIC_MASK_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <regex.h>
+
+
+/* character replacing a masked region of a line */
+#define MASK_CHAR	'\032'
+
+struct mask_s {
+    char *pattern;	// all patterns combined into one alternation
+    int count;		// number of patterns
+    int compiled;
+    regex_t regex;
+};
+
+
+struct mask_s *mask_new(void);
+void mask_delete(struct mask_s *mask);
+
+/** add an extended regular expression to mask.
+ * Must be called before mask_compile().
+ */
+void mask_add(struct mask_s *mask, const char *pattern);
+
+/** compile all patterns into one regular expression.
+ * @return: 0 on success, else error code of regcomp()
+ */
+int mask_compile(struct mask_s *mask);
+
+/** replace every match of the patterns by MASK_CHAR.
+ * The patterns are applied to every line on its own, the newline character
+ * is never masked. The result never gets longer than the input.
+ *
+ * @param mask: compiled mask, NULL to copy the data as is
+ * @param data: one or more lines
+ * @param len: length of data in bytes
+ * @param out: buffer of at least len bytes for the masked lines
+ * @return: length of masked lines
+ */
+size_t mask_apply(const struct mask_s *mask, const char *data, size_t len, char *out);
+
+/** hash one or more lines after masking them.
+ * see hash_lines()
+ */
+uint64_t mask_hash_lines(const struct mask_s *mask, const char *data, size_t len, int flags);
+
+/** compare lines after masking them.
+ * see hash_lines_equal()
+ */
+int mask_lines_equal(const struct mask_s *mask, const char *a, size_t lena, const char *b, size_t lenb, int flags);
+
+#endif /* SRC_ANSIC_MASK_H_ */
@@ -0,0 +1,154 @@
+/*
+ * mergediff.c
+ *
+ *  Created on: 18.10.2026
+ *      Author: jh
+ */
+
+/*
+    Streaming comparison of two sorted inputs
+
+    Copyright (C) 2017  Jörg Habenicht (jh@mwerk.net)
+
+    This file is part of lfdiff
+
+    lfdiff is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    lfdiff is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#define _GNU_SOURCE
+#include "mergediff.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <sys/types.h>
+
+
+struct mergediff_input_s {
+    FILE *file;
+    char *line;		// current line
+    size_t n;		// size of line buffer
+    ssize_t len;	// length of current line, -1 at end of input
+    char *previous;	// previous line to check the sort order
+    size_t previousn;	// size of previous line buffer
+    ssize_t previouslen;
+    long nr;		// line number of current line
+};
+
+/* compare two lines without the newline character in byte order */
+static int mergediff_linecmp(const char *a, ssize_t lena, const char *b, ssize_t lenb) {
+
+    if (lena && '\n' == a[lena-1])
+	lena--;
+    if (lenb && '\n' == b[lenb-1])
+	lenb--;
+
+    int retval = memcmp(a, b, lena < lenb? lena: lenb);
+    if (retval)
+	return retval;
+
+    return lena < lenb? -1: lena > lenb? 1: 0;
+}
+
+static void mergediff_next(struct mergediff_input_s *input, const char *name) {
+
+    // swap buffers, the current line becomes the previous line
+    char *line = input->previous;
+    size_t n = input->previousn;
+    input->previous = input->line;
+    input->previousn = input->n;
+    input->previouslen = input->len;
+    input->line = line;
+    input->n = n;
+
+    errno = 0;
+    input->len = getline(&input->line, &input->n, input->file);
+    if (0 > input->len) {
+	if (errno) {
+	    fprintf(stderr, "error: reading from input %s: %s\n", name, strerror(errno));
+	    abort();
+	}
+	return;
+    }
+    input->nr++;
+
+    if (0 < input->previouslen
+	    && 0 < mergediff_linecmp(input->previous, input->previouslen, input->line, input->len)) {
+	fprintf(stderr, "error: input %s is not sorted at line %ld\n", name, input->nr);
+	exit(EXIT_FAILURE);
+    }
+}
+
+static void mergediff_print_line(FILE *output, char prefix, const char *line, ssize_t len) {
+
+    fprintf(output, "%c ", prefix);
+    fwrite(line, 1, len, output);
+    if (!len || '\n' != line[len-1])
+	fprintf(output, "\n\\ No newline at end of file\n");
+}
+
+int mergediff_compare(FILE *inputA, FILE *inputB, FILE *output) {
+    assert(inputA);
+    assert(inputB);
+    assert(output);
+
+    struct mergediff_input_s a = { .file = inputA, .previouslen = -1 };
+    struct mergediff_input_s b = { .file = inputB, .previouslen = -1 };
+    int differ = 0;
+
+    mergediff_next(&a, "A");
+    mergediff_next(&b, "B");
+
+    while (0 <= a.len || 0 <= b.len) {
+	int cmp;
+	if (0 > a.len)
+	    cmp = 1;
+	else if (0 > b.len)
+	    cmp = -1;
+	else {
+	    cmp = mergediff_linecmp(a.line, a.len, b.line, b.len);
+	    // same content, but one line misses the newline at end of file
+	    if (!cmp && a.len != b.len)
+		cmp = -1;
+	}
+
+	if (!cmp) {
+	    mergediff_next(&a, "A");
+	    mergediff_next(&b, "B");
+	}
+	else if (0 > cmp) {
+	    // line deleted from A
+	    fprintf(output, "%ldd%ld\n", a.nr, b.nr - (0 <= b.len));
+	    mergediff_print_line(output, '<', a.line, a.len);
+	    mergediff_next(&a, "A");
+	    differ = 1;
+	}
+	else {
+	    // line added to B
+	    fprintf(output, "%lda%ld\n", a.nr - (0 <= a.len), b.nr);
+	    mergediff_print_line(output, '>', b.line, b.len);
+	    mergediff_next(&b, "B");
+	    differ = 1;
+	}
+    }
+
+    free(a.line);
+    free(a.previous);
+    free(b.line);
+    free(b.previous);
+
+    return differ;
+}
@@ -0,0 +1,50 @@
+/*
+ * mergediff.h
+ *
+ *  Created on: 18.10.2026
+ *      Author: jh
+ */
+
+/*
+    Streaming comparison of two sorted inputs
+
+    Copyright (C) 2017  Jörg Habenicht (jh@mwerk.net)
+
+    This file is part of lfdiff
+
+    lfdiff is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    lfdiff is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef SRC_ANSIC_MERGEDIFF_H_
+#define SRC_ANSIC_MERGEDIFF_H_
+
+#include <stdio.h>
+
+
+/** compare two inputs sorted in byte order with one merge pass.
+ * Equal lines advance both inputs, the smaller line is printed as deleted
+ * from A or added to B. Every differing line is printed as its own
+ * traditional diff hunk, so no line has to be kept in memory except the
+ * current and the previous line of each input.
+ * The program exits with an error message if an input is not sorted.
+ *
+ * @param inputA: sorted input A
+ * @param inputB: sorted input B
+ * @param output: stream to print the diff to
+ * @return: 0 if the inputs are equal, 1 if they differ
+ */
+int mergediff_compare(FILE *inputA, FILE *inputB, FILE *output);
+
+#endif /* SRC_ANSIC_MERGEDIFF_H_ */
@@ -0,0 +1,238 @@
+/*
+ * resources.c
+ *
+ *  Created on: 18.10.2026
+ *      Author: jh
+ */
+
+/*
+    Memory and CPU limits lfdiff runs with
+
+    Copyright (C) 2017  Jörg Habenicht (jh@mwerk.net)
+
+    This file is part of lfdiff
+
+    lfdiff is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    lfdiff is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+
+#define _GNU_SOURCE
+#include "resources.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sched.h>
+
+
+#define MIN(a,b)	((a)<(b)?(a):(b))
+#define MAX(a,b)	((a)>(b)?(a):(b))
+
+#define RESOURCES_CGROUP_ROOT	"/sys/fs/cgroup"
+
+static const long long int resources_min_splitsize = 16l*1024*1024;	// 16MB
+static const long long int resources_max_splitsize = 16l*1024*1024*1024;	// 16GB
+
+
+/* read the first line of file dir/name into buffer.
+ * @return: 0 on success, -1 if the file can not be read
+ */
+static int resources_read_line(const char *dir, const char *name, char *buffer, size_t len) {
+    char *path;
+    if (-1 == asprintf(&path, "%s/%s", dir, name)) {
+	fprintf(stderr, "error: can not print to string: %s\n", strerror(errno));
+	abort();
+    }
+    FILE *f = fopen(path, "r");
+    free(path);
+    if (!f)
+	return -1;
+    char *line = fgets(buffer, len, f);
+    fclose(f);
+
+    return line? 0: -1;
+}
+
+static void resources_limit_memory(struct resources_s *res, uint64_t limit) {
+    if (!res->memory || limit < res->memory) {
+	res->memory = limit;
+	res->memorylimited = 1;
+    }
+}
+
+/* quota and period in the same unit, quota < 0 for unlimited */
+static void resources_limit_cpus(struct resources_s *res, long long int quota, long long int period) {
+    if (quota <= 0 || period <= 0)
+	return;
+    const long cpus = MAX(1, (quota + period - 1) / period);
+    res->cpus = MIN(res->cpus, cpus);
+}
+
+
+void resources_read_cgroup2(struct resources_s *res, const char *dir) {
+    char buffer[64];
+    char *end;
+
+    if (!resources_read_line(dir, "memory.max", buffer, sizeof(buffer)) && strncmp(buffer, "max", 3)) {
+	unsigned long long int limit = strtoull(buffer, &end, 10);
+	if (end != buffer)
+	    resources_limit_memory(res, limit);
+    }
+
+    if (!resources_read_line(dir, "cpu.max", buffer, sizeof(buffer)) && strncmp(buffer, "max", 3)) {
+	long long int quota = strtoll(buffer, &end, 10);
+	long long int period = strtoll(end, NULL, 10);
+	resources_limit_cpus(res, quota, period);
+    }
+}
+
+/* cgroup v1 memory and cpu controller, no limit is a huge number or -1 */
+static void resources_read_cgroup1(struct resources_s *res, const char *memorydir, const char *cpudir) {
+    char buffer[64];
+
+    if (memorydir && !resources_read_line(memorydir, "memory.limit_in_bytes", buffer, sizeof(buffer))) {
+	unsigned long long int limit = strtoull(buffer, NULL, 10);
+	if (limit)
+	    resources_limit_memory(res, limit);
+    }
+
+    if (cpudir && !resources_read_line(cpudir, "cpu.cfs_quota_us", buffer, sizeof(buffer))) {
+	long long int quota = strtoll(buffer, NULL, 10);
+	if (!resources_read_line(cpudir, "cpu.cfs_period_us", buffer, sizeof(buffer)))
+	    resources_limit_cpus(res, quota, strtoll(buffer, NULL, 10));
+    }
+}
+
+/* directory of the cgroup path below the mount point of the hierarchy */
+static char *resources_cgroup_dir(const char *mount, const char *path) {
+    char *dir;
+    if (-1 == asprintf(&dir, "%s%s", mount, strcmp(path, "/")? path: "")) {
+	fprintf(stderr, "error: can not print to string: %s\n", strerror(errno));
+	abort();
+    }
+
+    return dir;
+}
+
+/* read the cgroups of the process from /proc/self/cgroup. A limit of v2 can
+ * be set on any parent cgroup, those are read up to the root. Without
+ * cgroup namespace the path is not found below the mount point, then the
+ * root is read only.
+ */
+static void resources_read_cgroups(struct resources_s *res) {
+    FILE *f = fopen("/proc/self/cgroup", "r");
+    if (!f)
+	return;
+
+    char *memorydir = NULL;
+    char *cpudir = NULL;
+    char *line = NULL;
+    size_t len = 0;
+    while (getline(&line, &len, f) > 0) {
+	// "hierarchy-ID:controller-list:cgroup-path"
+	line[strcspn(line, "\n")] = '\0';
+	char *controllers = strchr(line, ':');
+	char *path = controllers? strchr(++controllers, ':'): NULL;
+	if (!path)
+	    continue;
+	*path++ = '\0';
+
+	if (!*controllers) {
+	    char *dir = resources_cgroup_dir(RESOURCES_CGROUP_ROOT, path);
+	    if (access(dir, F_OK))
+		strcpy(dir, RESOURCES_CGROUP_ROOT);
+	    size_t dirlen = strlen(dir);
+	    for (;;) {
+		resources_read_cgroup2(res, dir);
+		if (dirlen <= strlen(RESOURCES_CGROUP_ROOT))
+		    break;
+		while (dirlen && '/' != dir[--dirlen])
+		    ;
+		dir[dirlen] = '\0';
+	    }
+	    free(dir);
+	    continue;
+	}
+
+	char *controller;
+	char *saveptr;
+	for (controller = strtok_r(controllers, ",", &saveptr); controller; controller = strtok_r(NULL, ",", &saveptr)) {
+	    char **dir = !strcmp(controller, "memory")? &memorydir: !strcmp(controller, "cpu")? &cpudir: NULL;
+	    if (!dir || *dir)
+		continue;
+	    char *mount = resources_cgroup_dir(RESOURCES_CGROUP_ROOT "/", controller);
+	    *dir = resources_cgroup_dir(mount, path);
+	    if (access(*dir, F_OK)) {
+		free(*dir);
+		*dir = mount;
+	    }
+	    else
+		free(mount);
+	}
+    }
+    free(line);
+    fclose(f);
+
+    resources_read_cgroup1(res, memorydir, cpudir);
+    free(memorydir);
+    free(cpudir);
+}
+
+
+void resources_detect(struct resources_s *res) {
+    memset(res, 0, sizeof(*res));
+
+    const long pages = sysconf(_SC_PHYS_PAGES);
+    const long pagesize = sysconf(_SC_PAGESIZE);
+    if (pages > 0 && pagesize > 0)
+	res->memory = (uint64_t) pages * pagesize;
+
+    res->cores = MAX(1, sysconf(_SC_NPROCESSORS_ONLN));
+    cpu_set_t set;
+    if (!sched_getaffinity(0, sizeof(set), &set))
+	res->cores = MAX(1, MIN(res->cores, CPU_COUNT(&set)));
+    res->cpus = res->cores;
+
+    resources_read_cgroups(res);
+}
+
+
+long long int resources_splitsize(const struct resources_s *res) {
+    if (!res->memory)
+	return 0;
+
+    long long int splitsize = resources_min_splitsize;
+    while (splitsize < resources_max_splitsize && (uint64_t) splitsize * 2 <= res->memory / 8)
+	splitsize *= 2;
+
+    return splitsize;
+}
+
+
+int resources_prefetch(const struct resources_s *res, size_t chunksize) {
+    long depth = MIN(64, MAX(4, 4 * res->cpus));
+    if (res->memory)
+	depth = MIN(depth, (long) (res->memory / 64 / 2 / chunksize));
+
+    return MAX(1, depth);
+}
+
+
+long resources_threads(const struct resources_s *res) {
+    return MAX(1, res->cpus);
+}
@@ -0,0 +1,75 @@
+/*
+ * resources.h
+ *
+ *  Created on: 18.10.2026
+ *      Author: jh
+ */
+
+/*
+    Memory and CPU limits lfdiff runs with
+
+    Copyright (C) 2017  Jörg Habenicht (jh@mwerk.net)
+
+    This file is part of lfdiff
+
+    lfdiff is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    lfdiff is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+
+#ifndef SRC_ANSIC_RESOURCES_H_
+#define SRC_ANSIC_RESOURCES_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+/* memory and cores lfdiff may use. The limits of the cgroup the process
+ * runs in are applied to the size of the host.
+ */
+struct resources_s {
+    uint64_t memory;	// bytes of memory, 0 if unknown
+    int memorylimited;	// memory limited by the cgroup
+    long cores;		// cores online and in the affinity mask
+    long cpus;		// cores usable by the cgroup cpu quota, rounded up
+};
+
+
+/** detect the resources of the host and of the cgroup of this process,
+ * cgroup v2 and v1.
+ */
+void resources_detect(struct resources_s *res);
+
+/** apply the limits memory.max and cpu.max of the cgroup v2 in directory
+ * dir to res. Missing files or "max" leave res as it is.
+ */
+void resources_read_cgroup2(struct resources_s *res, const char *dir);
+
+/** SPLITSIZE for the memory, 1/8 of it rounded down to a power of two, from
+ * 16MB to 16GB. Differing slices of both INPUT are held by "diff" and the
+ * differing lines by lfdiff.
+ * @return: 0 if the memory is unknown
+ */
+long long int resources_splitsize(const struct resources_s *res);
+
+/** chunks read ahead per input, 4 per usable core from 4 to 64, not more than
+ * 1/64 of the memory for both inputs.
+ */
+int resources_prefetch(const struct resources_s *res, size_t chunksize);
+
+/** threads for the comparison of --key buckets, one per usable core */
+long resources_threads(const struct resources_s *res);
+
+#endif /* SRC_ANSIC_RESOURCES_H_ */
@@ -0,0 +1,254 @@
+/*
+ * slicecache.c
+ *
+ *  Created on: 18.10.2026
+ *      Author: jh
+ */
+
+/*
+    Cache of the differences found between two slices of lfdiff
+
+    Copyright (C) 2017  Jörg Habenicht (jh@mwerk.net)
+
+    This file is part of lfdiff
+
+    lfdiff is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    lfdiff is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#define _GNU_SOURCE
+#include "slicecache.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+
+#define SLICECACHE_SUFFIX	".lfdslc"
+
+
+/* file name of the entry of key */
+static char *slicecache_path(const struct slicecache_s *cache, const uint64_t key[2]) {
+    char *path;
+    if (-1 == asprintf(&path, "%s/%016llx%016llx" SLICECACHE_SUFFIX, cache->dir,
+	    (unsigned long long) key[0], (unsigned long long) key[1])) {
+	fprintf(stderr, "error: can not print to string: %s\n", strerror(errno));
+	abort();
+    }
+
+    return path;
+}
+
+/* entry file found in the cache directory */
+struct slicecache_file_s {
+    char *name;
+    off_t size;
+    struct timespec mtime;
+};
+
+static int slicecache_compare_mtime(const void *a, const void *b) {
+    const struct slicecache_file_s *fileA = a;
+    const struct slicecache_file_s *fileB = b;
+
+    if (fileA->mtime.tv_sec != fileB->mtime.tv_sec)
+	return (fileA->mtime.tv_sec > fileB->mtime.tv_sec) - (fileA->mtime.tv_sec < fileB->mtime.tv_sec);
+    return (fileA->mtime.tv_nsec > fileB->mtime.tv_nsec) - (fileA->mtime.tv_nsec < fileB->mtime.tv_nsec);
+}
+
+/* list the entry files of the cache, sum up their size.
+ * @return: allocated array of count files
+ */
+static struct slicecache_file_s *slicecache_scan(struct slicecache_s *cache, size_t *count) {
+
+    DIR *dir = opendir(cache->dir);
+    if (!dir) {
+	fprintf(stderr, "error: can not open cache directory '%s': %s\n", cache->dir, strerror(errno));
+	exit(EXIT_FAILURE);
+    }
+
+    struct slicecache_file_s *files = NULL;
+    size_t size = 0;
+    struct dirent *entry;
+    *count = 0;
+    cache->size = 0;
+    while ((entry = readdir(dir))) {
+	const size_t len = strlen(entry->d_name);
+	struct stat st;
+	if (len < sizeof(SLICECACHE_SUFFIX)
+		|| strcmp(entry->d_name + len - sizeof(SLICECACHE_SUFFIX) + 1, SLICECACHE_SUFFIX)
+		|| fstatat(dirfd(dir), entry->d_name, &st, 0))
+	    continue;
+
+	if (*count == size) {
+	    size = size? 2 * size: 256;
+	    files = realloc(files, size * sizeof(*files));
+	    assert(files);
+	}
+	files[*count].name = strdup(entry->d_name);
+	assert(files[*count].name);
+	files[*count].size = st.st_size;
+	files[*count].mtime = st.st_mtim;
+	cache->size += st.st_size;
+	(*count)++;
+    }
+    closedir(dir);
+
+    return files;
+}
+
+/* remove the least recently used entries until the cache is down to 3/4
+ * of its limit, so this is not done again for each entry added */
+static void slicecache_evict(struct slicecache_s *cache) {
+
+    size_t count, i;
+    struct slicecache_file_s *files = slicecache_scan(cache, &count);
+    qsort(files, count, sizeof(*files), slicecache_compare_mtime);
+
+    const int fd = open(cache->dir, O_RDONLY | O_DIRECTORY);
+    for (i=0; i<count; i++) {
+	if (cache->size > cache->limit / 4 * 3 && -1 != fd && !unlinkat(fd, files[i].name, 0)) {
+	    cache->size -= files[i].size;
+	    cache->evicted++;
+	}
+	free(files[i].name);
+    }
+    if (-1 != fd)
+	close(fd);
+    free(files);
+}
+
+struct slicecache_s *slicecache_open(const char *dir, off_t limit) {
+    assert(dir);
+    assert(limit > 0);
+
+    struct slicecache_s *cache = calloc(1, sizeof(*cache));
+    assert(cache);
+    cache->dir = strdup(dir);
+    assert(cache->dir);
+    cache->limit = limit;
+
+    size_t count, i;
+    struct slicecache_file_s *files = slicecache_scan(cache, &count);
+    for (i=0; i<count; i++)
+	free(files[i].name);
+    free(files);
+    if (cache->size > cache->limit)
+	slicecache_evict(cache);
+
+    return cache;
+}
+
+void slicecache_close(struct slicecache_s *cache) {
+    assert(cache);
+
+    free(cache->dir);
+    free(cache);
+}
+
+int slicecache_get(struct slicecache_s *cache, const uint64_t key[2], const int64_t lines[2], struct slicecache_hunk_s **hunks, size_t *count) {
+    assert(cache);
+    assert(key);
+    assert(hunks);
+    assert(count);
+
+    char *path = slicecache_path(cache, key);
+    FILE *file = fopen(path, "r");
+    free(path);
+
+    struct slicecache_header_s header;
+    struct stat st;
+    *hunks = NULL;
+    *count = 0;
+    if (!file
+	    || 1 != fread(&header, sizeof(header), 1, file)
+	    || memcmp(header.magic, SLICECACHE_MAGIC, sizeof(header.magic))
+	    || header.key[0] != key[0] || header.key[1] != key[1]
+	    || header.lines[0] != lines[0] || header.lines[1] != lines[1]
+	    || fstat(fileno(file), &st)
+	    || (uint64_t) st.st_size != sizeof(header) + header.hunks * sizeof(**hunks)) {
+	if (file)
+	    fclose(file);
+	cache->misses++;
+	return 0;
+    }
+
+    if (header.hunks) {
+	*hunks = malloc(header.hunks * sizeof(**hunks));
+	assert(*hunks);
+	if (header.hunks != fread(*hunks, sizeof(**hunks), header.hunks, file)) {
+	    fprintf(stderr, "error: reading cache entry of '%s': %s\n", cache->dir, strerror(errno));
+	    abort();
+	}
+    }
+    *count = header.hunks;
+    // the entry is used again, evicted last
+    futimens(fileno(file), NULL);
+    fclose(file);
+    cache->hits++;
+
+    return 1;
+}
+
+void slicecache_put(struct slicecache_s *cache, const uint64_t key[2], const int64_t lines[2], const struct slicecache_hunk_s *hunks, size_t count) {
+    assert(cache);
+    assert(key);
+    assert(hunks || !count);
+
+    struct slicecache_header_s header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SLICECACHE_MAGIC, sizeof(header.magic));
+    header.key[0] = key[0];
+    header.key[1] = key[1];
+    header.lines[0] = lines[0];
+    header.lines[1] = lines[1];
+    header.hunks = count;
+
+    // write the entry next to it, the cache may be shared by other runs
+    char *path = slicecache_path(cache, key);
+    char *tmppath;
+    if (-1 == asprintf(&tmppath, "%s.XXXXXX", path)) {
+	fprintf(stderr, "error: can not print to string: %s\n", strerror(errno));
+	abort();
+    }
+    const int fd = mkstemp(tmppath);
+    if (-1 == fd) {
+	fprintf(stderr, "error: can not create cache entry '%s': %s\n", tmppath, strerror(errno));
+	abort();
+    }
+    FILE *file = fdopen(fd, "w");
+    assert(file);
+    if (1 != fwrite(&header, sizeof(header), 1, file)
+	    || count != fwrite(hunks, sizeof(*hunks), count, file)
+	    || fclose(file)) {
+	fprintf(stderr, "error: writing cache entry '%s': %s\n", tmppath, strerror(errno));
+	abort();
+    }
+    if (rename(tmppath, path)) {
+	fprintf(stderr, "error: writing cache entry '%s': %s\n", path, strerror(errno));
+	abort();
+    }
+    free(tmppath);
+    free(path);
+
+    cache->size += sizeof(header) + count * sizeof(*hunks);
+    if (cache->size > cache->limit)
+	slicecache_evict(cache);
+}
@@ -0,0 +1,93 @@
+/*
+ * slicecache.h
+ *
+ *  Created on: 18.10.2026
+ *      Author: jh
+ */
+
+/*
+    Cache of the differences found between two slices of lfdiff
+
+    Copyright (C) 2017  Jörg Habenicht (jh@mwerk.net)
+
+    This file is part of lfdiff
+
+    lfdiff is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    lfdiff is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+
+#ifndef SRC_ANSIC_SLICECACHE_H_
+#define SRC_ANSIC_SLICECACHE_H_
+
+#include <stdint.h>
+#include <sys/types.h>
+
+
+#define SLICECACHE_MAGIC	"LFDSLC1"
+
+/* lines first..last of slice A replaced by lines of slice B, counting from
+ * 1 in the slice. last = first - 1 if there are no lines.
+ */
+struct slicecache_hunk_s {
+    int64_t firstA;
+    int64_t lastA;
+    int64_t firstB;
+    int64_t lastB;
+};
+
+/* start of an entry file, followed by the hunks */
+struct slicecache_header_s {
+    char magic[8];
+    uint64_t key[2];	// hash of slice A and B and the options
+    int64_t lines[2];	// lines in slice A and B
+    uint64_t hunks;
+};
+
+/* The entries are kept in one file each, named by the key. A hit touches
+ * the file, the least recently used entries are removed when the files
+ * grow beyond the size limit.
+ */
+struct slicecache_s {
+    char *dir;
+    off_t size;		// bytes in entry files
+    off_t limit;	// max bytes in entry files
+    long hits;
+    long misses;
+    long evicted;	// entries removed
+};
+
+
+/** open the cache in directory dir.
+ * @param limit: max size of the entry files in bytes
+ */
+struct slicecache_s *slicecache_open(const char *dir, off_t limit);
+void slicecache_close(struct slicecache_s *cache);
+
+/** look up the hunks of a slice pair.
+ * @param key: hash of the content of slice A and B, including the options
+ * @param lines: lines in slice A and B
+ * @param hunks: returns the allocated hunks, NULL if there are none
+ * @param count: returns the number of hunks
+ * @return: 1 if found, else 0
+ */
+int slicecache_get(struct slicecache_s *cache, const uint64_t key[2], const int64_t lines[2], struct slicecache_hunk_s **hunks, size_t *count);
+
+/** store the hunks of a slice pair. Removes the least recently used entries
+ * if the cache grows beyond its limit.
+ */
+void slicecache_put(struct slicecache_s *cache, const uint64_t key[2], const int64_t lines[2], const struct slicecache_hunk_s *hunks, size_t count);
+
+#endif /* SRC_ANSIC_SLICECACHE_H_ */
@@ -0,0 +1,171 @@
+/*
+ * spscring.c
+ *
+ *  Created on: 18.10.2026
+ *      Author: jh
+ */
+
+/*
+    Lock-free single producer single consumer ring buffer
+
+    Copyright (C) 2017  Jörg Habenicht (jh@mwerk.net)
+
+    This file is part of lfdiff
+
+    lfdiff is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    lfdiff is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#include "spscring.h"
+#include "config.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <unistd.h>
+
+#ifdef HAVE_LINUX_FUTEX_H
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#else
+#include <sched.h>
+#endif
+
+
+/* sleep while *word is value */
+static void spscring_wait(uint32_t *word, uint32_t value) {
+#ifdef HAVE_LINUX_FUTEX_H
+    int retval = syscall(SYS_futex, word, FUTEX_WAIT_PRIVATE, value, NULL, NULL, 0);
+    if (-1 == retval && EAGAIN != errno && EINTR != errno) {
+	fprintf(stderr, "error: can not wait on futex: %s\n", strerror(errno));
+	abort();
+    }
+#else
+    sched_yield();
+#endif
+}
+
+/* increment *word and wake up the other side sleeping on it */
+static void spscring_wake(uint32_t *word) {
+    __atomic_add_fetch(word, 1, __ATOMIC_SEQ_CST);
+#ifdef HAVE_LINUX_FUTEX_H
+    syscall(SYS_futex, word, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+#endif
+}
+
+struct spscring_s *spscring_new(int depth) {
+    assert(depth > 0);
+
+    struct spscring_s *ring;
+    int retval = posix_memalign((void **) &ring, SPSCRING_CACHELINE, sizeof(*ring));
+    if (retval) {
+	fprintf(stderr, "error: can not allocate ring: %s\n", strerror(retval));
+	abort();
+    }
+    memset(ring, 0, sizeof(*ring));
+
+    uint32_t slots = 1;
+    while (slots < (uint32_t) depth)
+	slots <<= 1;
+    ring->slot = calloc(slots, sizeof(*ring->slot));
+    assert(ring->slot);
+    ring->mask = slots - 1;
+    ring->depth = depth;
+
+    return ring;
+}
+
+void spscring_delete(struct spscring_s *ring) {
+    assert(ring);
+
+    free(ring->slot);
+    free(ring);
+}
+
+int spscring_push(struct spscring_s *ring, void *item) {
+    assert(ring);
+
+    const uint32_t tail = ring->tail;
+
+    for (;;) {
+	if (__atomic_load_n(&ring->cancelled, __ATOMIC_ACQUIRE))
+	    return 0;
+	if (tail - __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) < ring->depth)
+	    break;
+
+	// full. Announce the wait, then check again to not miss a pop.
+	const uint32_t event = __atomic_load_n(&ring->producerevent, __ATOMIC_SEQ_CST);
+	__atomic_store_n(&ring->producerwaits, 1, __ATOMIC_SEQ_CST);
+	if (tail - __atomic_load_n(&ring->head, __ATOMIC_SEQ_CST) >= ring->depth
+		&& !__atomic_load_n(&ring->cancelled, __ATOMIC_SEQ_CST))
+	    spscring_wait(&ring->producerevent, event);
+	__atomic_store_n(&ring->producerwaits, 0, __ATOMIC_RELAXED);
+    }
+
+    ring->slot[tail & ring->mask] = item;
+    __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&ring->consumerwaits, __ATOMIC_SEQ_CST))
+	spscring_wake(&ring->consumerevent);
+
+    return 1;
+}
+
+void *spscring_pop(struct spscring_s *ring) {
+    assert(ring);
+
+    const uint32_t head = ring->head;
+
+    for (;;) {
+	if (head != __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE))
+	    break;
+	if (__atomic_load_n(&ring->closed, __ATOMIC_ACQUIRE)) {
+	    // the last items may have been pushed right before closing
+	    if (head != __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE))
+		break;
+	    return NULL;
+	}
+
+	// empty. Announce the wait, then check again to not miss a push.
+	const uint32_t event = __atomic_load_n(&ring->consumerevent, __ATOMIC_SEQ_CST);
+	__atomic_store_n(&ring->consumerwaits, 1, __ATOMIC_SEQ_CST);
+	if (head == __atomic_load_n(&ring->tail, __ATOMIC_SEQ_CST)
+		&& !__atomic_load_n(&ring->closed, __ATOMIC_SEQ_CST))
+	    spscring_wait(&ring->consumerevent, event);
+	__atomic_store_n(&ring->consumerwaits, 0, __ATOMIC_RELAXED);
+    }
+
+    void *item = ring->slot[head & ring->mask];
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&ring->producerwaits, __ATOMIC_SEQ_CST))
+	spscring_wake(&ring->producerevent);
+
+    return item;
+}
+
+void spscring_close(struct spscring_s *ring) {
+    assert(ring);
+
+    __atomic_store_n(&ring->closed, 1, __ATOMIC_SEQ_CST);
+    spscring_wake(&ring->consumerevent);
+}
+
+void spscring_cancel(struct spscring_s *ring) {
+    assert(ring);
+
+    __atomic_store_n(&ring->cancelled, 1, __ATOMIC_SEQ_CST);
+    spscring_wake(&ring->producerevent);
+}
@@ -0,0 +1,87 @@
+/*
+ * spscring.h
+ *
+ *  Created on: 18.10.2026
+ *      Author: jh
+ */
+
+/*
+    Lock-free single producer single consumer ring buffer
+
+    Copyright (C) 2017  Jörg Habenicht (jh@mwerk.net)
+
+    This file is part of lfdiff
+
+    lfdiff is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    lfdiff is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#ifndef SRC_ANSIC_SPSCRING_H_
+#define SRC_ANSIC_SPSCRING_H_
+
+#include <stdint.h>
+
+#define SPSCRING_CACHELINE	64
+
+
+/* The indices run freely and are masked on access. Every side writes only
+ * to its own cache line, so producer and consumer do not disturb each
+ * other while the ring is neither empty nor full.
+ * A side only sleeps in the kernel if the ring is empty or full. The other
+ * side wakes it up by incrementing its event counter.
+ */
+struct spscring_s {
+    /* written by the consumer */
+    uint32_t head __attribute__((aligned(SPSCRING_CACHELINE)));	// next slot to pop
+    uint32_t producerevent;	// futex, incremented to wake the producer
+    int producerwaits;
+    int cancelled;	// consumer stopped popping
+    /* written by the producer */
+    uint32_t tail __attribute__((aligned(SPSCRING_CACHELINE)));	// next slot to push
+    uint32_t consumerevent;	// futex, incremented to wake the consumer
+    int consumerwaits;
+    int closed;		// producer stopped pushing
+    /* read only */
+    void **slot __attribute__((aligned(SPSCRING_CACHELINE)));
+    uint32_t mask;	// number of slots - 1
+    uint32_t depth;	// max number of items in ring
+};
+
+
+/** create a ring for up to depth items. */
+struct spscring_s *spscring_new(int depth);
+void spscring_delete(struct spscring_s *ring);
+
+/** append an item to the ring, called by the producer only.
+ * Blocks while the ring is full.
+ * @return: 1 on success, 0 if the consumer cancelled the ring
+ */
+int spscring_push(struct spscring_s *ring, void *item);
+
+/** take the oldest item out of the ring, called by the consumer only.
+ * Blocks while the ring is empty.
+ * @return: item, NULL if the ring is empty and closed
+ */
+void *spscring_pop(struct spscring_s *ring);
+
+/** producer pushes no more items. Wakes up the consumer. */
+void spscring_close(struct spscring_s *ring);
+
+/** consumer pops no more items. Wakes up the producer. The remaining items
+ * can still be popped after spscring_close().
+ */
+void spscring_cancel(struct spscring_s *ring);
+
+#endif /* SRC_ANSIC_SPSCRING_H_ */
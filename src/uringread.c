@@ -0,0 +1,322 @@
+/*
+ * uringread.c
+ *
+ *  Created on: 18.10.2026
+ *      Author: jh
+ */
+
+/*
+    Asynchronous read ahead of regular files with io_uring
+
+    Copyright (C) 2017  Jörg Habenicht (jh@mwerk.net)
+
+    This file is part of lfdiff
+
+    lfdiff is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    lfdiff is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#include "uringread.h"
+#include "config.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#ifdef HAVE_LINUX_IO_URING_H
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+#define MIN(a,b)	((a)<(b)?(a):(b))
+#define MAX(a,b)	((a)>(b)?(a):(b))
+
+// alignment of the read buffers, allows O_DIRECT and page sized copies
+#define URINGREAD_ALIGNMENT	4096
+
+
+#ifdef HAVE_LINUX_IO_URING_H
+
+/* there is no liburing, call the kernel directly */
+static int uringread_setup(unsigned entries, struct io_uring_params *params) {
+    return syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int uringread_enter(int ringfd, unsigned submit, unsigned complete, unsigned flags) {
+    return syscall(__NR_io_uring_enter, ringfd, submit, complete, flags, NULL, 0);
+}
+
+static int uringread_register(int ringfd, unsigned opcode, void *args, unsigned nargs) {
+    return syscall(__NR_io_uring_register, ringfd, opcode, args, nargs);
+}
+
+/* submit the read of the remaining part of slot i */
+static void uringread_submit(struct uringread_s *reader, int i) {
+
+    struct uringread_slot_s *slot = &reader->slot[i];
+    const unsigned tail = *reader->sqtail;
+    const unsigned index = tail & *reader->sqmask;
+    struct io_uring_sqe *sqe = &((struct io_uring_sqe *) reader->sqes)[index];
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->fd = reader->fd;
+    sqe->off = slot->offset + slot->filled;
+    sqe->user_data = i;
+    if (reader->fixed) {
+	sqe->opcode = IORING_OP_READ_FIXED;
+	sqe->addr = (unsigned long) (slot->buffer + slot->filled);
+	sqe->len = reader->blocksize - slot->filled;
+	sqe->buf_index = i;
+    }
+    else {
+	// the iovec must stay valid until completion
+	slot->iov.iov_base = slot->buffer + slot->filled;
+	slot->iov.iov_len = reader->blocksize - slot->filled;
+	sqe->opcode = IORING_OP_READV;
+	sqe->addr = (unsigned long) &slot->iov;
+	sqe->len = 1;
+    }
+    reader->sqarray[index] = index;
+    __atomic_store_n(reader->sqtail, tail + 1, __ATOMIC_RELEASE);
+    slot->pending = 1;
+
+    int retval;
+    do {
+	retval = uringread_enter(reader->ringfd, 1, 0, 0);
+    } while (-1 == retval && EINTR == errno);
+    if (1 != retval) {
+	fprintf(stderr, "error: can not submit read request: %s\n", strerror(errno));
+	abort();
+    }
+}
+
+/* wait for completed reads and put them into their slots */
+static void uringread_wait(struct uringread_s *reader) {
+
+    unsigned head = *reader->cqhead;
+
+    while (head == __atomic_load_n(reader->cqtail, __ATOMIC_ACQUIRE)) {
+	int retval = uringread_enter(reader->ringfd, 0, 1, IORING_ENTER_GETEVENTS);
+	if (-1 == retval && EINTR != errno) {
+	    fprintf(stderr, "error: can not wait for read request: %s\n", strerror(errno));
+	    abort();
+	}
+    }
+
+    while (head != __atomic_load_n(reader->cqtail, __ATOMIC_ACQUIRE)) {
+	const struct io_uring_cqe *cqe = &((struct io_uring_cqe *) reader->cqes)[head & *reader->cqmask];
+	const int i = cqe->user_data;
+	const int res = cqe->res;
+	head++;
+	__atomic_store_n(reader->cqhead, head, __ATOMIC_RELEASE);
+
+	struct uringread_slot_s *slot = &reader->slot[i];
+	slot->pending = 0;
+	if (-EINTR == res || -EAGAIN == res)
+	    uringread_submit(reader, i);
+	else if (0 > res) {
+	    fprintf(stderr, "error: reading from input file: %s\n", strerror(-res));
+	    abort();
+	}
+	else if (0 == res)
+	    reader->eof = 1;
+	else {
+	    slot->filled += res;
+	    // read the rest of a short read
+	    if (slot->filled < reader->blocksize)
+		uringread_submit(reader, i);
+	}
+    }
+}
+
+/* start reading the next block into slot i */
+static void uringread_start(struct uringread_s *reader, int i) {
+
+    struct uringread_slot_s *slot = &reader->slot[i];
+    slot->offset = reader->nextoffset;
+    slot->filled = 0;
+    if (reader->eof)
+	return;
+    reader->nextoffset += reader->blocksize;
+    uringread_submit(reader, i);
+}
+
+static void uringread_unmap(struct uringread_s *reader) {
+
+    if (reader->sqes)
+	munmap(reader->sqes, reader->sqeslen);
+    if (reader->cqring && reader->cqring != reader->sqring)
+	munmap(reader->cqring, reader->cqringlen);
+    if (reader->sqring)
+	munmap(reader->sqring, reader->sqringlen);
+}
+
+struct uringread_s *uringread_new(int fd, off_t offset, size_t blocksize, int depth) {
+    assert(blocksize > 0);
+    assert(depth > 0);
+
+    struct stat st;
+    if (0 > fd || fstat(fd, &st) || !S_ISREG(st.st_mode) || 0 > offset)
+	return NULL;
+
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    const int ringfd = uringread_setup(depth, &params);
+    if (-1 == ringfd)
+	return NULL;	// not supported by kernel or not permitted
+
+    struct uringread_s *reader = calloc(1, sizeof(*reader));
+    assert(reader);
+    reader->fd = fd;
+    reader->ringfd = ringfd;
+    reader->blocksize = blocksize;
+    reader->depth = depth;
+    reader->nextoffset = offset;
+
+    reader->sqringlen = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    reader->cqringlen = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+	reader->sqringlen = reader->cqringlen = MAX(reader->sqringlen, reader->cqringlen);
+    reader->sqeslen = params.sq_entries * sizeof(struct io_uring_sqe);
+
+    void *ptr = mmap(NULL, reader->sqringlen, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, ringfd, IORING_OFF_SQ_RING);
+    if (MAP_FAILED == ptr)
+	goto error;
+    reader->sqring = ptr;
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+	reader->cqring = reader->sqring;
+    else {
+	ptr = mmap(NULL, reader->cqringlen, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, ringfd, IORING_OFF_CQ_RING);
+	if (MAP_FAILED == ptr)
+	    goto error;
+	reader->cqring = ptr;
+    }
+    ptr = mmap(NULL, reader->sqeslen, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, ringfd, IORING_OFF_SQES);
+    if (MAP_FAILED == ptr)
+	goto error;
+    reader->sqes = ptr;
+
+    reader->sqtail = (unsigned *) ((char *) reader->sqring + params.sq_off.tail);
+    reader->sqmask = (unsigned *) ((char *) reader->sqring + params.sq_off.ring_mask);
+    reader->sqarray = (unsigned *) ((char *) reader->sqring + params.sq_off.array);
+    reader->cqhead = (unsigned *) ((char *) reader->cqring + params.cq_off.head);
+    reader->cqtail = (unsigned *) ((char *) reader->cqring + params.cq_off.tail);
+    reader->cqmask = (unsigned *) ((char *) reader->cqring + params.cq_off.ring_mask);
+    reader->cqes = (char *) reader->cqring + params.cq_off.cqes;
+
+    reader->slot = calloc(depth, sizeof(*reader->slot));
+    assert(reader->slot);
+    int i;
+    for (i=0; i<depth; i++) {
+	void *buffer;
+	int retval = posix_memalign(&buffer, URINGREAD_ALIGNMENT, blocksize);
+	if (retval) {
+	    fprintf(stderr, "error: can not allocate read buffer: %s\n", strerror(retval));
+	    abort();
+	}
+	reader->slot[i].buffer = buffer;
+    }
+
+    // registered buffers save the page mapping per read, but count against
+    // RLIMIT_MEMLOCK. Read into plain buffers if that fails.
+    struct iovec *iov = calloc(depth, sizeof(*iov));
+    assert(iov);
+    for (i=0; i<depth; i++) {
+	iov[i].iov_base = reader->slot[i].buffer;
+	iov[i].iov_len = blocksize;
+    }
+    reader->fixed = !uringread_register(ringfd, IORING_REGISTER_BUFFERS, iov, depth);
+    free(iov);
+
+    for (i=0; i<depth; i++)
+	uringread_start(reader, i);
+
+    return reader;
+
+error:
+    uringread_unmap(reader);
+    close(ringfd);
+    free(reader);
+    return NULL;
+}
+
+void uringread_delete(struct uringread_s *reader) {
+    assert(reader);
+
+    // the kernel must not write into the buffers after free()
+    int i;
+    for (i=0; i<reader->depth; i++)
+	while (reader->slot[i].pending)
+	    uringread_wait(reader);
+
+    uringread_unmap(reader);
+    close(reader->ringfd);
+    for (i=0; i<reader->depth; i++)
+	free(reader->slot[i].buffer);
+    free(reader->slot);
+    free(reader);
+}
+
+size_t uringread_read(struct uringread_s *reader, void *buffer, size_t len) {
+    assert(reader);
+    assert(buffer || !len);
+
+    size_t done = 0;
+
+    while (done < len) {
+	struct uringread_slot_s *slot = &reader->slot[reader->head];
+	while (slot->pending)
+	    uringread_wait(reader);
+
+	const size_t n = MIN(len - done, slot->filled - reader->headpos);
+	memcpy((char *) buffer + done, slot->buffer + reader->headpos, n);
+	done += n;
+	reader->headpos += n;
+
+	if (reader->headpos < slot->filled)
+	    continue;	// buffer is full
+	if (slot->filled < reader->blocksize)
+	    break;	// end of file
+
+	// slot is consumed, read ahead the next block into it
+	reader->headpos = 0;
+	uringread_start(reader, reader->head);
+	reader->head = (reader->head + 1) % reader->depth;
+    }
+
+    return done;
+}
+
+#else /* HAVE_LINUX_IO_URING_H */
+
+struct uringread_s *uringread_new(int fd, off_t offset, size_t blocksize, int depth) {
+    return NULL;
+}
+
+void uringread_delete(struct uringread_s *reader) {
+    assert(reader);
+}
+
+size_t uringread_read(struct uringread_s *reader, void *buffer, size_t len) {
+    assert(reader);
+    return 0;
+}
+
+#endif /* HAVE_LINUX_IO_URING_H */
@@ -0,0 +1,99 @@
+/*
+ * uringread.h
+ *
+ *  Created on: 18.10.2026
+ *      Author: jh
+ */
+
+/*
+    Asynchronous read ahead of regular files with io_uring
+
+    Copyright (C) 2017  Jörg Habenicht (jh@mwerk.net)
+
+    This file is part of lfdiff
+
+    lfdiff is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    lfdiff is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#ifndef SRC_ANSIC_URINGREAD_H_
+#define SRC_ANSIC_URINGREAD_H_
+
+#include <stddef.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+
+struct uringread_slot_s {
+    char *buffer;	// blocksize bytes
+    struct iovec iov;	// part of buffer still to read
+    off_t offset;	// file offset of buffer
+    size_t filled;	// bytes read into buffer
+    int pending;	// read submitted, not completed yet
+};
+
+struct uringread_s {
+    int fd;		// file to read from
+    int ringfd;		// io_uring instance
+    int fixed;		// buffers are registered with the kernel
+    size_t blocksize;	// size of one read
+    int depth;		// number of reads in flight
+    off_t nextoffset;	// file offset of next read to submit
+    int eof;		// a read returned end of file
+    int head;		// slot to consume next
+    size_t headpos;	// bytes of head slot consumed
+    struct uringread_slot_s *slot;
+
+    /* rings shared with the kernel */
+    void *sqring;
+    size_t sqringlen;
+    void *cqring;
+    size_t cqringlen;
+    void *sqes;
+    size_t sqeslen;
+    unsigned *sqtail;
+    unsigned *sqmask;
+    unsigned *sqarray;
+    unsigned *cqhead;
+    unsigned *cqtail;
+    unsigned *cqmask;
+    void *cqes;
+};
+
+
+/** start reading a regular file asynchronously.
+ * Keeps depth reads of blocksize bytes in flight.
+ *
+ * @param fd: file descriptor, must not be read by anybody else. -1 for
+ *   streams without file descriptor.
+ * @param offset: file offset to start reading from
+ * @param blocksize: size of one read, multiple of the page size
+ * @param depth: number of reads in flight
+ * @return: reader handler, NULL if io_uring is not available or fd is no
+ *   regular file. Use read() or stdio instead.
+ */
+struct uringread_s *uringread_new(int fd, off_t offset, size_t blocksize, int depth);
+
+void uringread_delete(struct uringread_s *reader);
+
+/** read the next bytes of the file.
+ * Blocks until the data has arrived.
+ *
+ * @param buffer: memory of at least len bytes
+ * @return: number of bytes read, less than len only at end of file
+ */
+size_t uringread_read(struct uringread_s *reader, void *buffer, size_t len);
+
+#endif /* SRC_ANSIC_URINGREAD_H_ */
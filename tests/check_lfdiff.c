@@ -8,9 +8,29 @@
 
 #include <stdlib.h>
 #include <check.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 #include "../src/difflist.h"
 #include "../src/diffmanager.h"
+#include "../src/chunkreader.h"
+#include "../src/chunkindex.h"
+#include "../src/checkpoint.h"
+#include "../src/slicecache.h"
+#include "../src/resources.h"
+#include "../src/iolimit.h"
+#include "../src/mergediff.h"
+#include "../src/keydiff.h"
+#include "../src/editcost.h"
+#include "../src/hash.h"
+#include "../src/intern.h"
+#include "../src/lineruns.h"
+#include "../src/context.h"
+#include "../src/longline.h"
+#include "../src/mask.h"
+#include "../src/spscring.h"
+#include "../src/uringread.h"
 
 /*
  * NOTE: use "CK_FORK=no gdb check_lfdiff" to debug this
@@ -125,6 +145,8 @@ START_TEST (test_difflist_create)
     ck_assert_msg(difflist != NULL,
 	    "diff list new() failed");
     ck_assert(NULL == difflist->tqh_current);
+    // the exclusive ways to keep the text share their members
+    ck_assert_int_le(sizeof(struct diff_iterator), 64);
 }
 END_TEST
 
@@ -140,6 +162,190 @@ START_TEST (test_difflist_add_line)
 }
 END_TEST
 
+START_TEST (test_difflist_add_block_line)
+{
+    static const char test[] = "< one\n> two\n";
+    struct diff_block_s *block = diff_block_new(sizeof(test));
+    memcpy(block->data, test, sizeof(test) - 1);
+    block->len = sizeof(test) - 1;
+
+    diff_add_block_line(difflist, 1, block, &block->data[2], 4, 0);
+    diff_add_block_line(difflist, 2, block, &block->data[8], 4, 0);
+    ck_assert_int_eq(block->refcount, 3);
+
+    struct diff_iterator *it = diff_iterator_get_line(difflist, 2);
+    ck_assert_int_eq(diff_get_line_len(it), 4);
+    ck_assert(!memcmp(diff_get_line(it), "two\n", 4));
+
+    diff_remove_line(difflist, 1);
+    ck_assert_int_eq(block->refcount, 2);
+    // the last line is released in teardown
+    diff_block_unref(block);
+}
+END_TEST
+
+START_TEST (test_difflist_add_interned_line)
+{
+    static const char test[] = "retry\n";
+    struct intern_s *intern = intern_new();
+    diff_set_intern(difflist, intern);
+
+    diff_add_interned_line(difflist, 1, test, strlen(test), 0);
+    diff_add_interned_line(difflist, 3, test, strlen(test), 0);
+    ck_assert_int_eq(intern->count, 1);
+    ck_assert_int_eq(intern->hits, 1);
+
+    struct diff_iterator *it1 = diff_iterator_get_line(difflist, 1);
+    struct diff_iterator *it3 = diff_iterator_get_line(difflist, 3);
+    ck_assert(diff_get_line(it1) == diff_get_line(it3));
+    ck_assert_str_eq(diff_get_line(it3), test);
+
+    diff_remove_line(difflist, 1);
+    ck_assert_int_eq(intern->count, 1);
+    diff_remove_line(difflist, 3);
+    ck_assert_int_eq(intern->count, 0);
+
+    intern_delete(intern);
+}
+END_TEST
+
+START_TEST (test_difflist_compression)
+{
+    static const char test[] = "< one\n> two\n";
+    struct diff_block_s *block = diff_block_new(sizeof(test));
+    memcpy(block->data, test, sizeof(test) - 1);
+    block->len = sizeof(test) - 1;
+
+    if (diff_set_compression(difflist, 1, 0)) {
+	diff_block_unref(block);
+	return;
+    }
+    diff_add_block_line(difflist, 1, block, &block->data[2], 4, 0);
+    diff_add_line(difflist, 2, strdup("three\n"));
+    diff_add_block_line(difflist, 3, block, &block->data[8], 4, 0);
+    // packed lines drop their reference to the block
+    ck_assert_int_eq(block->refcount, 1);
+    diff_block_unref(block);
+    ck_assert_int_eq(difflist->packedlines, 3);
+    ck_assert_int_eq(difflist->hotbytes, 0);
+
+    struct diff_iterator *it = diff_iterator_get_line(difflist, 3);
+    ck_assert_int_eq(it->store, DIFF_LINE_PACKED);
+    ck_assert(it->segment != NULL);
+    ck_assert_int_eq(diff_get_line_len(it), 4);
+    ck_assert(!memcmp(diff_get_line(it), "two\n", 4));
+    it = diff_iterator_get_line(difflist, 2);
+    ck_assert(!memcmp(diff_get_line(it), "three\n", 6));
+    it = diff_iterator_get_line(difflist, 1);
+    ck_assert(!memcmp(diff_get_line(it), "one\n", 4));
+
+    diff_remove_line(difflist, 1);
+    diff_remove_line(difflist, 2);
+    diff_remove_line(difflist, 3);
+    ck_assert(difflist->cached == NULL);
+}
+END_TEST
+
+START_TEST (test_lineruns)
+{
+    struct lineruns_s *runs = lineruns_new();
+    int64_t first, last, next;
+    int64_t n;
+
+    // more runs than the initial capacity, added out of order
+    for (n = 1000; n > 0; n -= 2)
+	lineruns_add(runs, n, (void *) (intptr_t) n);
+    ck_assert_int_eq(lineruns_count(runs), 500);
+    ck_assert(!lineruns_find(runs, 999, NULL, NULL));
+    ck_assert(lineruns_next(runs, 999, &next));
+    ck_assert_int_eq(next, 1000);
+    ck_assert(!lineruns_next(runs, 1001, &next));
+
+    // join runs
+    lineruns_add(runs, 3, (void *) 3);
+    lineruns_add(runs, 5, (void *) 5);
+    ck_assert_int_eq(lineruns_count(runs), 498);
+    ck_assert(lineruns_find(runs, 4, &first, &last));
+    ck_assert_int_eq(first, 2);
+    ck_assert_int_eq(last, 6);
+    ck_assert(lineruns_find_node(runs, 6, NULL) == (void *) 2);
+
+    // split and shrink runs
+    lineruns_remove(runs, 4, (void *) 5);
+    ck_assert_int_eq(lineruns_count(runs), 499);
+    ck_assert(lineruns_find(runs, 5, &first, &last));
+    ck_assert_int_eq(first, 5);
+    ck_assert_int_eq(last, 6);
+    ck_assert(lineruns_find_node(runs, 6, &first) == (void *) 5);
+    ck_assert_int_eq(first, 5);
+    lineruns_remove(runs, 5, (void *) 6);
+    ck_assert(lineruns_find_node(runs, 6, NULL) == (void *) 6);
+    lineruns_remove(runs, 6, NULL);
+    lineruns_remove(runs, 7, NULL);
+    ck_assert(lineruns_find_node(runs, 7, NULL) == NULL);
+    ck_assert_int_eq(lineruns_count(runs), 498);
+    ck_assert(lineruns_next(runs, 4, &next));
+    ck_assert_int_eq(next, 8);
+    ck_assert(lineruns_find(runs, 1000, &first, &last));
+    ck_assert_int_eq(first, 1000);
+
+    lineruns_delete(runs);
+}
+END_TEST
+
+START_TEST (test_difflist_truncate)
+{
+    long n, first, last;
+
+    // some pages of nodes
+    for (n = 1; n <= 10000; n++)
+	if (n % 7)
+	    diff_add_line(difflist, n, strdup("line\n"));
+    ck_assert(diff_iterator_get_line(difflist, 6000) != NULL);
+
+    diff_truncate(difflist, 5002);
+    ck_assert_int_eq(diff_get_line_nr(diff_iterator_get_first(difflist)), 5003);
+    ck_assert(diff_iterator_get_line(difflist, 5001) == NULL);
+    ck_assert(diff_get_run(difflist, 5003, &first, &last));
+    ck_assert_int_eq(first, 5003);
+    ck_assert_int_eq(last, 5004);
+    ck_assert(diff_get_next_line_nr(difflist, 0, &n));
+    ck_assert_int_eq(n, 5003);
+
+    // the current node has been removed
+    diff_iterator_get_line(difflist, 100);
+    diff_truncate(difflist, 10000);
+    ck_assert(diff_iterator_get_current(difflist) == NULL);
+    ck_assert(!diff_get_next_line_nr(difflist, 0, &n));
+    diff_add_line(difflist, 10001, strdup("line\n"));
+    ck_assert(diff_iterator_get_line(difflist, 10001) != NULL);
+}
+END_TEST
+
+START_TEST (test_difflist_reuse_nodes)
+{
+    long n;
+    for (n = 1; n <= 50000; n++)
+	diff_add_line(difflist, n, NULL);
+    const long pages = difflist->pages;
+    ck_assert(pages > 1);
+
+    // every page keeps some nodes, the released ones are taken again
+    for (n = 1; n <= 50000; n++)
+	if (n % 10)
+	    diff_remove_line(difflist, n);
+    ck_assert_int_eq(difflist->pages, pages);
+    for (n = 100001; n <= 145000; n++)
+	diff_add_line(difflist, n, NULL);
+    ck_assert_int_eq(difflist->pages, pages);
+    ck_assert_int_eq(diff_get_line_nr(diff_iterator_get_line(difflist, 145000)), 145000);
+
+    // pages without nodes are freed, the page nodes are taken from stays
+    diff_truncate(difflist, 145000);
+    ck_assert_int_eq(difflist->pages, 1);
+}
+END_TEST
+
 START_TEST (test_difflist_remove_last_line)
 {
     static const char test[] = "test";
@@ -330,6 +536,33 @@ START_TEST (test_difflist_get_line)
 }
 END_TEST
 
+START_TEST (test_difflist_get_line_runs)
+{
+    long n;
+    // runs 1..100, 201..300 and 401..500
+    for (n = 1; n <= 500; n++)
+	if ((n - 1) / 100 % 2 == 0)
+	    diff_add_line(difflist, n, NULL);
+    // split a run, shrink one at the front
+    diff_remove_line(difflist, 50);
+    diff_remove_line(difflist, 201);
+    diff_truncate(difflist, 10);
+
+    ck_assert(diff_iterator_get_line(difflist, 10) == NULL);
+    ck_assert(diff_iterator_get_line(difflist, 50) == NULL);
+    ck_assert(diff_iterator_get_line(difflist, 150) == NULL);
+    ck_assert(diff_iterator_get_line(difflist, 201) == NULL);
+    static const long lines[] = { 11, 490, 51, 49, 202, 300, 100, 401, 500, 11 };
+    size_t i;
+    for (i = 0; i < sizeof(lines) / sizeof(*lines); i++) {
+	struct diff_iterator *it = diff_iterator_get_line(difflist, lines[i]);
+	ck_assert(it != NULL);
+	ck_assert_int_eq(diff_get_line_nr(it), lines[i]);
+	ck_assert(diff_iterator_get_current(difflist) == it);
+    }
+}
+END_TEST
+
 START_TEST (test_difflist_go_to_line)
 {
     static const char test1[] = "test1";
@@ -836,7 +1069,897 @@ START_TEST (test_diffmanager_remove_common_3)
     free(ptr);
 }
 END_TEST
+START_TEST (test_chunkreader_lines)
+{
+    static const char text[] = "line 1\nline 2\nline 3\nline 4\nno newline";
+    FILE *f = fmemopen((void *) text, strlen(text), "r");
+    ck_assert(f != NULL);
+
+    struct chunkreader_s *reader = chunkreader_new(f, 16, 2, 0, NULL, NULL, NULL);
+    struct chunk_s *chunk;
+    long lines = 0;
+    size_t len = 0;
+    while ((chunk = chunkreader_get(reader))) {
+	// every chunk holds whole lines
+	ck_assert(chunk->len > 0);
+	if (len + chunk->len < strlen(text))
+	    ck_assert(chunk->data[chunk->len-1] == '\n');
+	ck_assert(!memcmp(chunk->data, text+len, chunk->len));
+	len += chunk->len;
+	lines += chunk->lines;
+	chunk_free(chunk);
+    }
+    ck_assert_int_eq(len, strlen(text));
+    ck_assert_int_eq(lines, 5);
+
+    chunkreader_delete(reader);
+    fclose(f);
+}
+END_TEST
+
+START_TEST (test_chunkreader_shifted)
+{
+    /* equal content produces equal chunks, even if it is shifted */
+    size_t lenA = 0, lenB = 0;
+    char *textA = NULL, *textB = NULL;
+    char buffer[32];
+    int i;
+
+    strmcat(&textB, &lenB, "inserted line\n");
+    for (i=0; i<2000; i++) {
+	snprintf(buffer, sizeof(buffer), "line %d\n", i);
+	strmcat(&textA, &lenA, buffer);
+	strmcat(&textB, &lenB, buffer);
+    }
+
+    FILE *fA = fmemopen(textA, strlen(textA), "r");
+    FILE *fB = fmemopen(textB, strlen(textB), "r");
+    struct chunkreader_s *readerA = chunkreader_new(fA, 256, 2, 0, NULL, NULL, NULL);
+    struct chunkreader_s *readerB = chunkreader_new(fB, 256, 2, 0, NULL, NULL, NULL);
+
+    // skip the first chunk of both inputs, they differ
+    struct chunk_s *chunkA = chunkreader_get(readerA);
+    struct chunk_s *chunkB = chunkreader_get(readerB);
+    ck_assert(!chunk_equal(chunkA, chunkB, 0, NULL));
+    chunk_free(chunkA);
+    chunk_free(chunkB);
+
+    // the following chunks are the same
+    int equal = 0;
+    chunkA = chunkreader_get(readerA);
+    chunkB = chunkreader_get(readerB);
+    while (chunkA && chunkB) {
+	if (chunk_equal(chunkA, chunkB, 0, NULL))
+	    equal++;
+	chunk_free(chunkA);
+	chunk_free(chunkB);
+	chunkA = chunkreader_get(readerA);
+	chunkB = chunkreader_get(readerB);
+    }
+    ck_assert(!chunkA && !chunkB);
+    ck_assert_int_gt(equal, 10);
+
+    chunkreader_delete(readerA);
+    chunkreader_delete(readerB);
+    fclose(fA);
+    fclose(fB);
+    free(textA);
+    free(textB);
+}
+END_TEST
+
+START_TEST (test_chunkreader_spilled_offset)
+{
+    /* a long line is replaced by its placeholder, the chunk still counts
+     * the bytes read from the input
+     */
+    const size_t longlen = 2*1024*1024;
+    char *text = malloc(longlen + 2 + 100*16);
+    ck_assert(text != NULL);
+    size_t len = 0;
+    int i;
+
+    text[len++] = 'a';
+    text[len++] = '\n';
+    memset(text + len, 'x', longlen - 1);
+    len += longlen - 1;
+    text[len++] = '\n';
+    for (i=0; i<100; i++)
+	len += sprintf(text + len, "line %d\n", i);
+
+    FILE *f = fmemopen(text, len, "r");
+    ck_assert(f != NULL);
+    struct chunkreader_s *reader = chunkreader_new(f, 256, 2, 0, NULL, NULL, NULL);
+    struct chunk_s *chunk;
+    size_t offset = 0;
+    int spilled = 0;
+    while ((chunk = chunkreader_get(reader))) {
+	ck_assert_int_eq(chunk->offset, offset);
+	offset += chunk->inlen;
+	if (chunk->inlen != chunk->len) {
+	    // the tail holding the placeholder keeps the bytes of the long line
+	    spilled++;
+	    const size_t inlen = chunk->inlen;
+	    struct chunk_s *tail = chunk_split(chunk, 0, 0, NULL);
+	    ck_assert(tail != NULL);
+	    ck_assert_int_eq(chunk->inlen, 2);
+	    ck_assert_int_eq(chunk->inlen + tail->inlen, inlen);
+	    ck_assert_int_eq(tail->offset, chunk->offset + 2);
+	    chunk_free(tail);
+	}
+	chunk_free(chunk);
+    }
+    ck_assert_int_eq(offset, len);
+    ck_assert_int_eq(spilled, 1);
+
+    chunkreader_delete(reader);
+    fclose(f);
+    free(text);
+}
+END_TEST
+
+START_TEST (test_chunk_lists_compare_trivial)
+{
+    // the last line misses the newline, the chunk boundaries differ
+    struct chunk_s a1 = { .data = "a\n", .len = 2, .lines = 1 };
+    struct chunk_s a2 = { .data = "b", .len = 1, .lines = 1 };
+    struct chunk_s b1 = { .data = "a\nb", .len = 3, .lines = 2 };
+    struct chunk_s c1 = { .data = "a\nc", .len = 3, .lines = 2 };
+    struct chunk_list_s listA, listB, listC, empty;
+    STAILQ_INIT(&listA);
+    STAILQ_INSERT_TAIL(&listA, &a1, entries);
+    STAILQ_INSERT_TAIL(&listA, &a2, entries);
+    STAILQ_INIT(&listB);
+    STAILQ_INSERT_TAIL(&listB, &b1, entries);
+    STAILQ_INIT(&listC);
+    STAILQ_INSERT_TAIL(&listC, &c1, entries);
+    STAILQ_INIT(&empty);
+    long lines[2];
+
+    ck_assert_int_eq(chunk_lists_compare_trivial(&listA, &listB, lines), CHUNK_LISTS_SAME);
+    ck_assert_int_eq(lines[0], 2);
+    ck_assert_int_eq(lines[1], 2);
+    ck_assert_int_eq(chunk_lists_compare_trivial(&listA, &empty, lines), CHUNK_LISTS_ONE_EMPTY);
+    ck_assert_int_eq(lines[0], 2);
+    ck_assert_int_eq(lines[1], 0);
+    ck_assert_int_eq(chunk_lists_compare_trivial(&empty, &listC, lines), CHUNK_LISTS_ONE_EMPTY);
+    ck_assert_int_eq(lines[0], 0);
+    ck_assert_int_eq(lines[1], 2);
+    ck_assert_int_eq(chunk_lists_compare_trivial(&empty, &empty, lines), CHUNK_LISTS_SAME);
+    ck_assert_int_eq(chunk_lists_compare_trivial(&listA, &listC, lines), CHUNK_LISTS_DIFFER);
+}
+END_TEST
+
+START_TEST (test_chunkreader_index)
+{
+    /* the second reader takes the chunks from the index of the first one */
+    FILE *f = tmpfile();
+    ck_assert(f != NULL);
+    int i;
+    for (i=0; i<2000; i++)
+	fprintf(f, "line %d\n", i);
+    fflush(f);
+    rewind(f);
+    char dir[] = "/tmp/check_lfdiff_XXXXXX";
+    ck_assert(mkdtemp(dir) != NULL);
+
+    const uint64_t params = chunkreader_index_params(256, 0, NULL);
+    struct chunkreader_s *reader = chunkreader_new(f, 256, 2, 0, NULL, chunkindex_open(dir, fileno(f), params), NULL);
+    ck_assert_int_eq(reader->indexed, 0);
+    uint64_t hash[1000];
+    long chunks = 0;
+    struct chunk_s *chunk;
+    while ((chunk = chunkreader_get(reader))) {
+	ck_assert_int_lt(chunks, 1000);
+	hash[chunks++] = chunk->hash;
+	chunk_free(chunk);
+    }
+    chunkreader_delete(reader);
+
+    rewind(f);
+    reader = chunkreader_new(f, 256, 2, 0, NULL, chunkindex_open(dir, fileno(f), params), NULL);
+    ck_assert_int_eq(reader->indexed, 1);
+    long n = 0;
+    off_t offset = 0;
+    while ((chunk = chunkreader_get(reader))) {
+	ck_assert(chunk->data == NULL);
+	ck_assert(chunk->hash == hash[n++]);
+	ck_assert_int_eq(chunk->offset, offset);
+	chunkreader_load(reader, chunk);
+	ck_assert(chunk->hash == hash_bytes(chunk->data, chunk->len, 0));
+	offset += chunk->len;
+	chunk_free(chunk);
+    }
+    ck_assert_int_eq(n, chunks);
+    chunkreader_delete(reader);
+
+    // other parameters do not match the index
+    struct stat st;
+    char path[sizeof(dir) + 64];
+    ck_assert_int_eq(fstat(fileno(f), &st), 0);
+    snprintf(path, sizeof(path), "%s/%llx-%llx.lfdidx", dir, (unsigned long long) st.st_dev, (unsigned long long) st.st_ino);
+    ck_assert(NULL == chunkindex_open_file(path, fileno(f), chunkreader_index_params(256, HASH_IGNORE_CASE, NULL), CHUNKINDEX_READ));
+    struct chunkindex_s *index = chunkindex_open_file(path, fileno(f), params, CHUNKINDEX_READ);
+    ck_assert(index != NULL);
+    chunkindex_close(index, 0);
+    ck_assert_int_eq(unlink(path), 0);
+    ck_assert_int_eq(rmdir(dir), 0);
+    fclose(f);
+}
+END_TEST
+
+START_TEST (test_slicecache)
+{
+    char dir[] = "/tmp/check_lfdiff_XXXXXX";
+    ck_assert(mkdtemp(dir) != NULL);
+    const struct slicecache_hunk_s put[2] = { {2, 3, 2, 1}, {7, 6, 6, 8} };
+    const uint64_t key[2][2] = { {1, 2}, {3, 4} };
+    const int64_t lines[2] = { 10, 12 };
+    const int64_t other[2] = { 10, 11 };
+    const off_t entrysize = sizeof(struct slicecache_header_s) + sizeof(put);
+
+    struct slicecache_s *cache = slicecache_open(dir, 2 * entrysize - 1);
+    struct slicecache_hunk_s *hunks;
+    size_t count;
+    ck_assert_int_eq(slicecache_get(cache, key[0], lines, &hunks, &count), 0);
+    slicecache_put(cache, key[0], lines, put, 2);
+    ck_assert_int_eq(slicecache_get(cache, key[0], other, &hunks, &count), 0);
+    ck_assert_int_eq(slicecache_get(cache, key[0], lines, &hunks, &count), 1);
+    ck_assert_int_eq(count, 2);
+    ck_assert(!memcmp(hunks, put, sizeof(put)));
+    free(hunks);
+    ck_assert_int_eq(cache->hits, 1);
+    ck_assert_int_eq(cache->misses, 2);
+
+    // the second entry does not fit, one is removed
+    slicecache_put(cache, key[1], lines, put, 2);
+    ck_assert_int_eq(cache->evicted, 1);
+    ck_assert_int_eq(cache->size, entrysize);
+    slicecache_close(cache);
+
+    // the size is found again
+    cache = slicecache_open(dir, 2 * entrysize - 1);
+    ck_assert_int_eq(cache->size, entrysize);
+    int found = slicecache_get(cache, key[0], lines, &hunks, &count);
+    free(hunks);
+    found += slicecache_get(cache, key[1], lines, &hunks, &count);
+    free(hunks);
+    ck_assert_int_eq(found, 1);
+    slicecache_close(cache);
+
+    int i;
+    for (i=0; i<2; i++) {
+	char path[sizeof(dir) + 64];
+	snprintf(path, sizeof(path), "%s/%016llx%016llx.lfdslc", dir, (unsigned long long) key[i][0], (unsigned long long) key[i][1]);
+	unlink(path);
+    }
+    ck_assert_int_eq(rmdir(dir), 0);
+}
+END_TEST
+
+START_TEST (test_resources_cgroup2)
+{
+    char dir[] = "/tmp/check_lfdiff_XXXXXX";
+    ck_assert(mkdtemp(dir) != NULL);
+    char memorymax[sizeof(dir) + 16];
+    char cpumax[sizeof(dir) + 16];
+    snprintf(memorymax, sizeof(memorymax), "%s/memory.max", dir);
+    snprintf(cpumax, sizeof(cpumax), "%s/cpu.max", dir);
+
+    // a host of 512GB and 64 cores
+    struct resources_s res = { 512l<<30, 0, 64, 64 };
+    ck_assert_int_eq(resources_splitsize(&res), 16l<<30);
+    ck_assert_int_eq(resources_prefetch(&res, 64*1024), 64);
+    ck_assert_int_eq(resources_threads(&res), 64);
+
+    // no limits
+    FILE *f = fopen(memorymax, "w");
+    fputs("max\n", f);
+    fclose(f);
+    f = fopen(cpumax, "w");
+    fputs("max 100000\n", f);
+    fclose(f);
+    resources_read_cgroup2(&res, dir);
+    ck_assert(res.memory == 512l<<30);
+    ck_assert_int_eq(res.memorylimited, 0);
+    ck_assert_int_eq(res.cpus, 64);
+
+    // a container of 4GB and 1.5 cores
+    f = fopen(memorymax, "w");
+    fputs("4294967296\n", f);
+    fclose(f);
+    f = fopen(cpumax, "w");
+    fputs("150000 100000\n", f);
+    fclose(f);
+    resources_read_cgroup2(&res, dir);
+    ck_assert(res.memory == 4l<<30);
+    ck_assert_int_eq(res.memorylimited, 1);
+    ck_assert_int_eq(res.cpus, 2);
+    ck_assert_int_eq(resources_splitsize(&res), 512l<<20);
+    ck_assert_int_eq(resources_prefetch(&res, 64*1024), 8);
+    ck_assert_int_eq(resources_threads(&res), 2);
+
+    // the lower bounds
+    res.memory = 64l<<20;
+    res.cpus = 1;
+    ck_assert_int_eq(resources_splitsize(&res), 16l<<20);
+    ck_assert_int_eq(resources_prefetch(&res, 1024*1024), 1);
+    res.memory = 0;
+    ck_assert_int_eq(resources_splitsize(&res), 0);
+    ck_assert_int_eq(resources_prefetch(&res, 64*1024), 4);
+
+    unlink(memorymax);
+    unlink(cpumax);
+    ck_assert_int_eq(rmdir(dir), 0);
+}
+END_TEST
+
+START_TEST (test_iolimit_take)
+{
+    // 2MB at 4MB/s, the first 0.4MB are taken from the burst
+    struct iolimit_s *limit = iolimit_new(4*1024*1024, 0);
+    int i;
+    for (i=0; i<8; i++)
+	iolimit_take(limit, 256*1024);
+    const double seconds = iolimit_seconds(limit);
+    ck_assert(seconds > 0.35);
+    ck_assert(seconds < 2);
+    ck_assert(limit->bytes == 2*1024*1024);
+    ck_assert(limit->throttled > 0.35);
+    iolimit_delete(limit);
+
+    // without limit the bytes are counted only
+    limit = iolimit_new(0, 0);
+    iolimit_take(limit, 100*1024*1024);
+    ck_assert(limit->bytes == 100*1024*1024);
+    ck_assert(limit->throttled == 0);
+    ck_assert(iolimit_seconds(limit) < 0.35);
+    iolimit_delete(limit);
+}
+END_TEST
+
+START_TEST (test_uringread_read)
+{
+    /* read a file in pieces not aligned to the block size */
+    FILE *f = tmpfile();
+    ck_assert(f != NULL);
+    int i;
+    for (i=0; i<10000; i++)
+	fprintf(f, "line %d\n", i);
+    const long size = ftell(f);
+    rewind(f);
+
+    struct uringread_s *reader = uringread_new(fileno(f), 0, 4096, 3);
+    if (!reader) {
+	// io_uring not available, the chunk reader uses stdio
+	fclose(f);
+	return;
+    }
+
+    char *expect = malloc(size);
+    char *buffer = malloc(size + 1000);
+    ck_assert_int_eq(fread(expect, 1, size, f), size);
+
+    long pos = 0;
+    size_t got;
+    while ((got = uringread_read(reader, buffer + pos, 1000)))
+	pos += got;
+    ck_assert_int_eq(pos, size);
+    ck_assert(!memcmp(buffer, expect, size));
+    ck_assert_int_eq(uringread_read(reader, buffer, 1), 0);
+
+    uringread_delete(reader);
+    free(expect);
+    free(buffer);
+    fclose(f);
+}
+END_TEST
+
+START_TEST (test_longline_write)
+{
+    /* the placeholder does not depend on how the line is handed over */
+    const size_t len = 3 * LONGLINE_BLOCKSIZE + 17;
+    char *line = malloc(len + 1);
+    size_t i;
+    for (i=0; i<len; i++)
+	line[i] = 'a' + i % 23;
+    line[len - 1] = '\n';
+    line[len] = 0;
+
+    char placeholder[2][LONGLINE_PLACEHOLDER_LEN];
+    struct longline_s *longline = longline_new();
+    longline_begin(longline);
+    longline_append(longline, line, len);
+    longline_end(longline, placeholder[0]);
+    longline_begin(longline);
+    for (i=0; i<len; i+=1000)
+	longline_append(longline, line + i, len - i < 1000? len - i: 1000);
+    longline_end(longline, placeholder[1]);
+
+    ck_assert_str_eq(placeholder[0], placeholder[1]);
+    ck_assert(longline_is_placeholder(placeholder[0], strlen(placeholder[0])));
+    ck_assert(!longline_is_placeholder(line, len));
+
+    char *ptr;
+    size_t size;
+    FILE *f = open_memstream(&ptr, &size);
+    ck_assert(f != NULL);
+    ck_assert(longline_write(longline, placeholder[0], strlen(placeholder[0]), f));
+    ck_assert(!longline_write(longline, "short line\n", 11, f));
+    fclose(f);
+    ck_assert_str_eq(ptr, line);
+
+    longline_delete(longline);
+    free(ptr);
+    free(line);
+}
+END_TEST
+
+static void *spscring_producer(void *args) {
+    struct spscring_s *ring = (struct spscring_s *) args;
+    long i;
+
+    for (i=1; i<=100000; i++)
+	if (!spscring_push(ring, (void *) i))
+	    break;
+    spscring_close(ring);
+
+    return NULL;
+}
+
+START_TEST (test_spscring_order)
+{
+    struct spscring_s *ring = spscring_new(3);
+    pthread_t thread;
+    ck_assert_int_eq(pthread_create(&thread, NULL, spscring_producer, ring), 0);
+
+    long expect = 1;
+    void *item;
+    while ((item = spscring_pop(ring)))
+	ck_assert_int_eq((long) item, expect++);
+    ck_assert_int_eq(expect, 100001);
+
+    pthread_join(thread, NULL);
+    spscring_delete(ring);
+}
+END_TEST
+
+START_TEST (test_spscring_cancel)
+{
+    /* a producer blocked on a full ring returns on cancel */
+    struct spscring_s *ring = spscring_new(2);
+    pthread_t thread;
+    ck_assert_int_eq(pthread_create(&thread, NULL, spscring_producer, ring), 0);
+
+    ck_assert_int_eq((long) spscring_pop(ring), 1);
+    spscring_cancel(ring);
+    pthread_join(thread, NULL);
+
+    spscring_delete(ring);
+}
+END_TEST
+
+START_TEST (test_mergediff_compare)
+{
+    static const char textA[] = "a\nb\nd\ne\n";
+    static const char textB[] = "a\nc\nd\nf\n";
+    static const char result[] =
+	    "2d1\n"
+	    "< b\n"
+	    "2a2\n"
+	    "> c\n"
+	    "4d3\n"
+	    "< e\n"
+	    "4a4\n"
+	    "> f\n";
+    FILE *fA = fmemopen((void *) textA, strlen(textA), "r");
+    FILE *fB = fmemopen((void *) textB, strlen(textB), "r");
+
+    char *ptr;
+    size_t size;
+    FILE *f = open_memstream(&ptr, &size);
+    ck_assert(f != NULL);
+
+    int differ = mergediff_compare(fA, fB, f);
+    fclose(f);
+    ck_assert_int_eq(differ, 1);
+    ck_assert_str_eq(ptr, result);
+
+    free(ptr);
+    fclose(fA);
+    fclose(fB);
+}
+END_TEST
+START_TEST (test_editcost_lower_bound)
+{
+    // "diff" of these: delete 2 and 4, insert 9, cost 3
+    const uint64_t a[] = { 1, 2, 3, 4, 5 };
+    const uint64_t b[] = { 1, 3, 9, 5 };
+    ck_assert_int_eq(editcost_lower_bound(a, 5, b, 4), 3);
+    ck_assert_int_eq(editcost_lower_bound(a, 5, a, 5), 0);
+    ck_assert_int_eq(editcost_lower_bound(a, 5, b, 0), 5);
+    ck_assert_int_eq(editcost_lower_bound(NULL, 0, NULL, 0), 0);
+
+    // reordered unique lines keep their longest increasing run only
+    const uint64_t reversed[] = { 5, 4, 3, 2, 1 };
+    ck_assert_int_eq(editcost_lower_bound(a, 5, reversed, 5), 8);
+    const uint64_t rotated[] = { 3, 4, 5, 1, 2 };
+    ck_assert_int_eq(editcost_lower_bound(a, 5, rotated, 5), 4);
+
+    // repeated lines may match in any order, the bound is lower than the cost
+    const uint64_t repeated[] = { 7, 7, 8, 7 };
+    const uint64_t other[] = { 8, 7, 7, 6 };
+    ck_assert_int_eq(editcost_lower_bound(repeated, 4, other, 4), 2);
+}
+END_TEST
+
+START_TEST (test_keydiff_compare)
+{
+    static const char textA[] = "1,a\n2,b\n3,c\n4,d\n";
+    static const char textB[] = "3,c\n1,a\n2,B\n5,e\n";
+    static const char result[] =
+	    "2c3\n"
+	    "< 2,b\n"
+	    "---\n"
+	    "> 2,B\n"
+	    "a4\n"
+	    "> 5,e\n"
+	    "4d\n"
+	    "< 4,d\n";
+    FILE *fA = fmemopen((void *) textA, strlen(textA), "r");
+    FILE *fB = fmemopen((void *) textB, strlen(textB), "r");
+
+    char *ptr;
+    size_t size;
+    FILE *f = open_memstream(&ptr, &size);
+    ck_assert(f != NULL);
+
+    // one bucket keeps the order of the output
+    int differ = keydiff_compare(fA, fB, f, 1, ',', 1, 2);
+    fclose(f);
+    ck_assert_int_eq(differ, 1);
+    ck_assert_str_eq(ptr, result);
+
+    free(ptr);
+    fclose(fA);
+    fclose(fB);
+}
+END_TEST
+START_TEST (test_hash_normalise)
+{
+    static const char text[] = "  Some  TEXT\twith\tWhite Space and more letters \n\n \nnext line\n";
+    char buffer[sizeof(text)];
+    size_t len;
+
+    len = hash_normalise(text, strlen(text), buffer, HASH_IGNORE_CASE);
+    buffer[len] = 0;
+    ck_assert_str_eq(buffer, "  some  text\twith\twhite space and more letters \n\n \nnext line\n");
+
+    len = hash_normalise(text, strlen(text), buffer, HASH_IGNORE_SPACE_CHANGE);
+    buffer[len] = 0;
+    ck_assert_str_eq(buffer, " Some TEXT with White Space and more letters\n\n\nnext line\n");
+
+    len = hash_normalise(text, strlen(text), buffer, HASH_IGNORE_ALL_SPACE);
+    buffer[len] = 0;
+    ck_assert_str_eq(buffer, "SomeTEXTwithWhiteSpaceandmoreletters\n\n\nnextline\n");
+
+    len = hash_normalise(text, strlen(text), buffer, HASH_IGNORE_BLANK_LINES);
+    buffer[len] = 0;
+    ck_assert_str_eq(buffer, "  Some  TEXT\twith\tWhite Space and more letters \n \nnext line\n");
+
+    len = hash_normalise(text, strlen(text), buffer, HASH_IGNORE_ALL_SPACE|HASH_IGNORE_BLANK_LINES|HASH_IGNORE_CASE);
+    buffer[len] = 0;
+    ck_assert_str_eq(buffer, "sometextwithwhitespaceandmoreletters\nnextline\n");
+}
+END_TEST
+
+START_TEST (test_hash_lines_equal)
+{
+    static const char a[] = "Hello  World\n";
+    static const char b[] = "hello world \n";
+
+    ck_assert(hash_lines(a, strlen(a), 0) != hash_lines(b, strlen(b), 0));
+    ck_assert(!hash_lines_equal(a, strlen(a), b, strlen(b), 0));
+
+    const int flags = HASH_IGNORE_CASE|HASH_IGNORE_SPACE_CHANGE;
+    ck_assert(hash_lines(a, strlen(a), flags) == hash_lines(b, strlen(b), flags));
+    ck_assert(hash_lines_equal(a, strlen(a), b, strlen(b), flags));
+}
+END_TEST
+
+START_TEST (test_mask_apply)
+{
+    static const char a[] = "2026-10-18 12:00:01 start id=17\nno stamp\n";
+    static const char b[] = "2026-10-19 08:13:59 start id=4711\nno stamp\n";
+    char buffer[sizeof(b)];
+
+    struct mask_s *mask = mask_new();
+    mask_add(mask, "^[0-9-]+ [0-9:]+");
+    mask_add(mask, "id=[0-9]+");
+    ck_assert_int_eq(mask_compile(mask), 0);
+
+    size_t len = mask_apply(mask, a, strlen(a), buffer);
+    buffer[len] = 0;
+    ck_assert_str_eq(buffer, "\032 start \032\nno stamp\n");
+
+    ck_assert(mask_hash_lines(mask, a, strlen(a), 0) == mask_hash_lines(mask, b, strlen(b), 0));
+    ck_assert(mask_lines_equal(mask, a, strlen(a), b, strlen(b), 0));
+    ck_assert(!mask_lines_equal(NULL, a, strlen(a), b, strlen(b), 0));
+
+    mask_delete(mask);
+}
+END_TEST
+
+START_TEST (test_diffmanager_remove_common_ignore_case)
+{
+    static const char diffA_1[] = "< A\n";
+    static const char diffB_1[] = "> a\n";
+    diffmanager_set_compare_flags(diffmanager, HASH_IGNORE_CASE);
+    diffmanager_input_diff(diffmanager, diffB_1, 1);
+    diffmanager_input_diff(diffmanager, diffA_1, 1);
+
+    diffmanager_remove_common_lines(diffmanager, 0);
+
+    char *ptr;
+    size_t size;
+    FILE *f = open_memstream(&ptr, &size);
+    ck_assert(f != NULL);
+
+    diffmanager_print_diff_to_stream(diffmanager, f, 0);
+    fclose(f);
+
+    ck_assert_str_eq(ptr, "");
+
+    free(ptr);
+}
+END_TEST
+
+
+START_TEST (test_diffmanager_remove_common_shifted)
+{
+    /* FROM
+     * "p\n
+     * X\n
+     * q\n"
+     * to
+     * "p\n
+     * Z\n
+     * X\n
+     * q\n"
+     * with slices cut behind X of A and behind Z of B
+     */
+    static const char diffA_2[] = "< X\n";
+    static const char diffB_2[] = "> Z\n";
+    static const char diffB_3[] = "> X\n";
+    diffmanager_input_diff(diffmanager, diffB_2, 2);
+    diffmanager_input_diff(diffmanager, diffA_2, 2);
+    diffmanager_input_diff(diffmanager, diffB_3, 3);
+
+    diffmanager_remove_common_lines(diffmanager, 0);
+
+    char *ptr;
+    size_t size;
+    FILE *f = open_memstream(&ptr, &size);
+    ck_assert(f != NULL);
+
+    diffmanager_print_diff_to_stream(diffmanager, f, 0);
+    fclose(f);
+
+    ck_assert_str_eq(ptr, "1a2\n> Z\n");
+
+    free(ptr);
+}
+END_TEST
+
+START_TEST (test_diffmanager_moves)
+{
+    static const char diffA_1[] = "< M\n";
+    static const char diffA_2[] = "< N\n";
+    static const char diffB_5[] = "> M\n";
+    static const char diffB_6[] = "> N\n";
+    static const char diffA_9[] = "< X\n";
+    static const char diffB_9[] = "> X\n";
+    diffmanager_set_moves(diffmanager, 2);
+    diffmanager_input_diff(diffmanager, diffA_1, 1);
+    diffmanager_input_diff(diffmanager, diffA_2, 2);
+    diffmanager_input_diff(diffmanager, diffB_5, 5);
+    diffmanager_input_diff(diffmanager, diffB_6, 6);
+    // too short to be a move
+    diffmanager_input_diff(diffmanager, diffA_9, 9);
+    diffmanager_input_diff(diffmanager, diffB_9, 11);
+
+    char *ptr;
+    size_t size;
+    FILE *f = open_memstream(&ptr, &size);
+    ck_assert(f != NULL);
+
+    diffmanager_output_diff(diffmanager, f, 0);
+    fclose(f);
+
+    ck_assert_str_eq(ptr, "1,2m5,6\n9d8\n< X\n11a11\n> X\n");
+    ck_assert_int_eq(diffmanager->moves, 1);
+    ck_assert_int_eq(diffmanager->movedlines, 2);
+
+    free(ptr);
+}
+END_TEST
+
+START_TEST (test_diffmanager_ignore_blank_lines)
+{
+    /* From
+     * "a\n
+     * b\n
+     * c\n
+     * d\n"
+     * to
+     * "a\n
+     * \n
+     * b\n
+     * C\n
+     * d\n"
+     *
+     * "diff -B" prints the change at its place behind the blank line
+     */
+    diffmanager_enable_ignore_blank_lines(diffmanager);
+    diffmanager_input_diff(diffmanager, "> \n", 2);
+    diffmanager_input_diff(diffmanager, "< c\n", 3);
+    diffmanager_input_diff(diffmanager, "> C\n", 4);
+
+    char *ptr;
+    size_t size;
+    FILE *f = open_memstream(&ptr, &size);
+    ck_assert(f != NULL);
+
+    diffmanager_output_diff(diffmanager, f, 0);
+    fclose(f);
+
+    ck_assert_str_eq(ptr, "3c4\n< c\n---\n> C\n");
+    free(ptr);
+}
+END_TEST
+
+START_TEST (test_diffmanager_input_line)
+{
+    // all lines of a slice compared to an empty one are put in as they are
+    diffmanager_input_line(diffmanager, '<', "a\n", 2, 1);
+    diffmanager_input_line(diffmanager, '<', "b", 1, 2);
+
+    char *ptr;
+    size_t size;
+    FILE *f = open_memstream(&ptr, &size);
+    ck_assert(f != NULL);
+
+    diffmanager_output_diff(diffmanager, f, 0);
+    fclose(f);
+
+    ck_assert_str_eq(ptr, "1,2d0\n< a\n< b\n\\ No newline at end of file\n");
+    free(ptr);
+}
+END_TEST
+
+START_TEST (test_diffmanager_unified)
+{
+    static const char linesA[] = "a\nb\nc\nd\ne\nf\ng\nh\n";
+    diffmanager_set_unified(diffmanager, 1, "A", "B");
+    struct context_s *context = context_new(diffmanager, 1);
+
+    context_add_hunk(context, 2, 2);
+    diffmanager_input_diff(diffmanager, "< b\n", 2);
+    diffmanager_input_diff(diffmanager, "> B\n", 2);
+    context_pass(context, linesA, 14, 7);
+    // line 7 is taken from the ring
+    context_add_hunk(context, 8, 8);
+    diffmanager_input_diff(diffmanager, "< h\n", 8);
+    context_pass(context, &linesA[14], 2, 1);
+    diffmanager_set_line_count(diffmanager, 8, 7);
+
+    char *ptr;
+    size_t size;
+    FILE *f = open_memstream(&ptr, &size);
+    ck_assert(f != NULL);
+
+    diffmanager_output_diff(diffmanager, f, 0);
+    fclose(f);
+
+    ck_assert_str_eq(ptr, "--- A\n+++ B\n@@ -1,3 +1,3 @@\n a\n-b\n+B\n c\n@@ -7,2 +7 @@\n g\n-h\n");
+
+    context_delete(context);
+    free(ptr);
+}
+END_TEST
+
+START_TEST (test_diffmanager_first_lines)
+{
+    // lines 1..10 of A and 1..20 of B have been compared before
+    diffmanager_set_first_lines(diffmanager, 11, 21);
+    diffmanager_input_diff(diffmanager, "< a\n", 12);
+    diffmanager_input_diff(diffmanager, "> b\n", 22);
+    diffmanager_input_diff(diffmanager, "> c\n", 24);
+
+    char *ptr;
+    size_t size;
+    FILE *f = open_memstream(&ptr, &size);
+    ck_assert(f != NULL);
+
+    diffmanager_output_diff(diffmanager, f, 0);
+    fclose(f);
+
+    ck_assert_str_eq(ptr, "12c22\n< a\n---\n> b\n13a24\n> c\n");
+    free(ptr);
+}
+END_TEST
 
+START_TEST (test_diffmanager_checkpoint)
+{
+    static const char linesA[] = "a\nb\nc\nd\ne\nf\ng\nh\n";
+    char path[] = "/tmp/check_lfdiff_checkpoint.XXXXXX";
+    int fd = mkstemp(path);
+    ck_assert(fd >= 0);
+    close(fd);
+
+    diffmanager_set_unified(diffmanager, 1, "A", "B");
+    struct context_s *context = context_new(diffmanager, 1);
+    struct checkpoint_s *checkpoint = checkpoint_open(path, 42, 0);
+    ck_assert(checkpoint != NULL);
+    struct checkpoint_state_s state = { {14, 14}, {7, 7}, 5 };
+
+    context_add_hunk(context, 2, 2);
+    diffmanager_input_diff(diffmanager, "< b\n", 2);
+    diffmanager_input_diff(diffmanager, "> B\n", 2);
+    context_pass(context, linesA, 14, 7);
+    checkpoint_save(checkpoint, diffmanager, context, &state);
+    context_add_hunk(context, 8, 8);
+    diffmanager_input_diff(diffmanager, "< h\n", 8);
+    context_pass(context, &linesA[14], 2, 1);
+    state.offset[0] = 16;
+    state.lines[0] = 8;
+    checkpoint_save(checkpoint, diffmanager, context, &state);
+    checkpoint_close(checkpoint, 0);
+
+    // a checkpoint cut short is dropped
+    FILE *f = fopen(path, "a");
+    ck_assert(f != NULL);
+    fputs("L\001", f);
+    fclose(f);
+
+    ck_assert(checkpoint_open(path, 43, 1) == NULL);
+    checkpoint = checkpoint_open(path, 42, 1);
+    ck_assert(checkpoint != NULL);
+
+    struct diffmanager_s *resumed = diffmanager_new();
+    diffmanager_set_unified(resumed, 1, "A", "B");
+    struct context_s *resumedcontext = context_new(resumed, 1);
+    memset(&state, 0, sizeof(state));
+    ck_assert_int_eq(checkpoint_load(checkpoint, resumed, resumedcontext, &state), 1);
+    ck_assert_int_eq(checkpoint->checkpoints, 2);
+    ck_assert_int_eq(state.offset[0], 16);
+    ck_assert_int_eq(state.lines[0], 8);
+    ck_assert_int_eq(state.lines[1], 7);
+    ck_assert_int_eq(state.skippedlines, 5);
+    ck_assert_int_eq(resumedcontext->line, 8);
+    checkpoint_close(checkpoint, 1);
+    ck_assert_int_ne(access(path, F_OK), 0);
+
+    char *ptr[2];
+    size_t size;
+    struct diffmanager_s *manager[2] = { diffmanager, resumed };
+    int i;
+    for (i=0; i<2; i++) {
+	f = open_memstream(&ptr[i], &size);
+	ck_assert(f != NULL);
+	diffmanager_set_line_count(manager[i], 8, 7);
+	diffmanager_output_diff(manager[i], f, 0);
+	fclose(f);
+    }
+    ck_assert_str_eq(ptr[1], ptr[0]);
+
+    context_delete(context);
+    context_delete(resumedcontext);
+    diffmanager_delete(resumed);
+    free(ptr[0]);
+    free(ptr[1]);
+}
+END_TEST
 
 /* --- Test framework --- */
 
@@ -854,6 +1977,21 @@ support_test_suite (void)
     return s;
 }
 
+Suite *
+hash_suite (void)
+{
+    Suite *s = suite_create ("Hash");
+
+    /* Core test case */
+    TCase *tc_hash = tcase_create ("Core");
+    tcase_add_test (tc_hash, test_hash_normalise);
+    tcase_add_test (tc_hash, test_hash_lines_equal);
+    tcase_add_test (tc_hash, test_mask_apply);
+    suite_add_tcase (s, tc_hash);
+
+    return s;
+}
+
 Suite *
 difflist_suite (void)
 {
@@ -864,12 +2002,19 @@ difflist_suite (void)
   tcase_add_checked_fixture (tc_difflist, setup_difflist, teardown_difflist);
   tcase_add_test (tc_difflist, test_difflist_create);
   tcase_add_test (tc_difflist, test_difflist_add_line);
+  tcase_add_test (tc_difflist, test_difflist_add_block_line);
+  tcase_add_test (tc_difflist, test_difflist_add_interned_line);
+  tcase_add_test (tc_difflist, test_difflist_compression);
+  tcase_add_test (tc_difflist, test_lineruns);
+  tcase_add_test (tc_difflist, test_difflist_truncate);
+  tcase_add_test (tc_difflist, test_difflist_reuse_nodes);
   tcase_add_test (tc_difflist, test_difflist_remove_last_line);
   tcase_add_test (tc_difflist, test_difflist_get_current);
   tcase_add_test (tc_difflist, test_difflist_get_first);
   tcase_add_test (tc_difflist, test_difflist_get_last);
   tcase_add_test (tc_difflist, test_difflist_iterator_prev_next);
   tcase_add_test (tc_difflist, test_difflist_get_line);
+  tcase_add_test (tc_difflist, test_difflist_get_line_runs);
   tcase_add_test (tc_difflist, test_difflist_go_to_line);
   suite_add_tcase (s, tc_difflist);
 
@@ -895,11 +2040,154 @@ diffmanager_suite (void)
   tcase_add_test (tc_diffmanager, test_diffmanager_remove_common_1);
   tcase_add_test (tc_diffmanager, test_diffmanager_remove_common_2);
   tcase_add_test (tc_diffmanager, test_diffmanager_remove_common_3);
+  tcase_add_test (tc_diffmanager, test_diffmanager_remove_common_ignore_case);
+  tcase_add_test (tc_diffmanager, test_diffmanager_remove_common_shifted);
+  tcase_add_test (tc_diffmanager, test_diffmanager_moves);
+  tcase_add_test (tc_diffmanager, test_diffmanager_ignore_blank_lines);
+  tcase_add_test (tc_diffmanager, test_diffmanager_input_line);
+  tcase_add_test (tc_diffmanager, test_diffmanager_unified);
+  tcase_add_test (tc_diffmanager, test_diffmanager_first_lines);
+  tcase_add_test (tc_diffmanager, test_diffmanager_checkpoint);
   suite_add_tcase (s, tc_diffmanager);
 
   return s;
 }
 
+Suite *
+chunkreader_suite (void)
+{
+  Suite *s = suite_create ("Chunk Reader");
+
+  /* Core test case */
+  TCase *tc_chunkreader = tcase_create ("Core");
+  tcase_add_test (tc_chunkreader, test_chunkreader_lines);
+  tcase_add_test (tc_chunkreader, test_chunkreader_shifted);
+  tcase_add_test (tc_chunkreader, test_chunkreader_spilled_offset);
+  tcase_add_test (tc_chunkreader, test_chunk_lists_compare_trivial);
+  tcase_add_test (tc_chunkreader, test_chunkreader_index);
+  suite_add_tcase (s, tc_chunkreader);
+
+  return s;
+}
+
+Suite *
+mergediff_suite (void)
+{
+  Suite *s = suite_create ("Merge Diff");
+
+  /* Core test case */
+  TCase *tc_mergediff = tcase_create ("Core");
+  tcase_add_test (tc_mergediff, test_mergediff_compare);
+  suite_add_tcase (s, tc_mergediff);
+
+  return s;
+}
+
+Suite *
+slicecache_suite (void)
+{
+    Suite *s = suite_create ("Slice Cache");
+
+    /* Core test case */
+    TCase *tc_slicecache = tcase_create ("Core");
+    tcase_add_test (tc_slicecache, test_slicecache);
+    suite_add_tcase (s, tc_slicecache);
+
+    return s;
+}
+
+Suite *
+resources_suite (void)
+{
+    Suite *s = suite_create ("Resources");
+
+    /* Core test case */
+    TCase *tc_resources = tcase_create ("Core");
+    tcase_add_test (tc_resources, test_resources_cgroup2);
+    suite_add_tcase (s, tc_resources);
+
+    return s;
+}
+
+Suite *
+iolimit_suite (void)
+{
+    Suite *s = suite_create ("I/O Limit");
+
+    /* Core test case */
+    TCase *tc_iolimit = tcase_create ("Core");
+    tcase_add_test (tc_iolimit, test_iolimit_take);
+    suite_add_tcase (s, tc_iolimit);
+
+    return s;
+}
+
+Suite *
+uringread_suite (void)
+{
+    Suite *s = suite_create ("Uring Read");
+
+    /* Core test case */
+    TCase *tc_uringread = tcase_create ("Core");
+    tcase_add_test (tc_uringread, test_uringread_read);
+    suite_add_tcase (s, tc_uringread);
+
+    return s;
+}
+
+Suite *
+spscring_suite (void)
+{
+    Suite *s = suite_create ("SPSC Ring");
+
+    /* Core test case */
+    TCase *tc_spscring = tcase_create ("Core");
+    tcase_add_test (tc_spscring, test_spscring_order);
+    tcase_add_test (tc_spscring, test_spscring_cancel);
+    suite_add_tcase (s, tc_spscring);
+
+    return s;
+}
+
+Suite *
+longline_suite (void)
+{
+    Suite *s = suite_create ("Long Line");
+
+    /* Core test case */
+    TCase *tc_longline = tcase_create ("Core");
+    tcase_add_test (tc_longline, test_longline_write);
+    suite_add_tcase (s, tc_longline);
+
+    return s;
+}
+
+Suite *
+keydiff_suite (void)
+{
+    Suite *s = suite_create ("Key Diff");
+
+    /* Core test case */
+    TCase *tc_keydiff = tcase_create ("Core");
+    tcase_add_test (tc_keydiff, test_keydiff_compare);
+    suite_add_tcase (s, tc_keydiff);
+
+    return s;
+}
+
+Suite *
+editcost_suite (void)
+{
+    Suite *s = suite_create ("Edit Cost");
+
+    /* Core test case */
+    TCase *tc_editcost = tcase_create ("Core");
+    tcase_add_test (tc_editcost, test_editcost_lower_bound);
+    suite_add_tcase (s, tc_editcost);
+
+    return s;
+}
+
 /*
  * NOTE: use "CK_FORK=no gdb check_lfdiff" to debug this
  */
@@ -908,11 +2196,33 @@ int main(void)
 {
     int number_failed;
     Suite *st = support_test_suite();
+    Suite *sh = hash_suite();
     Suite *sl = difflist_suite ();
     Suite *sm = diffmanager_suite();
+    Suite *sc = chunkreader_suite();
+    Suite *sg = mergediff_suite();
+    Suite *ss = slicecache_suite();
+    Suite *se = resources_suite();
+    Suite *si = iolimit_suite();
+    Suite *su = uringread_suite();
+    Suite *sq = spscring_suite();
+    Suite *sn = longline_suite();
+    Suite *sk = keydiff_suite();
+    Suite *sx = editcost_suite();
     SRunner *sr = srunner_create (st);
+    srunner_add_suite(sr, sh);
     srunner_add_suite(sr, sl);
     srunner_add_suite(sr, sm);
+    srunner_add_suite(sr, sc);
+    srunner_add_suite(sr, sg);
+    srunner_add_suite(sr, ss);
+    srunner_add_suite(sr, se);
+    srunner_add_suite(sr, si);
+    srunner_add_suite(sr, su);
+    srunner_add_suite(sr, sq);
+    srunner_add_suite(sr, sn);
+    srunner_add_suite(sr, sk);
+    srunner_add_suite(sr, sx);
     srunner_run_all (sr, CK_VERBOSE);
     number_failed = srunner_ntests_failed (sr);
     srunner_free (sr);